@@ -19,11 +19,47 @@
 #include <unistd.h>
 #include <dirent.h>
 #include <sstream>
-#include <regex>
+#include <unordered_map>
+#include <cstring>
 #include <iomanip>
 #include <map>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <deque>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <pwd.h>
+#include <grp.h>
+#include <ctime>
+#include <queue>
+#include <sys/syscall.h>
+#include <sys/inotify.h>
+#include <list>
+#include <unordered_set>
+#include <spawn.h>
+#include <csignal>
+#include <sys/wait.h>
+#include <sys/sendfile.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <climits>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <termios.h>
+#include <poll.h>
+#include <bitset>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#include <linux/fs.h>
 
 #define OPEN_FAILURE -1
 #define READ_FAILURE -2
@@ -31,6 +67,23 @@
 #define WRITE_FAILURE -4
 #define FILE_FAILURE -5
 #define SAME_FILE -6
+#define SYNTAX_FAILURE -7
+
+#define STREAM_BUFFER_SIZE (128 * 1024)    // Buffer das cópias em espaço de usuário
+#define STREAM_CHUNK_SIZE (1 << 30)        // Bytes por chamada de sendfile/splice
+#define PIPELINE_PIPE_SIZE (1 << 20)       // Capacidade dos pipes entre os estágios de um pipeline
+#define OUTPUT_BUFFER_SIZE (64 * 1024)     // Buffer da saída do shell no terminal
+#define INPUT_BUFFER_SIZE (64 * 1024)      // Bytes lidos por vez da entrada de comandos
+#define TRACE_RING_SIZE (1 << 15)          // Eventos guardados por thread durante um trace
+#define HISTORY_BLOCK_SIZE 64              // Comandos do histórico por filtro de trigramas
+#define SEARCH_BLOCK_SIZE (4 << 20)        // Bytes processados por vez nas buscas em arquivos
+#define GREP_BUFFER_LIMIT (16 << 20)       // Saída acumulada por arquivo do grep antes de aguardar a sua vez
+#define REGEX_MAX_STATES 4096              // Estados do DFA guardados antes de o cache ser descartado
+#define REGEX_MAX_REPEAT 255               // Maior limite aceito nos intervalos "{n,m}" das expressões regulares
+#define REGEX_MAX_NODES (1 << 20)          // Estados do NFA de uma expressão regular, após expandir os intervalos
+#define TAIL_BLOCK_SIZE (64 * 1024)        // Bytes lidos por vez do fim do arquivo pelo tail
+#define REMOVE_OPEN_DIRECTORIES 256        // Descritores de diretórios mantidos abertos durante um rmdir
+#define MOVE_MARKER ".mvprogress"          // Marca o destino de um mv entre sistemas de arquivos em andamento
 
 // Código de cores ANSI
 static const std::string ANSI_COLOR_RED = "\x1b[31m";
@@ -61,11 +114,24 @@ static std::map<std::string, std::string> helpDictionary = {
     { "ls", "Exibe os itens presente no diretório atual" },
     { "cat", "Exibe o conteúdo de um arquivo no shell" },
     { "touch", "Gera um arquivo arquivo em branco" },
-    { "cp", "Copia o conteúdo de um arquivo em outro arquivo" },
+    { "cp", "Copia arquivos e diretórios" },
     { "mkdir", "Gera diretórios" },
     { "rmdir", "Exclui um diretório" },
     { "rmfile", "Exclui um arquivo" },
     { "mv", "Move ou renomeia um arquivo ou diretório" },
+    { "cache", "Exibe e configura o cache de listagens de diretórios" },
+    { "hash", "Exibe os programas encontrados no PATH" },
+    { "find", "Busca arquivos em árvores de diretórios" },
+    { "grep", "Busca linhas em arquivos" },
+    { "wc", "Conta as linhas, as palavras e os bytes de arquivos" },
+    { "head", "Exibe as primeiras linhas de arquivos" },
+    { "tail", "Exibe as últimas linhas de arquivos ou acompanha um arquivo" },
+    { "history", "Exibe o histórico de comandos" },
+    { "output", "Exibe e configura o buffer da saída do shell" },
+    { "prompt", "Exibe e configura o formato do prompt" },
+    { "stats", "Exibe a latência e a E/S dos comandos executados" },
+    { "time", "Mede o tempo e a memória gastos por um comando" },
+    { "trace", "Registra as operações de E/S em um trace do Chrome" },
     { "quit", "Finaliza o shell" },
     { "exit", "Finaliza o shell" }
 };
@@ -78,7 +144,10 @@ static std::map<std::string, std::vector<CommandArgsDescription>> cmdArgsDescrip
     },
     { 
         "exit", 
-        {{ "exit", "Finaliza o processo do shell atual" }} 
+        {
+            { "exit", "Finaliza o processo do shell atual com o status do último comando" },
+            { "exit <status>", "Finaliza o processo do shell atual com o status informado" }
+        }
     },
     {
         "help",
@@ -108,13 +177,19 @@ static std::map<std::string, std::vector<CommandArgsDescription>> cmdArgsDescrip
         {
             {"ls", "Exibe os itens não ocultos presentes no diretório atual" },
             {"ls -a", "Exibe todos os itens presentes no diretório atual, inclusive os ocultos" },
-            {"ls -l", "Exibe os itens não ocultos presentes no diretório atual em forma de lista" },
-            {"ls -la", "Exibe todos os itens presentes no diretório atual, inclusive os ocultos, em forma de lista" },
+            {"ls -l", "Exibe os itens não ocultos presentes no diretório atual em forma de lista, com permissões, dono, tamanho e data de modificação" },
+            {"ls -la", "Exibe todos os itens presentes no diretório atual, inclusive os ocultos, em forma de lista, com permissões, dono, tamanho e data de modificação" },
+            {"ls -U", "Exibe os itens na ordem em que são lidos do diretório, sem ordená-los, à medida que são lidos" },
+            {"ls [-alU] <caminhos...>", "Exibe os arquivos e o conteúdo dos diretórios informados (e.g. ls *.log logs)" },
         }
     },
     {
         "cat",
-        {{ "cat <nome_do_arquivo>", "O comando cat permite a visualização do conteúdo de um arquivo" }}
+        {
+            { "cat <nome_do_arquivo>", "O comando cat permite a visualização do conteúdo de um arquivo" },
+            { "cat <arquivos...>", "Exibe os arquivos em sequência (e.g. cat logs/**/*.log)" },
+            { "<comando> | cat", "Sem arquivo, copia a saída do estágio anterior do pipeline" }
+        }
     },
     {
         "touch",
@@ -122,7 +197,12 @@ static std::map<std::string, std::vector<CommandArgsDescription>> cmdArgsDescrip
     },
     {
         "cp",
-        {{ "cp <nome_do_arquivo_1> <nome_do_arquivo_2>", "Copia todo o conteúdo do Arquivo 1 no Arquivo 2" }}
+        {
+            { "cp <nome_do_arquivo_1> <nome_do_arquivo_2>", "Copia todo o conteúdo do Arquivo 1 no Arquivo 2" },
+            { "cp -r <origem> <destino>", "Copia recursivamente um diretório, utilizando uma thread por núcleo" },
+            { "cp -r -j <N> <origem> <destino>", "Copia recursivamente um diretório utilizando N threads" },
+            { "cp [-r] <origens...> <diretório>", "Copia várias origens para dentro de um diretório (e.g. cp *.txt backup)" }
+        }
     },
     {
         "mkdir",
@@ -134,11 +214,125 @@ static std::map<std::string, std::vector<CommandArgsDescription>> cmdArgsDescrip
     },
     {
         "rmfile",
-        {{ "rmfile /caminho/do/arquivo.ext", "Remove o arquivo no caminho especificado." }}
+        {
+            { "rmfile /caminho/do/arquivo.ext", "Remove o arquivo no caminho especificado." },
+            { "rmfile <arquivos...>", "Remove todos os arquivos informados (e.g. rmfile *.tmp)" }
+        }
     },
     {
-        "rmfile",
-        {{ "mv <caminho/de/origem> <caminho/de/detino>", "Move ou renomeia um arquivo ou diretorio." }}
+        "cache",
+        {
+            { "cache stats", "Exibe os acertos, falhas e a memória utilizada pelo cache de listagens" },
+            { "cache clear", "Remove todas as listagens do cache" },
+            { "cache limit <MB>", "Altera o limite de memória do cache" }
+        }
+    },
+    {
+        "hash",
+        {
+            { "hash", "Exibe os programas já localizados no PATH e quantas vezes foram executados" },
+            { "hash -r", "Esquece os programas localizados, que serão procurados novamente no PATH" }
+        }
+    },
+    {
+        "output",
+        {
+            { "output", "Exibe o modo atual da saída" },
+            { "output buffered", "Acumula a saída e a exibe junto com o prompt (padrão)" },
+            { "output unbuffered", "Exibe cada mensagem imediatamente" }
+        }
+    },
+    {
+        "prompt",
+        {
+            { "prompt", "Exibe o formato atual do prompt" },
+            { "prompt '<formato>'", "Altera o formato: \\u usuário, \\h \\H dispositivo, \\w \\W diretório, \\$, \\n, \\e[..m cor" },
+            { "prompt reset", "Restaura o formato padrão" },
+            { "prompt stats", "Exibe o tempo gasto para exibir o prompt" }
+        }
+    },
+    {
+        "stats",
+        {
+            { "stats", "Exibe p50/p99/máximo da latência e a média de chamadas read/write e bytes por execução" },
+            { "stats clear", "Descarta as estatísticas coletadas" },
+            { "stats io on | off", "Ativa ou desativa a contagem de E/S (desativada em scripts)" }
+        }
+    },
+    {
+        "time",
+        {{ "time <comando>", "Executa o comando e exibe os tempos real, de usuário e de sistema e o pico de memória" }}
+    },
+    {
+        "trace",
+        {
+            { "trace", "Informa se o trace está ativo" },
+            { "trace start", "Inicia o registro das operações de E/S" },
+            { "trace stop <arquivo.json>", "Finaliza o registro e grava os eventos (chrome://tracing, Perfetto)" }
+        }
+    },
+    {
+        "find",
+        {
+            { "find [caminhos...]", "Exibe todos os itens abaixo dos caminhos (padrão: diretório atual)" },
+            { "find -name '<padrão>'", "Itens cujo nome corresponde ao padrão (-iname ignora maiúsculas)" },
+            { "find -type f|d|l", "Apenas arquivos, diretórios ou links simbólicos" },
+            { "find -size [+|-]N[c|k|M|G]", "Tamanho maior, menor ou igual a N (sem unidade, blocos de 512 bytes)" },
+            { "find -mtime [+|-]N", "Modificados há mais, menos ou exatamente N dias" },
+            { "find -mindepth N -maxdepth N", "Limita a profundidade dos itens exibidos e percorridos" },
+            { "find -prune '<padrão>'", "Não percorre os diretórios cujo nome corresponde ao padrão (e.g. -prune .git)" },
+            { "find -j N", "Utiliza N threads (padrão: uma por núcleo)" }
+        }
+    },
+    {
+        "grep",
+        {
+            { "grep <padrão> [arquivos...]", "Exibe as linhas que contêm o padrão (sem arquivos, busca na entrada)" },
+            { "grep -n | -c | -l", "Exibe o número das linhas, apenas a quantidade ou apenas o nome dos arquivos" },
+            { "grep -v", "Seleciona as linhas que não contêm o padrão" },
+            { "grep -i | -F", "Ignora maiúsculas e minúsculas ou trata o padrão como texto" },
+            { "grep -j N", "Utiliza até N threads, uma por arquivo (padrão: uma por núcleo)" },
+            { "padrões", "Texto ou expressão estendida: . [a-z] [^a-z] \\d \\w \\s ^ $ * + ? | ( )" }
+        }
+    },
+    {
+        "wc",
+        {
+            { "wc [arquivos...]", "Exibe as linhas, as palavras e os bytes de cada arquivo (sem arquivos, da entrada)" },
+            { "wc -l | -w | -c", "Exibe apenas as linhas, as palavras ou os bytes (combináveis, e.g. -lw)" },
+            { "wc -j N", "Utiliza até N threads, uma por arquivo (padrão: uma por núcleo)" }
+        }
+    },
+    {
+        "head",
+        {
+            { "head [arquivos...]", "Exibe as 10 primeiras linhas de cada arquivo (sem arquivos, da entrada)" },
+            { "head -n N [arquivos...]", "Exibe as N primeiras linhas" }
+        }
+    },
+    {
+        "tail",
+        {
+            { "tail [arquivos...]", "Exibe as 10 últimas linhas de cada arquivo (sem arquivos, da entrada)" },
+            { "tail -n N [arquivos...]", "Exibe as N últimas linhas, lendo o arquivo a partir do fim" },
+            { "tail -f <arquivo>", "Continua exibindo as linhas acrescentadas, inclusive após a rotação do arquivo (Ctrl-C encerra)" }
+        }
+    },
+    {
+        "history",
+        {
+            { "history", "Exibe todos os comandos do histórico, numerados" },
+            { "history <n>", "Exibe os últimos n comandos" },
+            { "!n | !-n | !! | !texto", "Executa o comando n, o n-ésimo a partir do fim, o último ou o último iniciado pelo texto" },
+            { "Ctrl-R", "Busca reversa no histórico (Ctrl-R novamente procura a ocorrência anterior)" }
+        }
+    },
+    {
+        "mv",
+        {
+            { "mv <caminho/de/origem> <caminho/de/detino>", "Move ou renomeia um arquivo ou diretorio." },
+            { "mv <origens...> <diretório>", "Move várias origens para dentro de um diretório (e.g. mv *.log antigos)" }
+        }
     }
 };
 
@@ -162,29 +356,20 @@ std::string trim(const std::string & str) {
 }
 
 /**
- * Obtém as substrings de um string delimitadas por um determinado caracter.
+ * Completa uma string com espaços à direita até uma determinada largura.
+ * Caracteres UTF-8 com mais de um byte ocupam apenas uma coluna.
  * 
- * @param[in] str String a ser processada
- * @param[in] character O caracter delimitador
- * @return Um lista de substrings.
+ * @param[in] str A string.
+ * @param[in] width A largura desejada.
+ * @return A string com os espaços.
 */
-std::vector<std::string> getSubstrings(const std::string & str, const char & character) {
-    std::vector<std::string> substrings;
-    size_t start = 0;
-    size_t end;
-
-    while ( ( start = str.find(character, start) ) != std::string::npos ) {
-        end = str.find(character, start + 1);
-        
-        if (end == std::string::npos)
-            break;
-
-        substrings.push_back(str.substr(start + 1, end - start - 1));
-        start = end + 1;
-    }
+std::string padRight(const std::string & str, const size_t & width) {
+    size_t columns = 0;
 
+    for ( unsigned char c: str )
+        if ( ( c & 0xC0 ) != 0x80 ) columns++;
 
-    return substrings;
+    return columns >= width ? str : str + std::string(width - columns, ' ');
 }
 
 std::vector<std::string> split(const std::string & str, const char & character) {
@@ -203,415 +388,8780 @@ std::vector<std::string> split(const std::string & str, const char & character)
 }
 
 /**
- * Escopos das funções responsáveis em executar
- * os comandos disponíveis.
+ * Junta strings com um separador entre elas.
+ * 
+ * @param[in] strings As strings.
+ * @param[in] separator O separador.
+ * @return As strings unidas.
 */
-namespace Runner {
+std::string join(const std::vector<std::string> & strings, const std::string & separator) {
+    std::string result;
 
-    /**
-     * Obtém o nome do usuário atual.
-     * 
-     * @return O nome do usuário. 
-    */
-    std::string getCurrentUser() {
-        return getlogin();
+    for ( size_t i = 0; i < strings.size(); i++ ) {
+        if ( i > 0 ) result += separator;
+        result += strings[i];
     }
-    
-    /**
-     * Obtém o nome do dispositivo atual.
-     * 
-     * @return O nome do dispositivo. 
-    */
-    std::string getHostname() {
-        char $hostname[HOST_NAME_MAX + 1];
-        gethostname( $hostname, HOST_NAME_MAX + 1 ); 
-        return $hostname;
+
+    return result;
+}
+
+/**
+ * Divide uma linha de comando em tokens no formato argv.
+ *
+ * Os tokens são separados por espaços em branco. Trechos entre aspas
+ * simples são copiados literalmente; entre aspas duplas apenas \" e \\
+ * são tratados como escape. Fora das aspas, '\' escapa o próximo caracter.
+ * "$?" é substituído pelo status do último comando, exceto entre aspas simples.
+ * Quando `pipes` é informado, um '|' fora das aspas separa os estágios de
+ * um pipeline e a posição do primeiro token de cada estágio seguinte é
+ * registrada. Quando `patterns` é informado, cada token com algum caracter
+ * de glob (*, ?, [ ou {) fora das aspas recebe o seu padrão, em que os
+ * caracteres especiais vindos de aspas ou escapes são precedidos por '\';
+ * os demais tokens recebem um padrão vazio.
+ *
+ * @param[in] text A linha de comando.
+ * @param[out] tokens Os tokens obtidos.
+ * @param[in] lastStatus O status do último comando executado.
+ * @param[out] pipes Os índices dos tokens que iniciam um novo estágio do pipeline.
+ * @param[out] patterns O padrão de glob de cada token.
+ * @return status da operação (SYNTAX_FAILURE caso alguma aspa não seja fechada).
+*/
+int tokenize(const std::string & text, std::vector<std::string> & tokens, const int & lastStatus = 0,
+             std::vector<size_t> *pipes = nullptr, std::vector<std::string> *patterns = nullptr) {
+    std::string token, pattern;
+    bool inToken = false, glob = false;
+    size_t i = 0, n = text.size();
+
+    tokens.clear();
+    if ( pipes != nullptr ) pipes->clear();
+    if ( patterns != nullptr ) patterns->clear();
+
+    // Acrescenta ao token um trecho vindo de aspas ou de um escape, que nunca é um glob
+    auto quoted = [&](const char & c) {
+        token += c;
+        if ( strchr("*?[]{},\\", c) != nullptr ) pattern += '\\';
+        pattern += c;
+    };
+
+    auto push = [&]() {
+        if ( patterns != nullptr ) patterns->push_back(glob ? pattern : std::string());
+        tokens.push_back(std::move(token));
+        token.clear();
+        pattern.clear();
+        glob = inToken = false;
+    };
+
+    while ( i < n ) {
+        char c = text[i];
+
+        if ( c == ' ' or c == '\t' ) {
+            if ( inToken ) push();
+            i++;
+            continue;
+        }
+
+        if ( c == '|' and pipes != nullptr ) {
+            if ( inToken ) push();
+            pipes->push_back(tokens.size());
+            i++;
+            continue;
+        }
+
+        inToken = true;
+
+        if ( c == '\'' ) {
+            size_t end = text.find('\'', i + 1);
+            if ( end == std::string::npos ) return SYNTAX_FAILURE;
+
+            for ( i++; i < end; i++ ) quoted(text[i]);
+            i = end + 1;
+        } else if ( c == '"' ) {
+            for ( i++; i < n and text[i] != '"'; i++ ) {
+                if ( text[i] == '$' and i + 1 < n and text[i + 1] == '?' ) {
+                    for ( char digit: std::to_string(lastStatus) ) quoted(digit);
+                    i++;
+                    continue;
+                }
+
+                if ( text[i] == '\\' and i + 1 < n and ( text[i + 1] == '"' or text[i + 1] == '\\' ) )
+                    i++;
+                quoted(text[i]);
+            }
+
+            if ( i >= n ) return SYNTAX_FAILURE;
+            i++;
+        } else if ( c == '\\' and i + 1 < n ) {
+            quoted(text[i + 1]);
+            i += 2;
+        } else if ( c == '$' and i + 1 < n and text[i + 1] == '?' ) {
+            for ( char digit: std::to_string(lastStatus) ) quoted(digit);
+            i += 2;
+        } else {
+            token += c;
+            pattern += c;
+            glob |= c == '*' or c == '?' or c == '[' or c == '{';
+            i++;
+        }
     }
 
+    if ( inToken ) push();
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Conjunto de threads com roubo de tarefas (work stealing).
+ * 
+ * Cada thread possui a sua própria fila. As tarefas enviadas por uma thread
+ * do conjunto entram na fila dela e são consumidas em ordem LIFO; quando a
+ * fila esvazia, a thread rouba as tarefas mais antigas das outras filas.
+ * As tarefas enviadas de fora do conjunto são distribuídas entre as filas.
+ * 
+ * A quantidade de tarefas em espera é limitada por `capacity`: o envio
+ * externo bloqueia até haver espaço e, dentro do conjunto, a tarefa é
+ * executada imediatamente pela própria thread que a enviou.
+*/
+class ThreadPool {
+
+    public:
+
+    using Task = std::function<void()>;
+
     /**
-     * Apresenta um texto na tela.
+     * Contrutor
      * 
-     * @param[in] text Texto a ser mostrado. 
-     * @param[in] mode Modo de exibição
+     * @param[in] threads Quantidade de threads (0 para o número de núcleos)
+     * @param[in] capacity Quantidade máxima de tarefas em espera
     */
-    void display(const std::string & text, const char & mode = 'n') {
-        
-        if ( mode == 'n') std::cout << ANSI_COLOR_RESET << text;
-        else if ( mode == 'e' ) std::cout << ANSI_COLOR_RED << "ERROR: " << text;
-        
-        fflush(stdout);
+    explicit ThreadPool(size_t threads = 0, const size_t & capacity = 4096) : capacity(capacity) {
+        if ( threads == 0 ) threads = std::max(1u, std::thread::hardware_concurrency());
+
+        for ( size_t i = 0; i < threads; i++ )
+            queues.emplace_back(new Queue);
+
+        for ( size_t i = 0; i < threads; i++ )
+            workers.emplace_back(&ThreadPool::run, this, i);
     }
 
-    /**
-     * Limpa a tela do shell.
-    */
-    void clear() {
-        std::cout << CLEAR_CODE;      
-        fflush(stdout);
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+
+        available.notify_all();
+
+        for ( auto & worker: workers ) worker.join();
     }
 
     /**
-     * Obtém o diretório atual.
+     * Obtém a quantidade de threads do conjunto.
      * 
-     * @return O diretório atual.
+     * @return A quantidade de threads.
     */
-    std::string getCurrentDirectory() {
-        return get_current_dir_name();
+    size_t size() const {
+        return workers.size();
     }
 
     /**
-     * Altera o diretório atual para um camingo específico.
+     * Envia uma tarefa para ser executada por uma das threads.
      * 
-     * @param[in] path Caminho de destino
-     * @return Um valor negativo, caso não consiga alterar o diretório atual.
-     *         Caso contrário, a mudança foi realizada com sucesso.
+     * @param[in] task A tarefa.
     */
-    int changeDirectory(const std::string & path) {
-        return chdir(path.c_str());
-    }
+    void submit(Task task) {
+        bool inside = current == this;
+
+        if ( inside and queued >= capacity ) {
+            task();
+            return;
+        }
+
+        if ( not inside and queued >= capacity ) {
+            std::unique_lock<std::mutex> lock(mutex);
+            space.wait(lock, [this] { return queued < capacity; });
+        }
+
+        pending++;
+        queued++;
 
+        Queue & queue = *queues[inside ? index : next++ % queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
 
-    // Função auxiliar para comparar os valores
-    bool cmp(const dirent * a, const dirent * b) {
-        return (std::string) a->d_name < b->d_name;
+        std::lock_guard<std::mutex> lock(mutex);
+        available.notify_one();
     }
 
     /**
-     * Altera o diretório atual para um camingo específico.
+     * Aguarda a conclusão de todas as tarefas enviadas.
      * 
-     * @param[in] path Caminho de destino
-     * @param[in] all Flag que indica para onter todos os itens, inclusive os ocultos.
-     * @return A lista de itens presentes no diretório.
+     * @param[in] timeout Tempo máximo de espera (negativo para esperar indefinidamente)
+     * @return true caso todas as tarefas tenham sido concluídas.
     */
-    std::vector<dirent *> getItensOfDirectory(const std::string & path, const bool & all = false) {
-        DIR *dir = opendir(path.c_str());
-        dirent *d;
+    bool wait(const std::chrono::milliseconds & timeout = std::chrono::milliseconds(-1)) {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto done = [this] { return pending == 0; };
 
-        if ( dir == nullptr )
-             return {}; 
+        if ( timeout.count() < 0 ) {
+            idle.wait(lock, done);
+            return true;
+        }
 
-        std::vector<dirent *> dirs;
+        return idle.wait_for(lock, timeout, done);
+    }
 
-        while ( (d = readdir(dir)) != nullptr ) {
-            
-            // Se arquivos ocultos são encontrados
-            if ( !all and d->d_name[0] == '.' )
-                continue;
-            
-            dirs.push_back(d);
-        }   
+    private:
 
-        std::sort(dirs.begin(), dirs.end(), cmp);
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
 
-        return dirs;
-    }
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable available, idle, space;
+
+    std::atomic<size_t> pending { 0 };      // Tarefas enviadas e ainda não concluídas
+    std::atomic<size_t> queued { 0 };       // Tarefas aguardando em alguma fila
+    std::atomic<size_t> next { 0 };
+    const size_t capacity;
+    bool stopping = false;
+
+    static thread_local ThreadPool *current;
+    static thread_local size_t index;
 
     /**
-     * Obtém o conteúdo de um arquivo
+     * Obtém uma tarefa da própria fila ou, caso esteja vazia, das demais.
      * 
-     * @param[in] file Caminho do arquivo
-     * @param[in, out] content String que conterá o conteúdo do arquivo
-     * @return status da operação
+     * @param[in] i Índice da thread
+     * @param[out] task A tarefa obtida
+     * @return true caso alguma tarefa tenha sido obtida.
     */
-    int getFileContent(const std::string & file, std::string & content) {
-        int fd = open(file.c_str(), O_RDONLY);
-        ssize_t nread, total = 0;
-        char *buffer;
+    bool pop(const size_t & i, Task & task) {
+        for ( size_t k = 0; k < queues.size(); k++ ) {
+            Queue & queue = *queues[(i + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
 
-        if ( fd < 0 ) return OPEN_FAILURE;
+            if ( queue.tasks.empty() ) continue;
 
-        off_t fileSize = lseek(fd, 0, SEEK_END);
-        lseek(fd, 0, SEEK_SET);
+            if ( k == 0 ) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
 
-        // Aloca um buffer do tamanho do arquivo
-        buffer = (char *) malloc(fileSize);
+            return true;
+        }
 
-        if ( buffer == nullptr ) return MALLOC_FAILURE;
+        return false;
+    }
 
-        // Lê o arquivo em um loop
-        while ( ( nread = read(fd, buffer + total, fileSize - total)) > 0 )
-            total += nread;
+    // Laço executado por cada thread do conjunto
+    void run(const size_t i) {
+        current = this;
+        index = i;
 
-        if ( nread < 0 ) return READ_FAILURE;
+        Task task;
 
-        if ( buffer[fileSize - 1] == '\n' )
-            buffer[fileSize - 1] = '\0';
+        while ( true ) {
+            if ( pop(i, task) ) {
+                if ( queued-- >= capacity ) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    space.notify_all();
+                }
 
-        content = buffer;
+                task();
+                task = nullptr;
 
-        free(buffer);
-        close(fd);
+                if ( --pending == 0 ) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    idle.notify_all();
+                }
 
-        return EXIT_SUCCESS;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this] { return stopping or queued > 0; });
+
+            if ( stopping and queued == 0 ) return;
+        }
     }
+};
 
-     /**
-     * Gera um arquivo em branco com um determinado nome
-     * 
-     * @param[in] filename Nome do arquivo a ser criado
-     * @return status da operação
-    */
-    int createBlankFile(const std::string & filename) {
-        mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-        int fd = open(filename.c_str(), O_WRONLY | O_CREAT, mode);
+thread_local ThreadPool *ThreadPool::current = nullptr;
+thread_local size_t ThreadPool::index = 0;
 
-        if ( fd < 0 ) return OPEN_FAILURE;
-        close(fd);
+/**
+ * Lista compacta dos itens de um diretório.
+ * 
+ * Os nomes são armazenados em sequência em um único buffer (arena),
+ * terminados por '\0', e cada item guarda apenas a posição do nome,
+ * o seu tamanho, o tipo e o inode. Os primeiros 8 bytes de cada nome
+ * também são guardados como um inteiro big-endian, de forma que a
+ * ordenação compara inteiros e só recorre a memcmp quando os prefixos
+ * são iguais. A ordem obtida é a mesma de strcmp.
+*/
+class DirListing {
 
-        return EXIT_SUCCESS;
-    }
+    public:
 
-     /**
-     * Copia o conteúdo de um arquivo em outro arquivo.
+    struct Entry {
+        uint64_t prefix;            // Primeiros 8 bytes do nome, em big-endian
+        uint64_t inode;
+        uint32_t offset;            // Posição do nome na arena
+        uint16_t length;
+        unsigned char type;         // Tipo do item (DT_REG, DT_DIR, ...), como em dirent
+    };
+
+    /**
+     * Adiciona um item à lista.
      * 
-     * @param[in] source Arquivo de origem
-     * @param[in] target Arquivo de destino
-     * @return status da operação
+     * @param[in] name Nome do item
+     * @param[in] length Tamanho do nome
+     * @param[in] type Tipo do item
+     * @param[in] inode Inode do item
+     * @return false caso a arena tenha atingido o seu tamanho máximo (4 GiB).
     */
-    int copyContentFile(const std::string & source, const std::string & target) {
-        std::string sourceContent;
-        
-        int status =  getFileContent(source, sourceContent);
+    bool add(const char *name, const size_t & length, const unsigned char & type, const uint64_t & inode) {
+        if ( arena.size() + length + 1 > UINT32_MAX ) return false;
 
-        if ( status < 0 ) return status;
-
-        mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-        int fd = open(target.c_str(), O_WRONLY | O_CREAT, mode);
+        uint64_t prefix = 0;
 
-        ssize_t s = write(fd, sourceContent.c_str(), sourceContent.size());
-        close(fd);
+        for ( size_t i = 0; i < 8; i++ )
+            prefix = ( prefix << 8 ) | ( i < length ? (unsigned char) name[i] : 0 );
 
-        if ( s != sourceContent.size() )
-            return WRITE_FAILURE;
+        entries.push_back({ prefix, inode, (uint32_t) arena.size(), (uint16_t) length, type });
+        arena.insert(arena.end(), name, name + length + 1);
 
-        return EXIT_SUCCESS;
+        return true;
     }
 
     /**
-     * Gera um diretório.
-     * 
-     * @param[in] path Caminho do diretório
-     * @return status da operação
+     * Ordena os itens pelo nome.
     */
-    int createDirectory(std::string & path) {
-        std::string p = "./";
-        int status;
+    void sort() {
+        const char *base = arena.data();
 
-        if ( path[0] == '/' or ( path[0] == '.' and path[1] == '/' ) )
-            p = "";
+        std::sort(entries.begin(), entries.end(), [base](const Entry & a, const Entry & b) {
+            if ( a.prefix != b.prefix ) return a.prefix < b.prefix;
+            if ( a.length <= 8 or b.length <= 8 ) return a.length < b.length;
 
-        for ( auto &str: split(path, '/') ) {
-            p += str + "/";
-            status = mkdir(p.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
-        }
+            int c = memcmp(base + a.offset + 8, base + b.offset + 8, std::min(a.length, b.length) - 8);
+            return c != 0 ? c < 0 : a.length < b.length;
+        });
+    }
 
-        if ( status < 0 ) return EXIT_FAILURE;
-        return EXIT_SUCCESS;
+    /// @brief Remove todos os itens, mantendo a memória alocada.
+    void clear() {
+        entries.clear();
+        arena.clear();
     }
 
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    const char * name(const size_t & i) const { return arena.data() + entries[i].offset; }
+    size_t length(const size_t & i) const { return entries[i].length; }
+    unsigned char type(const size_t & i) const { return entries[i].type; }
+    uint64_t inode(const size_t & i) const { return entries[i].inode; }
+
     /**
-     * Exlui um arquivo.
+     * Obtém a memória ocupada pela lista.
      * 
-     * @param[in] path Caminho do arquivo
-     * @return status da operação
+     * @return A quantidade de bytes utilizada pelos itens e pela arena.
     */
-    int removeFile(std::string & path) {
-
-        if ( not (path[0] == '/' or ( path[0] == '.' and path[1] == '/') ) )
-            path = "./" + path;
-
-        if ( !unlink(path.c_str())) return EXIT_SUCCESS;
-        else return EXIT_FAILURE;   
+    size_t memoryUsage() const {
+        return entries.capacity() * sizeof(Entry) + arena.capacity();
     }
 
     /**
-     * Exlui um diretório.
+     * Obtém a memória ocupada pelos itens presentes, sem a capacidade
+     * mantida por clear().
      * 
-     * @param[in] path Caminho do diretório
-     * @return status da operação
+     * @return A quantidade de bytes dos itens e dos seus nomes.
     */
-    int removeDirectory(std::string & path) {
-
-        if ( not (path[0] == '/' or ( path[0] == '.' and path[1] == '/') ) )
-            path = "./" + path;
-
+    size_t usedMemory() const {
+        return entries.size() * sizeof(Entry) + arena.size();
+    }
 
-        auto itens = getItensOfDirectory(path, true);
+    private:
 
-        // O diretório não está vazio
-        if ( itens.size() > 2 ) {
+    std::vector<Entry> entries;
+    std::vector<char> arena;
+};
 
+/**
+ * Histograma de latências no estilo HDR (High Dynamic Range).
+ * 
+ * Os valores, em nanossegundos, são agrupados por potência de 2 e cada
+ * potência é dividida em 16 faixas lineares, de forma que o erro relativo
+ * de qualquer percentil é de no máximo 1/16 (~6%), de nanossegundos a
+ * horas, com um vetor fixo de contadores. Os contadores são atômicos: o
+ * registro de um valor não utiliza locks e pode ocorrer em várias threads.
+*/
+class LatencyHistogram {
+
+    public:
+
+    /**
+     * Registra um valor.
+     * 
+     * @param[in] value O valor, em nanossegundos
+    */
+    void record(const uint64_t & value) {
+        counts[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+
+        uint64_t current = maximum.load(std::memory_order_relaxed);
+        while ( value > current and !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed) );
+    }
+
+    uint64_t count() const {
+        return total.load(std::memory_order_relaxed);
+    }
+
+    uint64_t max() const {
+        return maximum.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Obtém um percentil dos valores registrados.
+     * 
+     * @param[in] percentile O percentil, entre 0 e 100
+     * @return O valor do percentil (o ponto médio da faixa), ou 0 se não houver valores.
+    */
+    uint64_t percentile(const double & percentile) const {
+        uint64_t n = count();
+
+        if ( n == 0 ) return 0;
+
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t) std::ceil(percentile / 100.0 * n)), seen = 0;
+
+        for ( size_t i = 0; i < BUCKETS; i++ ) {
+            seen += counts[i].load(std::memory_order_relaxed);
+
+            if ( seen >= rank ) return std::min(valueOf(i), max());
+        }
+
+        return max();
+    }
+
+    void clear() {
+        for ( auto & count: counts ) count.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        maximum.store(0, std::memory_order_relaxed);
+    }
+
+    private:
+
+    static const size_t SUB_BUCKETS = 16;
+    static const size_t BUCKETS = SUB_BUCKETS + ( 64 - 4 ) * SUB_BUCKETS;
+
+    /**
+     * Obtém a faixa de um valor: os valores menores que 16 têm uma faixa
+     * própria, e os demais são indexados pela potência de 2 e pelos 4 bits
+     * seguintes ao bit mais significativo.
+    */
+    static size_t bucketOf(const uint64_t & value) {
+        if ( value < SUB_BUCKETS ) return value;
+
+        int magnitude = 63 - __builtin_clzll(value);
+
+        return SUB_BUCKETS + ( magnitude - 4 ) * SUB_BUCKETS + ( ( value >> ( magnitude - 4 ) ) & ( SUB_BUCKETS - 1 ) );
+    }
+
+    /**
+     * Obtém o valor representativo (ponto médio) de uma faixa.
+    */
+    static uint64_t valueOf(const size_t & bucket) {
+        if ( bucket < SUB_BUCKETS ) return bucket;
+
+        size_t magnitude = ( bucket - SUB_BUCKETS ) / SUB_BUCKETS + 4;
+        uint64_t width = 1ull << ( magnitude - 4 );
+        uint64_t low = ( SUB_BUCKETS + ( bucket - SUB_BUCKETS ) % SUB_BUCKETS ) * width;
+
+        return low + width / 2;
+    }
+
+    std::atomic<uint64_t> counts[BUCKETS] = {};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> maximum{0};
+};
+
+/**
+ * Registro de intervalos (spans) de execução, exportados no formato de
+ * trace do Chrome (chrome://tracing, Perfetto).
+ * 
+ * Cada thread grava os seus eventos em um buffer circular próprio, sem
+ * locks; quando o buffer enche, os eventos mais antigos são descartados.
+ * O buffer de uma thread encerrada é mantido até o próximo start, que o
+ * reserva para ser reaproveitado pela próxima thread criada. Com o trace
+ * desativado, um span custa apenas a leitura de um atômico.
+*/
+class Tracer {
+
+    public:
+
+    struct Event {
+        const char *name;
+        uint64_t start;             // Nanossegundos desde o início do trace
+        uint64_t duration;
+        int64_t bytes;              // -1 quando não se aplica
+        std::string detail;         // e.g. o caminho do arquivo
+    };
+
+    /**
+     * Obtém a instância do registro.
+     * 
+     * @return O registro.
+    */
+    static Tracer & instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Descarta os eventos anteriores e inicia o registro.
+    */
+    void start() {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t kept = 0;
+
+        // Os eventos das threads encerradas são descartados junto com os demais
+        for ( auto & ring: rings ) {
+            if ( ring->active.load(std::memory_order_acquire) ) {
+                ring->head.store(0, std::memory_order_relaxed);
+                rings[kept++] = ring;
+            }
+            else spare.push_back(ring);
+        }
+
+        rings.resize(kept);
+
+        epoch = std::chrono::steady_clock::now();
+        enabled.store(true, std::memory_order_release);
+    }
+
+    void stop() {
+        enabled.store(false, std::memory_order_release);
+    }
+
+    /**
+     * Obtém o instante atual, relativo ao início do trace.
+     * 
+     * @return O instante, em nanossegundos.
+    */
+    uint64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    /**
+     * Grava um evento no buffer da thread atual.
+     * 
+     * @param[in] name O nome do span
+     * @param[in] start O início do span
+     * @param[in] bytes A quantidade de bytes processada (-1 quando não se aplica)
+     * @param[in] detail Informação adicional do span
+    */
+    void record(const char *name, const uint64_t & start, const int64_t & bytes, const std::string & detail) {
+        Ring & ring = getRing();
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        Event & event = ring.events[head % TRACE_RING_SIZE];
+
+        event.name = name;
+        event.start = start;
+        event.duration = now() - start;
+        event.bytes = bytes;
+        event.detail = detail;
+
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    /**
+     * Grava os eventos registrados em um arquivo JSON no formato de trace do Chrome.
+     * 
+     * @param[in] file Caminho do arquivo
+     * @param[out] written Quantidade de eventos gravados
+     * @param[out] dropped Quantidade de eventos descartados pelos buffers cheios
+     * @return status da operação
+    */
+    int dump(const std::string & file, size_t & written, size_t & dropped) {
+        std::lock_guard<std::mutex> lock(mutex);
+        FILE *out = fopen(file.c_str(), "w");
+
+        if ( out == nullptr ) return OPEN_FAILURE;
+
+        written = dropped = 0;
+
+        fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+        for ( auto & ring: rings ) {
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+            dropped += first;
+
+            for ( uint64_t i = first; i < head; i++ ) {
+                const Event & event = ring->events[i % TRACE_RING_SIZE];
+
+                fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{",
+                        written++ ? "," : "", event.name, getpid(), ring->tid, event.start / 1e3, event.duration / 1e3);
+
+                if ( event.bytes >= 0 ) fprintf(out, "\"bytes\":%lld,", (long long) event.bytes);
+
+                fprintf(out, "\"detail\":\"%s\"}}", escape(event.detail).c_str());
+            }
+        }
+
+        fprintf(out, "\n]}\n");
+
+        return fclose(out) == 0 ? EXIT_SUCCESS : WRITE_FAILURE;
+    }
+
+    private:
+
+    struct Ring {
+        pid_t tid;
+        std::vector<Event> events;
+        std::atomic<uint64_t> head{0};
+        std::atomic<bool> active{true};         // false após o fim da thread
+    };
+
+    // Marca o buffer como livre quando a sua thread termina
+    struct Owner {
+        std::shared_ptr<Ring> ring;
+
+        ~Owner() {
+            if ( ring != nullptr ) ring->active.store(false, std::memory_order_release);
+        }
+    };
+
+    Tracer() : epoch(std::chrono::steady_clock::now()) {}
+
+    /**
+     * Obtém o buffer da thread atual no primeiro evento da thread,
+     * reaproveitando o de uma thread encerrada quando houver.
+     * Os buffers pertencem ao registro e sobrevivem ao fim das threads.
+    */
+    Ring & getRing() {
+        thread_local Owner local;
+
+        if ( local.ring == nullptr ) {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if ( spare.empty() ) {
+                local.ring = std::make_shared<Ring>();
+                local.ring->events.resize(TRACE_RING_SIZE);
+            }
+            else {
+                local.ring = spare.back();
+                spare.pop_back();
+            }
+
+            local.ring->tid = syscall(SYS_gettid);
+            local.ring->head.store(0, std::memory_order_relaxed);
+            local.ring->active.store(true, std::memory_order_relaxed);
+            rings.push_back(local.ring);
+        }
+
+        return *local.ring;
+    }
+
+    /**
+     * Escapa um texto para ser incluído em uma string JSON.
+    */
+    static std::string escape(const std::string & text) {
+        std::string result;
+
+        for ( unsigned char c: text ) {
+            if ( c == '"' or c == '\\' ) result += '\\', result += c;
+            else if ( c < 0x20 ) {
+                char code[8];
+                snprintf(code, sizeof code, "\\u%04x", c);
+                result += code;
+            }
+            else result += c;
+        }
+
+        return result;
+    }
+
+    static std::atomic<bool> enabled;
+    std::chrono::steady_clock::time_point epoch;
+    std::vector<std::shared_ptr<Ring>> rings;
+    std::vector<std::shared_ptr<Ring>> spare;       // Buffers de threads encerradas, livres para reúso
+    std::mutex mutex;
+};
+
+std::atomic<bool> Tracer::enabled{false};
+
+/**
+ * Span registrado do construtor ao destrutor, quando o trace está ativo.
+ * 
+ * Uso: TraceSpan span("copyContentFile", source); ... span.setBytes(n);
+*/
+class TraceSpan {
+
+    public:
+
+    TraceSpan(const char *name, const std::string & detail) : name(Tracer::isEnabled() ? name : nullptr) {
+        if ( this->name != nullptr ) {
+            this->detail = detail;
+            start = Tracer::instance().now();
+        }
+    }
+
+    ~TraceSpan() {
+        if ( name != nullptr ) Tracer::instance().record(name, start, bytes, detail);
+    }
+
+    void setBytes(const int64_t & value) {
+        bytes = value;
+    }
+
+    private:
+
+    const char *name;
+    std::string detail;
+    uint64_t start = 0;
+    int64_t bytes = -1;
+};
+
+/**
+ * Buffer da saída padrão do shell.
+ * 
+ * Os textos são acumulados em um buffer em espaço de usuário, que só é
+ * escrito quando enche ou quando flush é chamado (e.g. ao exibir o prompt
+ * ou antes de executar um programa externo). Textos que não cabem no
+ * espaço livre são escritos junto com o buffer em um único writev, sem
+ * serem copiados. No modo sem buffer, cada escrita é enviada imediatamente.
+*/
+class OutputBuffer {
+
+    public:
+
+    /**
+     * Obtém a saída padrão do shell.
+     * 
+     * @return O buffer da saída padrão.
+    */
+    static OutputBuffer & instance() {
+        static OutputBuffer output(STDOUT_FILENO);
+        return output;
+    }
+
+    ~OutputBuffer() {
+        flush();
+    }
+
+    /**
+     * Indica se a saída é um terminal, o único caso em que cores são utilizadas.
+     * 
+     * @return true se a saída é um terminal.
+    */
+    bool isTerminal() const {
+        return terminal;
+    }
+
+    bool isBuffered() const {
+        return buffered;
+    }
+
+    /**
+     * Ativa ou desativa o buffer. Ao desativá-lo, o conteúdo pendente é escrito.
+     * 
+     * @param[in] value true para utilizar o buffer
+    */
+    void setBuffered(const bool & value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        buffered = value;
+        writePending(nullptr, 0);
+    }
+
+    /**
+     * Escreve um conjunto de trechos na saída.
+     * 
+     * @param[in] pieces Os trechos, na ordem em que devem ser escritos
+     * @param[in] count Quantidade de trechos
+     * @return status da operação
+    */
+    int write(const struct iovec *pieces, const int & count) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t total = 0;
+
+        for ( int i = 0; i < count; i++ ) {
+            total += pieces[i].iov_len;
+            if ( pieces[i].iov_len > 0 ) last = ((const char *) pieces[i].iov_base)[pieces[i].iov_len - 1];
+        }
+
+        if ( buffered and total <= sizeof buffer - used ) {
+            for ( int i = 0; i < count; i++ ) {
+                memcpy(buffer + used, pieces[i].iov_base, pieces[i].iov_len);
+                used += pieces[i].iov_len;
+            }
+
+            return EXIT_SUCCESS;
+        }
+
+        return writePending(pieces, count);
+    }
+
+    /**
+     * Termina a linha atual, caso o último texto escrito não termine com '\n'.
+     * Utilizado entre os comandos quando não há prompt para separar as saídas.
+    */
+    void endLine() {
+        if ( last == '\n' ) return;
+
+        struct iovec newline = { (void *) "\n", 1 };
+        write(&newline, 1);
+    }
+
+    /**
+     * Escreve o conteúdo pendente do buffer.
+     * 
+     * @return status da operação
+    */
+    int flush() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return writePending(nullptr, 0);
+    }
+
+    private:
+
+    OutputBuffer(const int & fd) : fd(fd), terminal(isatty(fd)) {}
+
+    /**
+     * Escreve o conteúdo do buffer seguido dos trechos com writev,
+     * repetindo a escrita em caso de escritas parciais ou interrupções.
+     * O buffer é esvaziado mesmo em caso de falha.
+     * 
+     * @param[in] pieces Os trechos escritos após o buffer
+     * @param[in] count Quantidade de trechos
+     * @return status da operação
+    */
+    int writePending(const struct iovec *pieces, const int & count) {
+        std::vector<struct iovec> iov;
+
+        iov.reserve(count + 1);
+        if ( used > 0 ) iov.push_back({ buffer, used });
+
+        for ( int i = 0; i < count; i++ )
+            if ( pieces[i].iov_len > 0 ) iov.push_back(pieces[i]);
+
+        used = 0;
+
+        for ( size_t first = 0; first < iov.size(); ) {
+            ssize_t n = writev(fd, iov.data() + first, std::min<size_t>(iov.size() - first, IOV_MAX));
+
+            if ( n < 0 ) {
+                if ( errno == EINTR ) continue;
+                return WRITE_FAILURE;
+            }
+
+            // Descarta os trechos já escritos e avança dentro do trecho parcial
+            while ( first < iov.size() and (size_t) n >= iov[first].iov_len ) n -= iov[first++].iov_len;
+
+            if ( first < iov.size() ) {
+                iov[first].iov_base = (char *) iov[first].iov_base + n;
+                iov[first].iov_len -= n;
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int fd;
+    bool terminal;
+    bool buffered = true;
+    char last = '\n';          // Último caracter escrito
+    size_t used = 0;
+    char buffer[OUTPUT_BUFFER_SIZE];
+    std::mutex mutex;
+};
+
+/**
+ * Leitor de linhas da entrada de comandos (terminal, script ou texto de -c).
+ * 
+ * A entrada é lida em blocos grandes e as linhas são separadas no buffer,
+ * de forma que um script com muitos comandos custa poucas chamadas de
+ * sistema. No terminal, cada leitura retorna assim que uma linha é digitada.
+*/
+class LineReader {
+
+    public:
+
+    /**
+     * Contrutor
+     * 
+     * @param[in] fd Descritor de onde as linhas são lidas
+    */
+    explicit LineReader(const int & fd) : fd(fd) {
+        // Lendo da entrada padrão, os programas executados compartilham o descritor
+        shared = fd == STDIN_FILENO;
+        seekable = lseek(fd, 0, SEEK_CUR) >= 0;
+    }
+
+    /**
+     * Contrutor para um texto já disponível em memória.
+     * 
+     * @param[in] text O texto
+    */
+    explicit LineReader(const std::string & text) : fd(-1), buffer(text) {}
+
+    /**
+     * Obtém a próxima linha, sem o '\n' (e o '\r' de arquivos no formato DOS).
+     * 
+     * @param[out] line A linha obtida
+     * @return false quando a entrada termina sem mais nenhuma linha.
+    */
+    bool getLine(std::string & line) {
+        size_t end;
+
+        while ( ( end = buffer.find('\n', start) ) == std::string::npos ) {
+            if ( !fill() ) {
+                if ( start >= buffer.size() ) return false;
+                end = buffer.size();
+                break;
+            }
+        }
+
+        line.assign(buffer, start, end - start);
+        start = std::min(end + 1, buffer.size());
+
+        if ( !line.empty() and line.back() == '\r' ) line.pop_back();
+
+        return true;
+    }
+
+    /**
+     * Devolve à entrada padrão os bytes lidos antecipadamente, para que um
+     * comando que leia dela (e.g. "cat" ou um programa externo em um script
+     * passado pela entrada) comece logo após a linha atual. Em um arquivo,
+     * o descritor volta com lseek; em um pipe, que não permite isso, fill
+     * lê um byte por vez e nada é lido antecipadamente, como no bash.
+    */
+    void release() {
+        if ( !shared or !seekable or start >= buffer.size() ) return;
+
+        lseek(fd, -(off_t) ( buffer.size() - start ), SEEK_CUR);
+        buffer.clear();
+        start = 0;
+    }
+
+    private:
+
+    /**
+     * Lê o próximo bloco da entrada, descartando as linhas já consumidas.
+     * 
+     * @return false no fim da entrada ou em caso de falha.
+    */
+    bool fill() {
+        if ( fd < 0 ) return false;
+
+        buffer.erase(0, start);
+        start = 0;
+
+        size_t size = buffer.size();
+        size_t block = shared and !seekable ? 1 : INPUT_BUFFER_SIZE;
+        ssize_t n;
+
+        buffer.resize(size + block);
+
+        while ( ( n = read(fd, &buffer[size], block) ) < 0 and errno == EINTR );
+
+        buffer.resize(size + std::max<ssize_t>(n, 0));
+
+        return n > 0;
+    }
+
+    int fd;
+    std::string buffer;
+    size_t start = 0;
+    bool shared = false;            // O descritor é a entrada padrão dos comandos
+    bool seekable = false;
+};
+
+/**
+ * Escopos das funções responsáveis em executar
+ * os comandos disponíveis.
+*/
+namespace Runner {
+
+    /**
+     * Obtém o nome do usuário atual.
+     * 
+     * @return O nome do usuário. 
+    */
+    std::string getCurrentUser() {
+        const char *login = getlogin();
+
+        // Sem um terminal associado (e.g. em um container), utiliza o usuário efetivo
+        if ( login == nullptr ) {
+            struct passwd *pw = getpwuid(geteuid());
+            return pw != nullptr ? pw->pw_name : std::to_string(geteuid());
+        }
+
+        return login;
+    }
+    
+    /**
+     * Obtém o nome do dispositivo atual.
+     * 
+     * @return O nome do dispositivo. 
+    */
+    std::string getHostname() {
+        char $hostname[HOST_NAME_MAX + 1];
+        gethostname( $hostname, HOST_NAME_MAX + 1 ); 
+        return $hostname;
+    }
+
+    // Descritores de entrada e saída dos comandos internos executados pela thread atual
+    thread_local int inputFd = STDIN_FILENO;
+    thread_local int outputFd = STDOUT_FILENO;
+
+    /**
+     * Escreve todo o conteúdo de um buffer em um descritor de arquivo,
+     * repetindo a escrita em caso de escritas parciais ou interrupções.
+     * 
+     * @param[in] fd Descritor de destino
+     * @param[in] data Dados a serem escritos
+     * @param[in] size Quantidade de bytes
+     * @return status da operação
+    */
+    int writeAll(const int & fd, const char *data, size_t size) {
+        while ( size > 0 ) {
+            ssize_t nwritten = write(fd, data, size);
+
+            if ( nwritten < 0 ) {
+                if ( errno == EINTR ) continue;
+                return WRITE_FAILURE;
+            }
+
+            data += nwritten;
+            size -= nwritten;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Retorna um código de cor ANSI apenas quando a saída é um terminal.
+     * 
+     * @param[in] code O código da cor
+     * @return O código, ou um texto vazio.
+    */
+    const std::string & color(const std::string & code) {
+        static const std::string none;
+        return OutputBuffer::instance().isTerminal() ? code : none;
+    }
+
+    /**
+     * Apresenta um texto na tela.
+     * 
+     * O texto é acumulado no buffer da saída e só é exibido no próximo
+     * flush (veja OutputBuffer). Quando o comando é um estágio de um
+     * pipeline, o texto é escrito sem cores no pipe do próximo estágio
+     * e os erros vão para stderr.
+     * 
+     * @param[in] text Texto a ser mostrado. 
+     * @param[in] mode Modo de exibição
+    */
+    void display(const std::string & text, const char & mode = 'n') {
+
+        if ( outputFd != STDOUT_FILENO ) {
+            if ( mode == 'n' ) writeAll(outputFd, text.data(), text.size());
+            else if ( mode == 'e' ) {
+                std::string error = "ERROR: " + text + "\n";
+                writeAll(STDERR_FILENO, error.data(), error.size());
+            }
+            return;
+        }
+
+        if ( mode != 'n' and mode != 'e' ) return;
+
+        const std::string & code = color(mode == 'e' ? ANSI_COLOR_RED : ANSI_COLOR_RESET);
+        const char *prefix = mode == 'e' ? "ERROR: " : "";
+
+        struct iovec pieces[] = {
+            { (void *) code.data(), code.size() },
+            { (void *) prefix, strlen(prefix) },
+            { (void *) text.data(), text.size() }
+        };
+
+        OutputBuffer::instance().write(pieces, 3);
+    }
+
+    /**
+     * Exibe o conteúdo pendente do buffer da saída.
+    */
+    void flush() {
+        OutputBuffer::instance().flush();
+    }
+
+    /**
+     * Limpa a tela do shell.
+    */
+    void clear() {
+        if ( OutputBuffer::instance().isTerminal() ) display(CLEAR_CODE);
+    }
+
+    /**
+     * Obtém o diretório atual.
+     * 
+     * @return O diretório atual.
+    */
+    std::string getCurrentDirectory() {
+        char *current = get_current_dir_name();
+
+        if ( current == nullptr ) return ".";
+
+        std::string path = current;
+        free(current);
+
+        return path;
+    }
+
+    /// @brief Contadores de E/S do processo, obtidos de /proc/self/io
+    struct IoCounters {
+        uint64_t readBytes = 0;     // rchar
+        uint64_t writtenBytes = 0;  // wchar
+        uint64_t readCalls = 0;     // syscr
+        uint64_t writeCalls = 0;    // syscw
+    };
+
+    /**
+     * Lê os contadores de E/S do processo (todas as threads). O arquivo
+     * fica aberto e é relido com um único pread.
+     * 
+     * @param[out] counters Os contadores
+     * @return status da operação
+    */
+    int readIoCounters(IoCounters & counters) {
+        static int fd = open("/proc/self/io", O_RDONLY | O_CLOEXEC);
+        char buffer[512];
+
+        if ( fd < 0 ) return OPEN_FAILURE;
+
+        ssize_t n = pread(fd, buffer, sizeof buffer - 1, 0);
+
+        if ( n <= 0 ) return READ_FAILURE;
+
+        buffer[n] = '\0';
+
+        for ( char *line = buffer; line != nullptr and *line; line = strchr(line, '\n') ) {
+            if ( *line == '\n' ) line++;
+
+            char *value = strchr(line, ':');
+            if ( value == nullptr ) break;
+
+            uint64_t number = strtoull(value + 1, nullptr, 10);
+
+            if ( strncmp(line, "rchar:", 6) == 0 ) counters.readBytes = number;
+            else if ( strncmp(line, "wchar:", 6) == 0 ) counters.writtenBytes = number;
+            else if ( strncmp(line, "syscr:", 6) == 0 ) counters.readCalls = number;
+            else if ( strncmp(line, "syscw:", 6) == 0 ) counters.writeCalls = number;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Normaliza um caminho absoluto, resolvendo "." e ".." sem consultar o
+     * sistema de arquivos (como o caminho lógico do "cd" do bash).
+     * 
+     * @param[in] path Caminho absoluto
+     * @return O caminho normalizado.
+    */
+    std::string normalizePath(const std::string & path) {
+        std::vector<std::string> parts;
+        std::string result;
+
+        for ( auto & part: split(path, '/') ) {
+            if ( part.empty() or part == "." ) continue;
+
+            if ( part == ".." ) {
+                if ( !parts.empty() ) parts.pop_back();
+            }
+            else parts.push_back(part);
+        }
+
+        for ( auto & part: parts ) result += "/" + part;
+
+        return result.empty() ? "/" : result;
+    }
+
+    /**
+     * Altera o diretório atual para um camingo específico.
+     * 
+     * @param[in] path Caminho de destino
+     * @return Um valor negativo, caso não consiga alterar o diretório atual.
+     *         Caso contrário, a mudança foi realizada com sucesso.
+    */
+    int changeDirectory(const std::string & path) {
+        return chdir(path.c_str());
+    }
+
+
+    /// @brief Tamanho do buffer utilizado na leitura de diretórios com getdents64.
+    static const size_t DIRENT_BUFFER_SIZE = 64 * 1024;
+
+    /// @brief Memória ocupada pelos nomes a partir da qual a ordenação utiliza arquivos temporários.
+    static const size_t SORT_MEMORY_LIMIT = 64 * 1024 * 1024;
+
+    /// @brief Registro retornado pela chamada de sistema getdents64.
+    struct LinuxDirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[1];
+    };
+
+    /// @brief Função que recebe cada item lido de um diretório.
+    using EntryCallback = std::function<void(const char *name, const size_t & length,
+                                             const unsigned char & type, const uint64_t & inode)>;
+
+    /**
+     * Lê os itens de um diretório diretamente com getdents64, entregando
+     * cada item assim que o kernel o retorna, sem armazená-los.
+     * 
+     * @param[in] fd Descritor do diretório
+     * @param[in] all Flag que indica para obter todos os itens, inclusive os ocultos.
+     * @param[in] callback Função chamada para cada item
+     * @return status da operação
+    */
+    int readDirectoryEntries(const int & fd, const bool & all, const EntryCallback & callback) {
+        std::unique_ptr<char[]> buffer(new char[DIRENT_BUFFER_SIZE]);
+        long n;
+
+        while ( ( n = syscall(SYS_getdents64, fd, buffer.get(), DIRENT_BUFFER_SIZE) ) > 0 ) {
+            for ( long pos = 0; pos < n; ) {
+                auto *d = reinterpret_cast<LinuxDirent64 *>(buffer.get() + pos);
+                pos += d->d_reclen;
+
+                // Se arquivos ocultos são encontrados
+                if ( !all and d->d_name[0] == '.' )
+                    continue;
+
+                callback(d->d_name, strlen(d->d_name), d->d_type, d->d_ino);
+            }
+        }
+
+        return n < 0 ? READ_FAILURE : EXIT_SUCCESS;
+    }
+
+    /**
+     * Lê os itens de um diretório aberto para uma lista, sem ordená-los.
+     * 
+     * @param[in] fd Descritor do diretório
+     * @param[in] all Flag que indica para obter todos os itens, inclusive os ocultos.
+     * @param[out] listing A lista de itens
+     * @return status da operação
+    */
+    int readDirectory(const int & fd, const bool & all, DirListing & listing) {
+        bool full = false;
+
+        listing.clear();
+
+        int status = readDirectoryEntries(fd, all, [&](const char *name, const size_t & length,
+                                                       const unsigned char & type, const uint64_t & inode) {
+            full |= !listing.add(name, length, type, inode);
+        });
+
+        return full ? MALLOC_FAILURE : status;
+    }
+
+    /**
+     * Obtém os itens de um diretório, em ordem alfabética.
+     * 
+     * @param[in] path Caminho do diretório
+     * @param[out] listing A lista de itens
+     * @param[in] all Flag que indica para obter todos os itens, inclusive os ocultos.
+     * @return status da operação
+    */
+    int getItensOfDirectory(const std::string & path, DirListing & listing, const bool & all = false) {
+        TraceSpan span("getItensOfDirectory", path);
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if ( fd < 0 ) return OPEN_FAILURE;
+
+        int status = readDirectory(fd, all, listing);
+        close(fd);
+
+        if ( status == EXIT_SUCCESS ) listing.sort();
+
+        return status;
+    }
+
+    /**
+     * Lê os itens de um diretório sem ordená-los, entregando cada item
+     * assim que é lido.
+     * 
+     * @param[in] path Caminho do diretório
+     * @param[in] all Flag que indica para obter todos os itens, inclusive os ocultos.
+     * @param[in] callback Função chamada para cada item
+     * @return status da operação
+    */
+    int streamDirectory(const std::string & path, const bool & all, const EntryCallback & callback) {
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if ( fd < 0 ) return OPEN_FAILURE;
+
+        int status = readDirectoryEntries(fd, all, callback);
+        close(fd);
+
+        return status;
+    }
+
+    /**
+     * Ordena um bloco de itens e grava os seus nomes em um arquivo
+     * temporário, separados por '\0'.
+     * 
+     * @param[in, out] listing Os itens, esvaziados ao final
+     * @return O arquivo temporário, posicionado no início, ou nullptr em caso de falha.
+    */
+    FILE * writeSortedRun(DirListing & listing) {
+        FILE *run = tmpfile();
+
+        if ( run == nullptr ) return nullptr;
+
+        listing.sort();
+
+        for ( size_t i = 0; i < listing.size(); i++ )
+            fwrite(listing.name(i), 1, listing.length(i) + 1, run);
+
+        listing.clear();
+
+        if ( fflush(run) != 0 ) {
+            fclose(run);
+            return nullptr;
+        }
+
+        rewind(run);
+        return run;
+    }
+
+    /**
+     * Lê os itens de um diretório em ordem alfabética.
+     * 
+     * Enquanto os itens cabem em SORT_MEMORY_LIMIT, a ordenação é feita em
+     * memória. Acima desse limite, cada bloco é ordenado e gravado em um
+     * arquivo temporário, e os blocos são intercalados no final
+     * (merge sort externo), mantendo o uso de memória limitado.
+     * 
+     * @param[in] path Caminho do diretório
+     * @param[in] all Flag que indica para obter todos os itens, inclusive os ocultos.
+     * @param[in] callback Função chamada para cada item, em ordem
+     * @return status da operação
+    */
+    int listDirectorySorted(const std::string & path, const bool & all, const EntryCallback & callback) {
+        DirListing listing;
+        std::vector<FILE *> runs;
+        bool failed = false;
+
+        int status = streamDirectory(path, all, [&](const char *name, const size_t & length,
+                                                    const unsigned char & type, const uint64_t & inode) {
+            if ( failed ) return;
+
+            // A arena cheia também encerra o bloco atual
+            bool added = listing.add(name, length, type, inode);
+
+            if ( !added or listing.usedMemory() >= SORT_MEMORY_LIMIT ) {
+                FILE *run = writeSortedRun(listing);
+
+                if ( run == nullptr ) failed = true;
+                else runs.push_back(run);
+
+                if ( !added and !failed ) failed = !listing.add(name, length, type, inode);
+            }
+        });
+
+        if ( status == EXIT_SUCCESS and !failed and runs.empty() ) {
+            listing.sort();
+
+            for ( size_t i = 0; i < listing.size(); i++ )
+                callback(listing.name(i), listing.length(i), listing.type(i), listing.inode(i));
+
+            return EXIT_SUCCESS;
+        }
+
+        if ( status == EXIT_SUCCESS and !failed and !listing.empty() ) {
+            FILE *run = writeSortedRun(listing);
+
+            if ( run == nullptr ) failed = true;
+            else runs.push_back(run);
+        }
+
+        if ( status != EXIT_SUCCESS or failed ) {
+            for ( FILE *run: runs ) fclose(run);
+            return status != EXIT_SUCCESS ? status : WRITE_FAILURE;
+        }
+
+        // Intercala os blocos ordenados, mantendo o menor nome de cada bloco em um heap
+        using Head = std::pair<std::string, size_t>;
+        std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+        char *line = nullptr;
+        size_t capacity = 0;
+        ssize_t n;
+
+        for ( size_t i = 0; i < runs.size(); i++ )
+            if ( ( n = getdelim(&line, &capacity, '\0', runs[i]) ) > 0 )
+                heap.emplace(std::string(line, n - 1), i);
+
+        while ( !heap.empty() ) {
+            Head head = heap.top();
+            heap.pop();
+
+            callback(head.first.c_str(), head.first.size(), DT_UNKNOWN, 0);
+
+            if ( ( n = getdelim(&line, &capacity, '\0', runs[head.second]) ) > 0 )
+                heap.emplace(std::string(line, n - 1), head.second);
+        }
+
+        free(line);
+
+        for ( FILE *run: runs ) fclose(run);
+
+        return EXIT_SUCCESS;
+    }
+
+    /// @brief Metadados de um item de diretório, utilizados pela listagem longa.
+    struct EntryInfo {
+        std::string link;           // Destino do item, caso seja um link simbólico
+        struct statx stx;
+        bool valid = false;
+    };
+
+    /// @brief Quantidade de itens a partir da qual os metadados são obtidos em paralelo.
+    static const size_t PARALLEL_STAT_THRESHOLD = 1024;
+
+    /// @brief Quantidade de itens consultados por cada tarefa.
+    static const size_t STAT_BATCH_SIZE = 256;
+
+    /**
+     * Obtém o nome de um usuário a partir do seu uid.
+     * Os nomes ficam em cache, evitando uma consulta a getpwuid por item.
+     * O cache é protegido por um mutex, pois o ls pode executar em um
+     * estágio de pipeline enquanto outro estágio também o utiliza.
+     * 
+     * @param[in] uid O identificador do usuário
+     * @return O nome do usuário, ou o próprio uid caso não exista.
+    */
+    const std::string & getUserName(const uid_t & uid) {
+        static std::unordered_map<uid_t, std::string> cache;
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = cache.find(uid);
+        if ( it != cache.end() ) return it->second;
+
+        passwd *pw = getpwuid(uid);
+        return cache[uid] = pw ? pw->pw_name : std::to_string(uid);
+    }
+
+    /**
+     * Obtém o nome de um grupo a partir do seu gid.
+     * Os nomes ficam em cache, evitando uma consulta a getgrgid por item,
+     * protegido por um mutex como o de getUserName.
+     * 
+     * @param[in] gid O identificador do grupo
+     * @return O nome do grupo, ou o próprio gid caso não exista.
+    */
+    const std::string & getGroupName(const gid_t & gid) {
+        static std::unordered_map<gid_t, std::string> cache;
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = cache.find(gid);
+        if ( it != cache.end() ) return it->second;
+
+        group *gr = getgrgid(gid);
+        return cache[gid] = gr ? gr->gr_name : std::to_string(gid);
+    }
+
+    /**
+     * Converte o modo de um arquivo para o formato "drwxr-xr-x".
+     * 
+     * @param[in] mode O modo do arquivo
+     * @return O modo formatado.
+    */
+    std::string formatMode(const mode_t & mode) {
+        std::string s = "----------";
+
+        if ( S_ISDIR(mode) ) s[0] = 'd';
+        else if ( S_ISLNK(mode) ) s[0] = 'l';
+        else if ( S_ISCHR(mode) ) s[0] = 'c';
+        else if ( S_ISBLK(mode) ) s[0] = 'b';
+        else if ( S_ISFIFO(mode) ) s[0] = 'p';
+        else if ( S_ISSOCK(mode) ) s[0] = 's';
+
+        const char *rwx = "rwxrwxrwx";
+
+        for ( int i = 0; i < 9; i++ )
+            if ( mode & ( 0400 >> i ) ) s[i + 1] = rwx[i];
+
+        if ( mode & S_ISUID ) s[3] = ( mode & S_IXUSR ) ? 's' : 'S';
+        if ( mode & S_ISGID ) s[6] = ( mode & S_IXGRP ) ? 's' : 'S';
+        if ( mode & S_ISVTX ) s[9] = ( mode & S_IXOTH ) ? 't' : 'T';
+
+        return s;
+    }
+
+    /**
+     * Formata a data de modificação de um arquivo. Datas com mais de seis
+     * meses exibem o ano no lugar do horário.
+     * 
+     * @param[in] seconds Segundos desde a época Unix
+     * @return A data formatada.
+    */
+    std::string formatTime(const time_t & seconds) {
+        static const time_t sixMonths = 6 * 30 * 24 * 60 * 60;
+        time_t now = time(nullptr);
+        char buffer[32];
+        tm local;
+
+        localtime_r(&seconds, &local);
+
+        if ( seconds > now - sixMonths and seconds <= now + 60 )
+            strftime(buffer, sizeof buffer, "%b %e %H:%M", &local);
+        else
+            strftime(buffer, sizeof buffer, "%b %e  %Y", &local);
+
+        return buffer;
+    }
+
+    /**
+     * Obtém os metadados dos itens de um diretório.
+     * 
+     * Os metadados são obtidos com statx relativo ao descritor do diretório,
+     * solicitando apenas os campos exibidos. Em diretórios grandes, as
+     * chamadas são divididas em lotes executados em paralelo, o que reduz
+     * o tempo em sistemas de arquivos de rede, onde cada chamada espera
+     * pelo servidor.
+     * 
+     * @param[in] path Caminho do diretório
+     * @param[in] all Flag que indica para obter todos os itens, inclusive os ocultos.
+     * @param[in] sorted Flag que indica para ordenar os itens; caso contrário, mantém a ordem do diretório
+     * @param[out] listing Os itens, em ordem alfabética ou na ordem do diretório
+     * @param[out] entries Os metadados de cada item da lista
+     * @return status da operação
+    */
+    int getLongListing(const std::string & path, const bool & all, const bool & sorted, DirListing & listing,
+                       std::vector<EntryInfo> & entries) {
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if ( fd < 0 ) return OPEN_FAILURE;
+
+        int status = readDirectory(fd, all, listing);
+
+        if ( status != EXIT_SUCCESS ) {
+            close(fd);
+            return status;
+        }
+
+        if ( sorted ) listing.sort();
+        entries.assign(listing.size(), EntryInfo());
+
+        const unsigned mask = STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_UID | STATX_GID |
+                              STATX_SIZE | STATX_MTIME | STATX_BLOCKS;
+
+        auto statBatch = [&listing, &entries, fd, mask](size_t begin, size_t end) {
+            for ( size_t i = begin; i < end; i++ ) {
+                EntryInfo & entry = entries[i];
+                entry.valid = statx(fd, listing.name(i), AT_SYMLINK_NOFOLLOW, mask, &entry.stx) == 0;
+
+                if ( entry.valid and S_ISLNK(entry.stx.stx_mode) ) {
+                    char link[PATH_MAX];
+                    ssize_t n = readlinkat(fd, listing.name(i), link, sizeof link);
+                    if ( n > 0 ) entry.link.assign(link, n);
+                }
+            }
+        };
+
+        if ( entries.size() < PARALLEL_STAT_THRESHOLD ) statBatch(0, entries.size());
+        else {
+            ThreadPool pool;
+
+            for ( size_t i = 0; i < entries.size(); i += STAT_BATCH_SIZE )
+                pool.submit([&statBatch, i, &entries] { statBatch(i, std::min(i + STAT_BATCH_SIZE, entries.size())); });
+
+            pool.wait();
+        }
+
+        close(fd);
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Formata os itens de um diretório no formato de listagem longa:
+     * modo, links, dono, grupo, tamanho, data de modificação e nome.
+     * 
+     * @param[in] listing Os itens
+     * @param[in] entries Os metadados de cada item da lista
+     * @return A listagem formatada.
+    */
+    std::string formatLongListing(const DirListing & listing, const std::vector<EntryInfo> & entries) {
+        size_t linksWidth = 1, userWidth = 1, groupWidth = 1, sizeWidth = 1;
+        unsigned long long blocks = 0;
+
+        for ( auto & entry: entries ) {
+            if ( !entry.valid ) continue;
+
+            linksWidth = std::max(linksWidth, std::to_string(entry.stx.stx_nlink).size());
+            userWidth = std::max(userWidth, getUserName(entry.stx.stx_uid).size());
+            groupWidth = std::max(groupWidth, getGroupName(entry.stx.stx_gid).size());
+            sizeWidth = std::max(sizeWidth, std::to_string(entry.stx.stx_size).size());
+            blocks += entry.stx.stx_blocks;
+        }
+
+        std::stringstream ss;
+
+        ss << "total " << blocks / 2 << '\n';
+
+        for ( size_t i = 0; i < entries.size(); i++ ) {
+            const EntryInfo & entry = entries[i];
+
+            if ( !entry.valid ) {
+                ss << "?????????? " << listing.name(i) << '\n';
+                continue;
+            }
+
+            const struct statx & stx = entry.stx;
+
+            ss << formatMode(stx.stx_mode) << ' ';
+            ss << std::right << std::setw(linksWidth) << stx.stx_nlink << ' ';
+            ss << std::left << std::setw(userWidth) << getUserName(stx.stx_uid) << ' ';
+            ss << std::left << std::setw(groupWidth) << getGroupName(stx.stx_gid) << ' ';
+            ss << std::right << std::setw(sizeWidth) << stx.stx_size << ' ';
+            ss << formatTime(stx.stx_mtime.tv_sec) << ' ' << listing.name(i);
+
+            if ( !entry.link.empty() ) ss << " -> " << entry.link;
+
+            ss << '\n';
+        }
+
+        return ss.str();
+    }
+
+    /**
+     * Obtém o conteúdo de um arquivo
+     * 
+     * O arquivo é lido em blocos de tamanho fixo, de forma que pipes,
+     * arquivos especiais e arquivos vazios também são suportados.
+     * 
+     * @param[in] file Caminho do arquivo
+     * @param[in, out] content String que conterá o conteúdo do arquivo
+     * @return status da operação
+    */
+    int getFileContent(const std::string & file, std::string & content) {
+        TraceSpan span("getFileContent", file);
+        int fd = open(file.c_str(), O_RDONLY);
+        char buffer[STREAM_BUFFER_SIZE];
+        ssize_t nread;
+
+        if ( fd < 0 ) return OPEN_FAILURE;
+
+        content.clear();
+
+        while ( ( nread = read(fd, buffer, sizeof buffer) ) != 0 ) {
+            if ( nread < 0 ) {
+                if ( errno == EINTR ) continue;
+                close(fd);
+                return READ_FAILURE;
+            }
+
+            content.append(buffer, nread);
+        }
+
+        close(fd);
+        span.setBytes(content.size());
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Envia todo o conteúdo de um descritor de entrada para um descritor de saída.
+     * 
+     * A cópia é feita pelo kernel sempre que possível: sendfile para
+     * arquivos regulares e splice quando a entrada ou a saída é um pipe.
+     * Nos demais casos, os dados são lidos e escritos em blocos de tamanho
+     * fixo. Assim, o consumo de memória não depende do tamanho dos dados e
+     * a saída começa imediatamente.
+     * 
+     * @param[in] fd Descritor de entrada
+     * @param[in] out Descritor de saída
+     * @return status da operação
+    */
+    int streamDescriptor(const int & fd, const int & out) {
+        struct stat st, outSt;
+        ssize_t n;
+
+        if ( fstat(fd, &st) < 0 or fstat(out, &outSt) < 0 ) return READ_FAILURE;
+
+        // Cópia dentro do kernel, sem passar pelo espaço do usuário
+        if ( S_ISREG(st.st_mode) or S_ISFIFO(st.st_mode) or S_ISFIFO(outSt.st_mode) ) {
+            do {
+                if ( S_ISREG(st.st_mode) ) n = sendfile(out, fd, nullptr, STREAM_CHUNK_SIZE);
+                else n = splice(fd, nullptr, out, nullptr, STREAM_CHUNK_SIZE, SPLICE_F_MOVE);
+            } while ( n > 0 or ( n < 0 and errno == EINTR ) );
+
+            if ( n == 0 ) return EXIT_SUCCESS;
+
+            // A saída não suporta a operação, utiliza a cópia em blocos
+            if ( errno != EINVAL and errno != ENOSYS ) return errno == EPIPE ? WRITE_FAILURE : READ_FAILURE;
+        }
+
+        char buffer[STREAM_BUFFER_SIZE];
+
+        while ( ( n = read(fd, buffer, sizeof buffer) ) != 0 ) {
+            if ( n < 0 ) {
+                if ( errno == EINTR ) continue;
+                return READ_FAILURE;
+            }
+
+            if ( writeAll(out, buffer, n) != EXIT_SUCCESS ) return WRITE_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Envia o conteúdo de um arquivo para um descritor de saída.
+     * 
+     * @param[in] file Caminho do arquivo
+     * @param[in] out Descritor de saída
+     * @return status da operação
+    */
+    int streamFileContent(const std::string & file, const int & out) {
+        TraceSpan span("streamFileContent", file);
+        int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+        if ( fd < 0 ) return OPEN_FAILURE;
+
+        int status = streamDescriptor(fd, out);
+        close(fd);
+
+        return status;
+    }
+
+     /**
+     * Gera um arquivo em branco com um determinado nome
+     * 
+     * @param[in] filename Nome do arquivo a ser criado
+     * @return status da operação
+    */
+    int createBlankFile(const std::string & filename) {
+        mode_t mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+        int fd = open(filename.c_str(), O_WRONLY | O_CREAT, mode);
+
+        if ( fd < 0 ) return OPEN_FAILURE;
+        close(fd);
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Copia um intervalo de bytes entre dois arquivos.
+     * 
+     * Utiliza copy_file_range para que a cópia ocorra dentro do kernel.
+     * Caso o sistema de arquivos não suporte a operação, os dados são
+     * copiados com pread/pwrite em blocos de tamanho fixo.
+     * 
+     * @param[in] in Descritor do arquivo de origem
+     * @param[in] out Descritor do arquivo de destino
+     * @param[in] offset Posição inicial do intervalo
+     * @param[in] length Quantidade de bytes do intervalo
+     * @return status da operação
+    */
+    int copyFileRange(const int & in, const int & out, off_t offset, off_t length) {
+        off_t end = offset + length;
+        ssize_t n = 0;
+
+        while ( offset < end ) {
+            loff_t inOffset = offset, outOffset = offset;
+            n = copy_file_range(in, &inOffset, out, &outOffset, end - offset, 0);
+
+            if ( n <= 0 ) break;
+            offset += n;
+        }
+
+        if ( offset >= end ) return EXIT_SUCCESS;
+
+        // O arquivo foi truncado durante a cópia
+        if ( n == 0 ) return READ_FAILURE;
+
+        if ( errno != EXDEV and errno != EINVAL and errno != ENOSYS and
+             errno != EOPNOTSUPP and errno != EINTR )
+            return errno == EBADF ? READ_FAILURE : WRITE_FAILURE;
+
+        char buffer[STREAM_BUFFER_SIZE];
+
+        while ( offset < end ) {
+            n = pread(in, buffer, std::min<off_t>(sizeof buffer, end - offset), offset);
+
+            if ( n < 0 and errno == EINTR ) continue;
+            if ( n <= 0 ) return READ_FAILURE;
+
+            for ( ssize_t done = 0; done < n; ) {
+                ssize_t w = pwrite(out, buffer + done, n - done, offset + done);
+
+                if ( w < 0 and errno == EINTR ) continue;
+                if ( w <= 0 ) return WRITE_FAILURE;
+                done += w;
+            }
+
+            offset += n;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Copia os dados de um arquivo aberto em outro.
+     * 
+     * A cópia é tentada do método mais barato para o mais caro:
+     * reflink (FICLONE), que apenas compartilha os blocos em sistemas
+     * de arquivos como XFS e btrfs; copy_file_range; e por fim leitura
+     * e escrita em blocos. Os buracos de arquivos esparsos são
+     * preservados ao copiar apenas as regiões com dados (SEEK_DATA/SEEK_HOLE).
+     * 
+     * @param[in] in Descritor do arquivo de origem
+     * @param[in] out Descritor do arquivo de destino, vazio
+     * @param[in] st Informações do arquivo de origem
+     * @return status da operação
+    */
+    int copyFileData(const int & in, const int & out, const struct stat & st) {
+
+        // Arquivos especiais (pipes, dispositivos) não possuem tamanho conhecido
+        if ( not S_ISREG(st.st_mode) ) {
+            char buffer[STREAM_BUFFER_SIZE];
+            ssize_t n;
+
+            while ( ( n = read(in, buffer, sizeof buffer) ) != 0 ) {
+                if ( n < 0 ) {
+                    if ( errno == EINTR ) continue;
+                    return READ_FAILURE;
+                }
+
+                if ( writeAll(out, buffer, n) != EXIT_SUCCESS ) return WRITE_FAILURE;
+            }
+
+            return EXIT_SUCCESS;
+        }
+
+        if ( ioctl(out, FICLONE, in) == 0 ) return EXIT_SUCCESS;
+
+        off_t size = st.st_size, offset = 0;
+
+        while ( offset < size ) {
+            off_t data = lseek(in, offset, SEEK_DATA), hole;
+
+            if ( data < 0 ) {
+                // Não há mais dados, apenas um buraco até o fim do arquivo
+                if ( errno == ENXIO ) break;
+
+                // O sistema de arquivos não informa os buracos
+                data = offset, hole = size;
+            } else if ( ( hole = lseek(in, data, SEEK_HOLE) ) < 0 or hole > size )
+                hole = size;
+
+            int status = copyFileRange(in, out, data, hole - data);
+            if ( status != EXIT_SUCCESS ) return status;
+
+            offset = hole;
+        }
+
+        // Estende o destino caso o arquivo termine com um buraco
+        if ( ftruncate(out, size) < 0 ) return WRITE_FAILURE;
+
+        return EXIT_SUCCESS;
+    }
+
+     /**
+     * Copia o conteúdo de um arquivo em outro arquivo.
+     * 
+     * A origem precisa ser um arquivo regular. O destino é truncado e
+     * recebe as permissões da origem, sem os bits setuid, setgid e sticky;
+     * apenas o mv, que também preserva o dono (copyMetadata), os mantém.
+     * 
+     * @param[in] source Arquivo de origem
+     * @param[in] target Arquivo de destino
+     * @param[out] copied Quantidade de bytes copiados (opcional)
+     * @return status da operação
+    */
+    int copyContentFile(const std::string & source, const std::string & target, off_t *copied = nullptr) {
+        TraceSpan span("copyContentFile", source);
+        struct stat sourceSt, targetSt;
+
+        // O_NONBLOCK evita que a abertura de um pipe nomeado aguarde um escritor
+        int in = open(source.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+
+        if ( in < 0 ) return OPEN_FAILURE;
+
+        // O destino só é truncado depois de confirmar que a origem é um arquivo legível
+        if ( fstat(in, &sourceSt) < 0 or not S_ISREG(sourceSt.st_mode) ) {
+            close(in);
+            return READ_FAILURE;
+        }
+
+        // Abrir o destino com O_TRUNC apagaria a própria origem
+        if ( stat(target.c_str(), &targetSt) == 0 and targetSt.st_dev == sourceSt.st_dev
+             and targetSt.st_ino == sourceSt.st_ino ) {
+            close(in);
+            return SAME_FILE;
+        }
+
+        // Sem preservar o dono, os bits setuid, setgid e sticky não são copiados, como no cp
+        int out = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, sourceSt.st_mode & 0777);
+
+        if ( out < 0 ) {
+            close(in);
+            return WRITE_FAILURE;
+        }
+
+        int status = copyFileData(in, out, sourceSt);
+
+        // Preserva as permissões mesmo quando o destino já existia
+        if ( status == EXIT_SUCCESS and fchmod(out, sourceSt.st_mode & 0777) < 0 )
+            status = WRITE_FAILURE;
+
+        close(in);
+
+        if ( close(out) < 0 and status == EXIT_SUCCESS ) status = WRITE_FAILURE;
+
+        if ( status == EXIT_SUCCESS ) span.setBytes(sourceSt.st_size);
+        if ( copied != nullptr and status == EXIT_SUCCESS ) *copied = sourceSt.st_size;
+
+        return status;
+    }
+
+    /**
+     * Obtém o último componente de um caminho.
+     * 
+     * @param[in] path O caminho
+     * @return O nome do arquivo ou diretório.
+    */
+    std::string getBaseName(std::string path) {
+        while ( path.size() > 1 and path.back() == '/' ) path.pop_back();
+
+        size_t pos = path.rfind('/');
+        return pos == std::string::npos ? path : path.substr(pos + 1);
+    }
+
+    /**
+     * Verifica se um caminho, existente ou não, fica dentro de um diretório.
+     * O diretório pai do caminho precisa existir.
+     * 
+     * @param[in] path O caminho verificado
+     * @param[in] directory O diretório
+     * @return true caso o caminho seja o próprio diretório ou esteja dentro dele
+    */
+    bool isInside(const std::string & path, const std::string & directory) {
+        char resolved[PATH_MAX];
+        size_t pos = path.rfind('/');
+        std::string parent = pos == std::string::npos ? "." : pos == 0 ? "/" : path.substr(0, pos);
+
+        if ( realpath(directory.c_str(), resolved) == nullptr ) return false;
+
+        std::string root = std::string(resolved) + "/";
+
+        if ( realpath(parent.c_str(), resolved) == nullptr ) return false;
+
+        std::string full = std::string(resolved) + "/" + ( pos == std::string::npos ? path : path.substr(pos + 1) ) + "/";
+
+        return full.compare(0, root.size(), root) == 0;
+    }
+
+    /// @brief Contadores de uma cópia recursiva, atualizados pelas threads.
+    struct CopyStats {
+        std::atomic<size_t> files { 0 };
+        std::atomic<size_t> directories { 0 };
+        std::atomic<size_t> bytes { 0 };
+        std::atomic<size_t> failures { 0 };
+        std::atomic<size_t> skipped { 0 };      // Arquivos já copiados por uma movimentação interrompida
+
+        /// @brief Indica uma cópia feita por mv entre sistemas de arquivos, que preserva os metadados.
+        bool move = false;
+
+        /// @brief Indica a retomada de uma movimentação interrompida, cujo destino foi criado por ela.
+        bool resuming = false;
+
+        /// @brief Diretórios criados cujas permissões (e, em uma movimentação, dono e datas) são aplicadas após a cópia.
+        std::vector<std::pair<std::string, struct stat>> createdDirectories;
+        std::mutex mutex;
+    };
+
+    /**
+     * Aplica o dono, as permissões e as datas de um arquivo em outro.
+     * A troca de dono é ignorada quando o usuário não tem permissão.
+     * 
+     * @param[in] path Caminho do arquivo de destino
+     * @param[in] st Informações do arquivo de origem
+     * @return status da operação
+    */
+    int copyMetadata(const std::string & path, const struct stat & st) {
+        const timespec times[2] = { st.st_atim, st.st_mtim };
+
+        if ( lchown(path.c_str(), st.st_uid, st.st_gid) < 0 and errno != EPERM ) return WRITE_FAILURE;
+
+        if ( not S_ISLNK(st.st_mode) and chmod(path.c_str(), st.st_mode & 07777) < 0 ) return WRITE_FAILURE;
+
+        if ( utimensat(AT_FDCWD, path.c_str(), times, AT_SYMLINK_NOFOLLOW) < 0 ) return WRITE_FAILURE;
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Copia um arquivo para outro sistema de arquivos, como parte de um mv.
+     * 
+     * O conteúdo é gravado em "<destino>.mvpart" e renomeado para o destino
+     * apenas depois de completo e com os metadados da origem. Assim, ao
+     * retomar uma movimentação interrompida, um destino com o mesmo tamanho
+     * e data de modificação da origem já foi copiado e é ignorado. Fora de
+     * uma retomada, o destino é sempre substituído. Pipes, sockets e
+     * dispositivos são recriados com mknod, sem ler o seu conteúdo.
+     * 
+     * @param[in] source Arquivo de origem
+     * @param[in] target Arquivo de destino
+     * @param[in, out] stats Contadores da cópia
+     * @return status da operação
+    */
+    int copyFileForMove(const std::string & source, const std::string & target, CopyStats & stats) {
+        TraceSpan span("copyFileForMove", source);
+        struct stat sourceSt, targetSt;
+        int in = -1;
+
+        if ( lstat(source.c_str(), &sourceSt) < 0 ) return OPEN_FAILURE;
+
+        // Apenas arquivos comuns são abertos; o O_NONBLOCK evita o bloqueio caso a origem vire um pipe
+        if ( S_ISREG(sourceSt.st_mode) ) {
+            if ( ( in = open(source.c_str(), O_RDONLY | O_NONBLOCK | O_NOFOLLOW | O_CLOEXEC) ) < 0 ) return OPEN_FAILURE;
+
+            if ( fstat(in, &sourceSt) < 0 or not S_ISREG(sourceSt.st_mode) ) {
+                close(in);
+                return READ_FAILURE;
+            }
+        }
+
+        if ( stats.resuming and lstat(target.c_str(), &targetSt) == 0 and targetSt.st_size == sourceSt.st_size and
+             targetSt.st_mtim.tv_sec == sourceSt.st_mtim.tv_sec and
+             targetSt.st_mtim.tv_nsec == sourceSt.st_mtim.tv_nsec ) {
+            if ( in >= 0 ) close(in);
+            stats.skipped++;
+            return EXIT_SUCCESS;
+        }
+
+        std::string temporary = target + ".mvpart";
+        int status = EXIT_SUCCESS;
+
+        if ( in < 0 ) {
+            unlink(temporary.c_str());
+
+            if ( mknod(temporary.c_str(), sourceSt.st_mode & ( S_IFMT | 0777 ), sourceSt.st_rdev) < 0 ) return WRITE_FAILURE;
+            sourceSt.st_size = 0;
+        }
+        else {
+            int out = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+            if ( out < 0 ) {
+                close(in);
+                return WRITE_FAILURE;
+            }
+
+            status = copyFileData(in, out, sourceSt);
+
+            close(in);
+
+            if ( close(out) < 0 and status == EXIT_SUCCESS ) status = WRITE_FAILURE;
+        }
+
+        if ( status == EXIT_SUCCESS ) status = copyMetadata(temporary, sourceSt);
+
+        if ( status == EXIT_SUCCESS and rename(temporary.c_str(), target.c_str()) < 0 ) status = WRITE_FAILURE;
+
+        if ( status != EXIT_SUCCESS ) unlink(temporary.c_str());
+        else stats.files++, stats.bytes += sourceSt.st_size, span.setBytes(sourceSt.st_size);
+
+        return status;
+    }
+
+    /**
+     * Recria um link simbólico. Em uma movimentação, as datas e o dono
+     * do link também são preservados.
+     * 
+     * @param[in] source Link de origem
+     * @param[in] target Caminho do novo link
+     * @param[in, out] stats Contadores da cópia
+     * @return status da operação
+    */
+    int copySymbolicLink(const std::string & source, const std::string & target, CopyStats & stats) {
+        char link[PATH_MAX];
+        ssize_t n = readlink(source.c_str(), link, sizeof link - 1);
+        struct stat st;
+
+        if ( n < 0 ) return READ_FAILURE;
+
+        link[n] = '\0';
+
+        if ( symlink(link, target.c_str()) < 0 and errno != EEXIST ) return WRITE_FAILURE;
+
+        if ( stats.move and ( lstat(source.c_str(), &st) < 0 or copyMetadata(target, st) != EXIT_SUCCESS ) )
+            return WRITE_FAILURE;
+
+        stats.files++;
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Copia recursivamente um diretório.
+     * 
+     * O diretório de destino é criado e cada item da origem vira uma
+     * tarefa no conjunto de threads: arquivos são copiados com
+     * copyContentFile e subdiretórios repetem este processo. A função
+     * retorna após a leitura do diretório; o fim da cópia deve ser
+     * aguardado com ThreadPool::wait.
+     * 
+     * @param[in] pool Conjunto de threads que executará as cópias
+     * @param[in] source Diretório de origem
+     * @param[in] target Diretório de destino
+     * @param[in] sourceSt Informações do diretório de origem
+     * @param[in, out] stats Contadores da cópia
+    */
+    void copyDirectory(ThreadPool & pool, const std::string & source, const std::string & target,
+                       const struct stat & sourceSt, CopyStats & stats) {
+        TraceSpan span("copyDirectory", source);
+
+        // O dono precisa de acesso ao diretório para copiar o seu conteúdo; as permissões exatas vêm depois
+        bool created = mkdir(target.c_str(), ( sourceSt.st_mode & 0777 ) | S_IRWXU) == 0;
+
+        if ( !created and errno != EEXIST ) {
+            stats.failures++;
+            return;
+        }
+
+        if ( stats.move or created ) {
+            std::lock_guard<std::mutex> lock(stats.mutex);
+            stats.createdDirectories.emplace_back(target, sourceSt);
+        }
+
+        DirListing listing;
+        int fd = open(source.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if ( fd < 0 or readDirectory(fd, true, listing) != EXIT_SUCCESS ) {
+            if ( fd >= 0 ) close(fd);
+            stats.failures++;
+            return;
+        }
+
+        close(fd);
+        stats.directories++;
+
+        struct stat st;
+
+        for ( size_t i = 0; i < listing.size(); i++ ) {
+            const char *name = listing.name(i);
+
+            if ( !strcmp(name, ".") or !strcmp(name, "..") )
+                continue;
+
+            std::string src = source + "/" + name;
+            std::string dst = target + "/" + name;
+            unsigned char type = listing.type(i);
+
+            // As permissões do subdiretório são necessárias para criá-lo
+            if ( type == DT_UNKNOWN or type == DT_DIR ) {
+                if ( lstat(src.c_str(), &st) < 0 ) {
+                    stats.failures++;
+                    continue;
+                }
+
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG
+                     : S_ISLNK(st.st_mode) ? DT_LNK : DT_UNKNOWN;
+            }
+
+            if ( type == DT_DIR )
+                pool.submit([&pool, src, dst, st, &stats] { copyDirectory(pool, src, dst, st, stats); });
+            else if ( type == DT_REG ) {
+                pool.submit([src, dst, &stats] {
+                    off_t size = 0;
+
+                    if ( stats.move ) {
+                        if ( copyFileForMove(src, dst, stats) != EXIT_SUCCESS ) stats.failures++;
+                    }
+                    else if ( copyContentFile(src, dst, &size) != EXIT_SUCCESS ) stats.failures++;
+                    else stats.files++, stats.bytes += size;
+                });
+            }
+            else if ( type == DT_LNK ) {
+                if ( copySymbolicLink(src, dst, stats) != EXIT_SUCCESS ) stats.failures++;
+            }
+
+            // Dispositivos, pipes e sockets só são recriados em uma movimentação
+            else if ( stats.move ) {
+                if ( copyFileForMove(src, dst, stats) != EXIT_SUCCESS ) stats.failures++;
+            }
+            else stats.failures++;
+        }
+    }
+
+    /**
+     * Aplica as permissões da origem aos diretórios criados por uma cópia,
+     * depois que o seu conteúdo foi copiado. Assim como nos arquivos, os
+     * bits setuid, setgid e sticky não são copiados. Os subdiretórios são
+     * tratados antes dos pais, que podem não permitir o acesso a eles.
+     * 
+     * @param[in] stats Contadores da cópia, já concluída
+     * @return status da operação
+    */
+    int restoreDirectoryModes(CopyStats & stats) {
+        int status = EXIT_SUCCESS;
+
+        for ( auto directory = stats.createdDirectories.rbegin(); directory != stats.createdDirectories.rend(); directory++ )
+            if ( chmod(directory->first.c_str(), directory->second.st_mode & 0777) < 0 ) status = WRITE_FAILURE;
+
+        stats.createdDirectories.clear();
+
+        return status;
+    }
+
+    /**
+     * Copia um arquivo ou, recursivamente, um diretório.
+     * 
+     * Caso a origem seja um diretório, a cópia é distribuída entre as
+     * threads do conjunto e deve ser aguardada com ThreadPool::wait, e
+     * as permissões dos diretórios aplicadas com restoreDirectoryModes.
+     * 
+     * @param[in] pool Conjunto de threads que executará as cópias
+     * @param[in] source Arquivo ou diretório de origem
+     * @param[in] target Caminho de destino
+     * @param[in, out] stats Contadores da cópia
+     * @return status da operação
+    */
+    int copyTree(ThreadPool & pool, const std::string & source, const std::string & target, CopyStats & stats) {
+        struct stat st;
+
+        // Uma movimentação leva o próprio link simbólico, e não o arquivo apontado
+        if ( ( stats.move ? lstat(source.c_str(), &st) : stat(source.c_str(), &st) ) < 0 ) return OPEN_FAILURE;
+
+        if ( S_ISLNK(st.st_mode) ) return copySymbolicLink(source, target, stats);
+
+        if ( stats.move and not S_ISDIR(st.st_mode) ) return copyFileForMove(source, target, stats);
+
+        if ( not S_ISDIR(st.st_mode) ) {
+            off_t size = 0;
+            int status = copyContentFile(source, target, &size);
+
+            if ( status == EXIT_SUCCESS ) stats.files++, stats.bytes += size;
+            return status;
+        }
+
+        pool.submit([&pool, source, target, st, &stats] { copyDirectory(pool, source, target, st, stats); });
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Gera um diretório.
+     * 
+     * @param[in] path Caminho do diretório
+     * @return status da operação
+    */
+    int createDirectory(std::string & path) {
+        std::string p = "./";
+        int status = -1;
+
+        if ( path[0] == '/' or ( path[0] == '.' and path[1] == '/' ) )
+            p = "";
+
+        for ( auto &str: split(path, '/') ) {
+            p += str + "/";
+            status = mkdir(p.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+        }
+
+        if ( status < 0 ) return EXIT_FAILURE;
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Exclui um arquivo.
+     * 
+     * @param[in] path Caminho do arquivo
+     * @return status da operação
+    */
+    int removeFile(std::string & path) {
+
+        if ( not (path[0] == '/' or ( path[0] == '.' and path[1] == '/') ) )
+            path = "./" + path;
+
+        if ( !unlink(path.c_str())) return EXIT_SUCCESS;
+        else return EXIT_FAILURE;   
+    }
+
+    /**
+     * Verifica se um diretório está vazio, lendo no máximo três entradas.
+     * 
+     * @param[in] path Caminho do diretório
+     * @return true caso o diretório contenha apenas "." e "..".
+    */
+    bool isDirectoryEmpty(const std::string & path) {
+        DIR *dir = opendir(path.c_str());
+        int count = 0;
+
+        if ( dir == nullptr ) return true;
+
+        while ( count <= 2 and readdir(dir) != nullptr ) count++;
+
+        closedir(dir);
+
+        return count <= 2;
+    }
+
+    /// @brief Remoção de uma árvore de diretórios em andamento
+    struct RemoveTree {
+        std::string path;
+        std::atomic<int> status { EXIT_SUCCESS };
+        std::atomic<long> openDirectories { 0 };    // Descritores mantidos abertos pelos nós
+        long maxOpenDirectories;
+    };
+
+    /**
+     * Diretório em remoção. 
+     * 
+     * Enquanto houver vagas em REMOVE_OPEN_DIRECTORIES, o nó mantém o seu
+     * descritor aberto até o fim da remoção, e os subdiretórios são
+     * abertos e removidos relativos a ele. Sem vaga, o descritor é fechado
+     * após a leitura e reaberto quando necessário a partir do ancestral
+     * aberto mais próximo, conferindo o dispositivo e o inode. Assim, a
+     * quantidade de descritores abertos não cresce com a árvore e nenhum
+     * caminho completo é montado, mesmo além de PATH_MAX.
+    */
+    struct RemoveNode {
+        RemoveNode *parent;
+        std::string name;
+        int fd = -1;                          // Definido antes do envio dos subdiretórios e fechado ao fim
+        dev_t dev = 0;
+        ino_t ino = 0;
+        std::atomic<size_t> pending { 1 };    // Subdiretórios em remoção, mais a leitura do próprio diretório
+        RemoveTree *tree;
+
+        RemoveNode(RemoveNode *parent, std::string name, RemoveTree *tree)
+            : parent(parent), name(std::move(name)), tree(tree) {}
+    };
+
+    /**
+     * Abre um diretório em remoção, relativo ao ancestral aberto mais
+     * próximo. Os diretórios intermediários são abertos um a um com
+     * O_NOFOLLOW e fechados logo em seguida.
+     * 
+     * @param[in] node O diretório
+     * @return Um novo descritor, que deve ser fechado por quem chamou, ou -1.
+    */
+    int openRemoveNode(RemoveNode *node) {
+        std::vector<RemoveNode *> chain;
+        RemoveNode *ancestor = node;
+
+        for ( ; ancestor != nullptr and ancestor->fd < 0; ancestor = ancestor->parent ) chain.push_back(ancestor);
+
+        int fd = ancestor != nullptr ? ancestor->fd : -1;
+        bool owned = false;
+
+        for ( size_t i = chain.size(); i-- > 0; ) {
+            RemoveNode *current = chain[i];
+            int next = current->parent == nullptr
+                       ? open(current->tree->path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)
+                       : openat(fd, current->name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+            if ( owned ) close(fd);
+            if ( next < 0 ) return -1;
+
+            fd = next;
+            owned = true;
+
+            // Um diretório reaberto deve ser o mesmo lido anteriormente
+            struct stat st;
+
+            if ( current->ino != 0 and ( fstat(fd, &st) < 0 or st.st_dev != current->dev or st.st_ino != current->ino ) ) {
+                close(fd);
+                return -1;
+            }
+        }
+
+        return owned ? fd : dup(fd);
+    }
+
+    /**
+     * Conclui uma etapa da remoção de um diretório. Quando não há mais
+     * etapas pendentes, o descritor do diretório é fechado, o diretório
+     * vazio é removido com unlinkat relativo ao pai e o pai é notificado.
+     * 
+     * @param[in] node O diretório
+    */
+    void finishRemoveNode(RemoveNode *node) {
+        while ( node != nullptr and --node->pending == 0 ) {
+            RemoveNode *parent = node->parent;
+            RemoveTree *tree = node->tree;
+
+            if ( node->fd >= 0 ) {
+                close(node->fd);
+                tree->openDirectories--;
+            }
+
+            int status = -1;
+
+            if ( parent == nullptr ) status = rmdir(tree->path.c_str());
+            else if ( parent->fd >= 0 ) status = unlinkat(parent->fd, node->name.c_str(), AT_REMOVEDIR);
+            else {
+                int parentFd = openRemoveNode(parent);
+
+                if ( parentFd >= 0 ) {
+                    status = unlinkat(parentFd, node->name.c_str(), AT_REMOVEDIR);
+                    close(parentFd);
+                }
+            }
+
+            if ( status < 0 ) tree->status = EXIT_FAILURE;
+
+            delete node;
+            node = parent;
+        }
+    }
+
+    /**
+     * Remove o conteúdo de um diretório.
+     * 
+     * Os arquivos são removidos com unlinkat relativo ao descritor do
+     * diretório, e o tipo de cada item vem de d_type, evitando um lstat
+     * por item. Cada subdiretório é enviado como uma nova tarefa, de
+     * forma que subárvores irmãs são removidas em paralelo.
+     * 
+     * @param[in] pool Conjunto de threads
+     * @param[in] node O diretório
+    */
+    void removeDirectoryEntries(ThreadPool & pool, RemoveNode *node) {
+        TraceSpan span("removeDirectoryEntries", node->name);
+        RemoveTree *tree = node->tree;
+        int fd = openRemoveNode(node);
+
+        DirListing listing;
+        struct stat st;
+
+        if ( fd < 0 or fstat(fd, &st) < 0 or readDirectory(fd, true, listing) != EXIT_SUCCESS ) {
+            if ( fd >= 0 ) close(fd);
+            tree->status = EXIT_FAILURE;
+            finishRemoveNode(node);
+            return;
+        }
+
+        node->dev = st.st_dev;
+        node->ino = st.st_ino;
+
+        // O descritor só é mantido aberto para os subdiretórios enquanto houver vagas
+        if ( ++tree->openDirectories <= tree->maxOpenDirectories ) node->fd = fd;
+        else tree->openDirectories--;
+
+        for ( size_t i = 0; i < listing.size(); i++ ) {
+            const char *name = listing.name(i);
+
+            if ( !strcmp(name, ".") or !strcmp(name, "..") )
+                continue;
+
+            bool isDir = listing.type(i) == DT_DIR;
+
+            if ( listing.type(i) == DT_UNKNOWN )
+                isDir = fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 and S_ISDIR(st.st_mode);
+
+            if ( not isDir ) {
+                if ( unlinkat(fd, name, 0) == 0 ) continue;
+
+                if ( errno != EISDIR ) {
+                    tree->status = EXIT_FAILURE;
+                    continue;
+                }
+            }
+
+            RemoveNode *child = new RemoveNode(node, name, tree);
+            node->pending++;
+            pool.submit([&pool, child] { removeDirectoryEntries(pool, child); });
+        }
+
+        if ( node->fd < 0 ) close(fd);
+        finishRemoveNode(node);
+    }
+
+    /**
+     * Exclui um diretório e todo o seu conteúdo.
+     * 
+     * @param[in] path Caminho do diretório
+     * @param[in] threads Quantidade de threads (0 para o número de núcleos)
+     * @return status da operação
+    */
+    int removeDirectory(const std::string & path, const size_t & threads = 0) {
+        TraceSpan span("removeDirectory", path);
+
+        // Diretórios vazios dispensam a criação das threads
+        if ( rmdir(path.c_str()) == 0 ) return EXIT_SUCCESS;
+        if ( errno != ENOTEMPTY and errno != EEXIST ) return EXIT_FAILURE;
+
+        // Os descritores mantidos pelos nós ocupam no máximo um quarto do limite do processo
+        struct rlimit limit;
+        RemoveTree tree;
+
+        tree.path = path;
+        tree.maxOpenDirectories = REMOVE_OPEN_DIRECTORIES;
+
+        if ( getrlimit(RLIMIT_NOFILE, &limit) == 0 and limit.rlim_cur != RLIM_INFINITY )
+            tree.maxOpenDirectories = std::min<long>(tree.maxOpenDirectories, limit.rlim_cur / 4);
+
+        ThreadPool pool(threads);
+
+        RemoveNode *root = new RemoveNode(nullptr, path, &tree);
+        pool.submit([&pool, root] { removeDirectoryEntries(pool, root); });
+        pool.wait();
+
+        return tree.status;
+    }
+
+    /**
+     * Verifica se um diretório é o destino de uma movimentação interrompida
+     * da origem informada, ou seja, se contém a marca MOVE_MARKER com o
+     * dispositivo e o inode da origem.
+     * 
+     * @param[in] directory Diretório de destino
+     * @param[in] sourceSt Informações da origem
+     * @return true caso a movimentação possa ser retomada nesse diretório
+    */
+    bool isMoveInProgress(const std::string & directory, const struct stat & sourceSt) {
+        char buffer[64];
+        int fd = open(( directory + "/" MOVE_MARKER ).c_str(), O_RDONLY | O_CLOEXEC);
+
+        if ( fd < 0 ) return false;
+
+        ssize_t n = read(fd, buffer, sizeof buffer - 1);
+        close(fd);
+
+        if ( n <= 0 ) return false;
+
+        buffer[n] = '\0';
+
+        return std::to_string(sourceSt.st_dev) + ":" + std::to_string(sourceSt.st_ino) + "\n" == buffer;
+    }
+
+    /**
+     * Cria o diretório de destino de uma movimentação e grava nele a marca
+     * MOVE_MARKER, que permite retomar a movimentação no mesmo caminho.
+     * Um diretório que já existia sem a marca não é marcado, pois o seu
+     * conteúdo não foi copiado por esta movimentação.
+     * 
+     * @param[in] target Diretório de destino
+     * @param[in] sourceSt Informações do diretório de origem
+     * @param[in, out] stats Contadores da cópia
+     * @return status da operação
+    */
+    int markMoveTarget(const std::string & target, const struct stat & sourceSt, CopyStats & stats) {
+        if ( stats.resuming ) return EXIT_SUCCESS;
+
+        if ( mkdir(target.c_str(), ( sourceSt.st_mode & 0777 ) | S_IRWXU) < 0 )
+            return errno == EEXIST ? EXIT_SUCCESS : WRITE_FAILURE;
+
+        std::string marker = std::to_string(sourceSt.st_dev) + ":" + std::to_string(sourceSt.st_ino) + "\n";
+        int fd = open(( target + "/" MOVE_MARKER ).c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR);
+
+        if ( fd < 0 ) return WRITE_FAILURE;
+
+        int status = writeAll(fd, marker.data(), marker.size());
+
+        if ( close(fd) < 0 ) status = WRITE_FAILURE;
+
+        return status;
+    }
+
+    /**
+     * Move arquivos e diretórios para outro sistema de arquivos.
+     * 
+     * A origem é copiada em paralelo, preservando dono, permissões e datas.
+     * Depois da cópia, um único syncfs grava todos os dados no disco, e só
+     * então a origem é removida. Caso a movimentação seja interrompida, a
+     * origem continua intacta até a cópia estar completa. O diretório de
+     * destino guarda a marca MOVE_MARKER até a origem ser removida, e
+     * repetir o comando retoma a cópia no mesmo caminho, ignorando os
+     * arquivos que já foram copiados.
+     * 
+     * @param[in] source Diretório ou arquivo de origem
+     * @param[in] target Caminho de destino
+     * @param[in] sourceSt Informações da origem
+     * @param[in, out] stats Contadores da cópia
+     * @return status da operação
+    */
+    int moveAcrossDevices(const std::string & source, const std::string & target,
+                          const struct stat & sourceSt, CopyStats & stats) {
+        TraceSpan span("moveAcrossDevices", source);
+        int status;
+
+        stats.move = true;
+        stats.createdDirectories.clear();
+
+        if ( S_ISDIR(sourceSt.st_mode) and ( status = markMoveTarget(target, sourceSt, stats) ) != EXIT_SUCCESS )
+            return status;
+
+        {
+            ThreadPool pool;
+            status = copyTree(pool, source, target, stats);
+            pool.wait();
+        }
+
+        span.setBytes(stats.bytes);
+
+        if ( status != EXIT_SUCCESS ) return status;
+        if ( stats.failures > 0 ) return WRITE_FAILURE;
+
+        // As datas dos diretórios só podem ser aplicadas depois que o seu conteúdo foi criado
+        for ( auto directory = stats.createdDirectories.rbegin(); directory != stats.createdDirectories.rend(); directory++ )
+            if ( copyMetadata(directory->first, directory->second) != EXIT_SUCCESS )
+                return WRITE_FAILURE;
+
+        size_t pos = target.rfind('/');
+        std::string parent = pos == std::string::npos ? "." : pos == 0 ? "/" : target.substr(0, pos);
+        int fd = open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if ( fd < 0 ) return WRITE_FAILURE;
+
+        status = syncfs(fd) < 0 ? WRITE_FAILURE : EXIT_SUCCESS;
+        close(fd);
+
+        if ( status != EXIT_SUCCESS ) return status;
+
+        // A marca é apagada por último, para que uma remoção interrompida também possa ser retomada
+        if ( S_ISDIR(sourceSt.st_mode) ) {
+            if ( ( status = removeDirectory(source) ) == EXIT_SUCCESS )
+                unlink(( target + "/" MOVE_MARKER ).c_str());
+
+            return status;
+        }
+
+        return unlink(source.c_str()) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    /**
+     * Move ou renomeia arquivos e diretórios.
+     * 
+     * Quando a origem e o destino estão em sistemas de arquivos diferentes,
+     * rename falha com EXDEV e a movimentação é feita com moveAcrossDevices.
+     * 
+     * @param[in] source Diretório ou arquivo de origem
+     * @param[in] target Diretório ou arquivo de destino
+     * @param[in, out] stats Contadores da cópia, utilizados apenas entre sistemas de arquivos
+     * @return status da operação
+    */
+    int moveFiles( const std::string & source, const std::string & target, CopyStats & stats ) {
+        TraceSpan span("moveFiles", source);
+
+        // Verifica se a origem existe
+        struct stat source_sb;
+        
+        if ( lstat(source.c_str(), &source_sb) == -1 ) 
+            return FILE_FAILURE;
+    
+        struct stat target_sb;
+        std::string path = target;
+
+        if ( stat(target.c_str(), &target_sb) != -1 ) {
+
+            // Verifica se a origem e o destino são o mesmo arquivo
+            if ( target_sb.st_dev == source_sb.st_dev and target_sb.st_ino == source_sb.st_ino )
+                return SAME_FILE;
+
+            // O destino é um diretório, adiciona o nome do arquivo à pasta, exceto
+            // quando ele é o próprio destino de uma movimentação interrompida
+            if ( S_ISDIR(target_sb.st_mode) and not isMoveInProgress(target, source_sb) )
+                path = target + "/" + getBaseName(source);
+        }
+
+        stats.resuming = S_ISDIR(source_sb.st_mode) and isMoveInProgress(path, source_sb);
+
+        if ( rename(source.c_str(), path.c_str()) == 0 ) return EXIT_SUCCESS;
+
+        if ( errno == EXDEV ) return moveAcrossDevices(source, path, source_sb, stats);
+
+        return EXIT_FAILURE;
+    }
+
+    /// @brief Tratamento dos sinais de interrupção salvo enquanto programas externos executam
+    struct InterruptState {
+        struct sigaction interrupt;
+        struct sigaction quit;
+    };
+
+    /**
+     * Faz o shell ignorar SIGINT e SIGQUIT, que devem interromper apenas
+     * os programas em execução.
+     * 
+     * @param[out] saved O tratamento anterior dos sinais
+    */
+    void ignoreInterrupts(InterruptState & saved) {
+        struct sigaction ignore = {};
+        ignore.sa_handler = SIG_IGN;
+        sigaction(SIGINT, &ignore, &saved.interrupt);
+        sigaction(SIGQUIT, &ignore, &saved.quit);
+    }
+
+    /**
+     * Restaura o tratamento de SIGINT e SIGQUIT.
+     * 
+     * @param[in] saved O tratamento salvo por ignoreInterrupts
+    */
+    void restoreInterrupts(const InterruptState & saved) {
+        sigaction(SIGINT, &saved.interrupt, nullptr);
+        sigaction(SIGQUIT, &saved.quit, nullptr);
+    }
+
+    /**
+     * Cria o processo de um programa externo, sem aguardar o seu término.
+     * 
+     * O processo é criado com posix_spawn, que no Linux utiliza
+     * clone(CLONE_VM | CLONE_VFORK): a tabela de páginas do shell não é
+     * copiada, de forma que o custo não cresce com a memória do shell.
+     * Os sinais ignorados pelo shell são restaurados no processo filho.
+     * 
+     * @param[in] path Caminho do executável
+     * @param[in] args Os argumentos, incluindo o nome do programa
+     * @param[in] in Descritor usado como entrada padrão do programa
+     * @param[in] out Descritor usado como saída padrão do programa
+     * @param[out] pid O identificador do processo criado
+     * @return status da operação
+    */
+    int spawnProgram(const std::string & path, const std::vector<std::string> & args,
+                     const int & in, const int & out, pid_t & pid) {
+        std::vector<char *> argv;
+
+        for ( auto & arg: args ) argv.push_back(const_cast<char *>(arg.c_str()));
+        argv.push_back(nullptr);
+
+        posix_spawnattr_t attr;
+        posix_spawn_file_actions_t actions;
+        sigset_t defaults;
+
+        sigemptyset(&defaults);
+        sigaddset(&defaults, SIGINT);
+        sigaddset(&defaults, SIGQUIT);
+        sigaddset(&defaults, SIGPIPE);
+
+        posix_spawnattr_init(&attr);
+        posix_spawnattr_setsigdefault(&attr, &defaults);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+        posix_spawn_file_actions_init(&actions);
+        if ( in != STDIN_FILENO ) posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+        if ( out != STDOUT_FILENO ) posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+
+        int error = posix_spawn(&pid, path.c_str(), &actions, &attr, argv.data(), environ);
+
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attr);
+
+        if ( error != 0 ) {
+            errno = error;
+            return OPEN_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Aguarda o término de um processo.
+     * 
+     * @param[in] pid O identificador do processo
+     * @return O status de saída do programa (128 + sinal, caso tenha sido interrompido)
+    */
+    int waitProgram(const pid_t & pid) {
+        int status = 0;
+
+        while ( waitpid(pid, &status, 0) < 0 and errno == EINTR );
+
+        return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+
+    /**
+     * Executa um programa externo e aguarda o seu término.
+     * 
+     * O buffer da saída é esvaziado antes da criação do processo, e
+     * enquanto o programa executa o shell ignora SIGINT e SIGQUIT.
+     * 
+     * @param[in] path Caminho do executável
+     * @param[in] args Os argumentos, incluindo o nome do programa
+     * @param[out] exitStatus O status de saída do programa (128 + sinal, caso tenha sido interrompido)
+     * @return status da operação
+    */
+    int runProgram(const std::string & path, const std::vector<std::string> & args, int & exitStatus) {
+        InterruptState saved;
+        pid_t pid;
+
+        // O programa escreve diretamente na saída, após o conteúdo pendente do shell
+        if ( outputFd == STDOUT_FILENO ) flush();
+
+        ignoreInterrupts(saved);
+
+        int status = spawnProgram(path, args, inputFd, outputFd, pid);
+
+        if ( status == EXIT_SUCCESS ) exitStatus = waitProgram(pid);
+        else exitStatus = errno == ENOENT ? 127 : 126;
+
+        int error = errno;
+        restoreInterrupts(saved);
+        errno = error;
+
+        return status;
+    }
+
+    /**
+     * Obtém a descrição de um comando específico.
+     * 
+     * @return A descrição do comando.
+    */
+    std::string getCommandDescription(std::string name) {
+        std::stringstream ss;
+
+        auto args = cmdArgsDescription[name];
+
+        if ( !args.empty() ) {
+            ss << "COMANDO:\n" << name << "\n\n";
+            ss << "DESCRIÇÃO:\n" << helpDictionary[name] << "\n\n";
+            ss << "USO:\n";
+
+            for ( auto & arg: args ) {
+                ss << "$ " << std::left << std::setw(32);
+                ss << arg.name << arg.description << '\n';
+            }
+        } else ss << "Comando não encontrado: " << name;
+
+        return ss.str();
+    }
+    
+}
+/**
+ * Padrão de glob de um único nome (sem '/'): '*', '?', classes "[a-z]" e
+ * "[!a-z]" e escapes com '\'. O padrão é compilado uma única vez em uma
+ * sequência de elementos, e a comparação avança da esquerda para a direita
+ * voltando apenas até o último '*', o que a mantém linear no tamanho do
+ * nome para os padrões comuns. '?' consome um caracter UTF-8 inteiro.
+ * Como no bash, um nome oculto só corresponde a um padrão iniciado por
+ * '.', exceto quando `period` é false (como no find).
+*/
+class GlobPattern {
+
+    public:
+
+    GlobPattern() = default;
+
+    /**
+     * Contrutor
+     * 
+     * @param[in] pattern O padrão
+     * @param[in] period Exige um '.' explícito no início dos nomes ocultos
+    */
+    explicit GlobPattern(const std::string & pattern, const bool & period = true) {
+        compile(pattern, period);
+    }
+
+    /**
+     * Compila um padrão.
+     * 
+     * @param[in] pattern O padrão
+     * @param[in] period Exige um '.' explícito no início dos nomes ocultos
+     * @return status da operação (SYNTAX_FAILURE caso alguma classe não seja fechada).
+    */
+    int compile(const std::string & pattern, const bool & period = true) {
+        items.clear();
+        literal.clear();
+        prefix.clear();
+        wildcard = false;
+        this->period = period;
+
+        for ( size_t i = 0; i < pattern.size(); i++ ) {
+            char c = pattern[i];
+
+            if ( c == '*' ) {
+                if ( items.empty() or items.back().kind != STAR ) items.emplace_back(STAR);
+                wildcard = true;
+            }
+            else if ( c == '?' ) {
+                items.emplace_back(ANY);
+                wildcard = true;
+            }
+            else if ( c == '[' ) {
+                Item item(CLASS);
+                size_t j = i + 1;
+
+                if ( j < pattern.size() and ( pattern[j] == '!' or pattern[j] == '^' ) ) item.negate = true, j++;
+
+                // Um ']' logo no início faz parte da classe
+                for ( bool first = true; j < pattern.size() and ( first or pattern[j] != ']' ); first = false ) {
+                    unsigned char low = pattern[j] == '\\' and j + 1 < pattern.size() ? pattern[++j] : pattern[j];
+                    unsigned char high = low;
+                    j++;
+
+                    if ( j + 1 < pattern.size() and pattern[j] == '-' and pattern[j + 1] != ']' ) {
+                        high = pattern[j + 1] == '\\' and j + 2 < pattern.size() ? pattern[j += 2] : pattern[++j];
+                        j++;
+                    }
+
+                    for ( unsigned c = low; c <= high; c++ ) item.set[c] = true;
+                }
+
+                if ( j >= pattern.size() ) return SYNTAX_FAILURE;
+
+                items.push_back(item);
+                wildcard = true;
+                i = j;
+            }
+            else {
+                if ( c == '\\' and i + 1 < pattern.size() ) c = pattern[++i];
+
+                if ( items.empty() or items.back().kind != TEXT ) items.emplace_back(TEXT);
+                items.back().text += c;
+            }
+        }
+
+        if ( !wildcard ) {
+            for ( auto & item: items ) literal += item.text;
+        }
+        else if ( !items.empty() and items[0].kind == TEXT ) prefix = items[0].text;
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Indica se um nome corresponde ao padrão.
+     * 
+     * @param[in] name O nome
+     * @param[in] length O tamanho do nome
+     * @return true caso o nome corresponda ao padrão.
+    */
+    bool match(const char *name, const size_t & length) const {
+        if ( !wildcard ) return length == literal.size() and !memcmp(name, literal.data(), length);
+
+        // Um nome oculto só corresponde a um padrão iniciado por '.'
+        if ( period and length > 0 and name[0] == '.' and ( prefix.empty() or prefix[0] != '.' ) ) return false;
+
+        if ( length < prefix.size() or memcmp(name, prefix.data(), prefix.size()) ) return false;
+
+        size_t item = 0, pos = 0;
+        size_t starItem = SIZE_MAX, starPos = 0;
+
+        while ( true ) {
+            if ( item < items.size() ) {
+                const Item & it = items[item];
+
+                if ( it.kind == STAR ) {
+                    starItem = ++item;
+                    starPos = pos;
+                    continue;
+                }
+
+                if ( pos < length ) {
+                    bool ok = false;
+                    size_t next = pos + 1;
+
+                    if ( it.kind == TEXT ) {
+                        ok = length - pos >= it.text.size() and !memcmp(name + pos, it.text.data(), it.text.size());
+                        next = pos + it.text.size();
+                    }
+                    else if ( it.kind == ANY ) {
+                        ok = true;
+                        while ( next < length and ( name[next] & 0xC0 ) == 0x80 ) next++;
+                    }
+                    else ok = it.set[(unsigned char) name[pos]] != it.negate;
+
+                    if ( ok ) {
+                        item++;
+                        pos = next;
+                        continue;
+                    }
+                }
+            }
+            else if ( pos == length ) return true;
+
+            // Falhou: o último '*' consome mais um caracter
+            if ( starItem == SIZE_MAX or starPos >= length ) return false;
+
+            item = starItem;
+            pos = ++starPos;
+        }
+    }
+
+    bool match(const std::string & name) const {
+        return match(name.data(), name.size());
+    }
+
+    /// @brief Indica se o padrão possui algum caracter especial.
+    bool hasWildcard() const { return wildcard; }
+
+    /// @brief O nome representado por um padrão sem caracteres especiais.
+    const std::string & getLiteral() const { return literal; }
+
+    private:
+
+    enum Kind { TEXT, ANY, STAR, CLASS };
+
+    struct Item {
+        Kind kind;
+        std::string text;
+        std::array<bool, 256> set {};
+        bool negate = false;
+
+        explicit Item(const Kind & kind) : kind(kind) {}
+    };
+
+    std::vector<Item> items;
+    std::string literal;            // O nome, quando não há caracteres especiais
+    std::string prefix;             // Texto fixo do início, comparado antes do restante
+    bool wildcard = false;
+    bool period = true;
+};
+
+/**
+ * Expansão de padrões de caminhos: '*', '?', "[...]", "{a,b}" e "**".
+ * 
+ * O padrão é dividido em componentes, compilados uma única vez. As chaves
+ * são expandidas antes, como no bash: "{a,b}" sem outros caracteres
+ * especiais gera os nomes mesmo que eles não existam. Os componentes sem
+ * caracteres especiais não leem o diretório (e.g. "logs/2024/app*.log" lê
+ * apenas logs/2024), e o texto fixo do início de cada componente descarta
+ * os nomes antes da comparação completa. "**" corresponde a qualquer
+ * quantidade de diretórios, inclusive nenhum (o diretório em que ele
+ * começa também é listado, como no bash com globstar), sem seguir links
+ * simbólicos nem entrar em diretórios ocultos; os diretórios são
+ * percorridos em paralelo.
+*/
+class Glob {
+
+    public:
+
+    /**
+     * Contrutor
+     * 
+     * @param[in] pattern O padrão
+    */
+    explicit Glob(const std::string & pattern) {
+        std::vector<std::string> alternatives;
+
+        expandBraces(pattern, alternatives);
+
+        for ( auto & alternative: alternatives ) {
+            Compiled compiled;
+
+            if ( compile(alternative, compiled) == EXIT_SUCCESS ) patterns.push_back(std::move(compiled));
+            else valid = false;
+        }
+    }
+
+    /// @brief Indica se o padrão é válido (todas as classes "[...]" foram fechadas).
+    bool isValid() const { return valid; }
+
+    /**
+     * Obtém os caminhos que correspondem ao padrão.
+     * 
+     * @param[out] paths Os caminhos, em ordem alfabética em cada alternativa das chaves
+     * @return A quantidade de caminhos.
+    */
+    size_t expand(std::vector<std::string> & paths) {
+        paths.clear();
+
+        for ( auto & compiled: patterns ) {
+            std::vector<std::string> found;
+
+            if ( compiled.literal ) {
+                paths.push_back(compiled.text);
+                continue;
+            }
+
+            walkPattern(compiled, found);
+            std::sort(found.begin(), found.end());
+
+            for ( auto & path: found ) paths.push_back(std::move(path));
+        }
+
+        return paths.size();
+    }
+
+    /**
+     * Expande as chaves de um padrão: "a{b,c}d" gera "abd" e "acd".
+     * 
+     * @param[in] pattern O padrão
+     * @param[out] result Os padrões gerados, na ordem das alternativas
+    */
+    static void expandBraces(const std::string & pattern, std::vector<std::string> & result) {
+        size_t open = std::string::npos, depth = 0;
+        std::vector<size_t> commas;
+
+        for ( size_t i = 0; i < pattern.size(); i++ ) {
+            char c = pattern[i];
+
+            if ( c == '\\' ) i++;
+            else if ( c == '{' and depth++ == 0 ) open = i, commas.clear();
+            else if ( c == ',' and depth == 1 ) commas.push_back(i);
+            else if ( c == '}' and depth > 0 and --depth == 0 ) {
+                // Chaves sem vírgula (e.g. "{}") não são alternativas
+                if ( commas.empty() ) continue;
+
+                std::string head = pattern.substr(0, open), tail = pattern.substr(i + 1);
+                size_t start = open + 1;
+
+                commas.push_back(i);
+
+                for ( auto & comma: commas ) {
+                    expandBraces(head + pattern.substr(start, comma - start) + tail, result);
+                    start = comma + 1;
+                }
+
+                return;
+            }
+        }
+
+        result.push_back(pattern);
+    }
+
+    private:
+
+    struct Compiled {
+        std::string base;                       // Diretório inicial ("" para o diretório atual)
+        std::vector<GlobPattern> components;
+        std::vector<bool> recursive;            // Componentes "**"
+        bool directoriesOnly = false;           // O padrão termina com '/'
+        bool literal = false;                   // Sem caracteres especiais após as chaves
+        std::string text;
+    };
+
+    /**
+     * Compila uma alternativa do padrão.
+    */
+    static int compile(std::string pattern, Compiled & compiled) {
+        GlobPattern probe;
+
+        if ( pattern.compare(0, 2, "~/") == 0 or pattern == "~" ) {
+            const char *home = getenv("HOME");
+            if ( home != nullptr ) pattern.replace(0, 1, home);
+        }
+
+        if ( pattern.size() > 1 and pattern.back() == '/' ) {
+            compiled.directoriesOnly = true;
+            while ( pattern.size() > 1 and pattern.back() == '/' ) pattern.pop_back();
+        }
+
+        if ( !pattern.empty() and pattern[0] == '/' ) compiled.base = "/";
+
+        std::vector<std::string> parts;
+
+        for ( auto & part: split(pattern, '/') ) if ( !part.empty() ) parts.push_back(part);
+
+        bool wildcard = false;
+
+        for ( auto & part: parts ) {
+            if ( part == "**" ) {
+                // "**/**" equivale a "**"
+                if ( compiled.recursive.empty() or !compiled.recursive.back() ) {
+                    compiled.components.emplace_back();
+                    compiled.recursive.push_back(true);
+                }
+
+                wildcard = true;
+                continue;
+            }
+
+            compiled.components.emplace_back();
+            if ( compiled.components.back().compile(part) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+
+            compiled.recursive.push_back(false);
+            wildcard |= compiled.components.back().hasWildcard();
+        }
+
+        // Sem caracteres especiais o caminho é mantido, já sem os escapes
+        if ( !wildcard ) {
+            compiled.literal = true;
+            compiled.text = compiled.base;
+
+            for ( size_t i = 0; i < compiled.components.size(); i++ )
+                compiled.text += ( i > 0 ? "/" : "" ) + compiled.components[i].getLiteral();
+
+            if ( compiled.directoriesOnly ) compiled.text += "/";
+            return EXIT_SUCCESS;
+        }
+
+        // Os componentes iniciais sem caracteres especiais formam o diretório inicial
+        size_t fixed = 0;
+
+        while ( fixed + 1 < compiled.components.size() and !compiled.recursive[fixed] and
+                !compiled.components[fixed].hasWildcard() ) {
+            compiled.base += compiled.components[fixed].getLiteral() + "/";
+            fixed++;
+        }
+
+        compiled.components.erase(compiled.components.begin(), compiled.components.begin() + fixed);
+        compiled.recursive.erase(compiled.recursive.begin(), compiled.recursive.begin() + fixed);
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Percorre os diretórios de uma alternativa do padrão.
+    */
+    void walkPattern(const Compiled & compiled, std::vector<std::string> & found) {
+        std::mutex mutex;
+        bool parallel = std::find(compiled.recursive.begin(), compiled.recursive.end(), true) != compiled.recursive.end();
+
+        auto emit = [&](std::string && path) {
+            std::lock_guard<std::mutex> lock(mutex);
+            found.push_back(std::move(path));
+        };
+
+        if ( !parallel ) {
+            walk(compiled, nullptr, compiled.base, 0, emit);
+            return;
+        }
+
+        ThreadPool pool;
+        walk(compiled, &pool, compiled.base, 0, emit);
+        pool.wait();
+    }
+
+    /**
+     * Compara os itens de um diretório com o componente `index` do padrão.
+     * 
+     * @param[in] compiled O padrão
+     * @param[in] pool As threads que percorrem os subdiretórios (nullptr para percorrê-los na própria thread)
+     * @param[in] directory O diretório, terminado em '/' ("" para o diretório atual)
+     * @param[in] index O componente do padrão
+     * @param[in] emit Função chamada para cada caminho encontrado
+     * @param[in] descending Indica que o diretório foi alcançado pelo próprio "**", e não ao entrar nele
+    */
+    template <typename Emit>
+    static void walk(const Compiled & compiled, ThreadPool *pool, const std::string & directory, size_t index,
+                     Emit & emit, const bool & descending = false) {
+        const size_t count = compiled.components.size();
+
+        // Componentes sem caracteres especiais são verificados com um stat, sem ler o diretório
+        while ( index < count and !compiled.recursive[index] and !compiled.components[index].hasWildcard() ) {
+            std::string path = directory + compiled.components[index].getLiteral();
+            struct stat st;
+
+            if ( index + 1 == count ) {
+                if ( lstat(path.c_str(), &st) == 0 and ( !compiled.directoriesOnly or isDirectory(path, DT_UNKNOWN) ) )
+                    emit(compiled.directoriesOnly ? path + "/" : path);
+                return;
+            }
+
+            if ( stat(path.c_str(), &st) < 0 or not S_ISDIR(st.st_mode) ) return;
+
+            walk(compiled, pool, path + "/", index + 1, emit);
+            return;
+        }
+
+        bool recursive = compiled.recursive[index];
+        size_t target = recursive ? index + 1 : index;          // Componente comparado com os itens
+
+        // Como no bash com globstar, "dir/**" inclui o próprio diretório, com a barra apenas no diretório inicial
+        if ( recursive and target == count and !descending and !directory.empty() ) {
+            bool base = directory == compiled.base or compiled.directoriesOnly;
+            emit(base ? std::string(directory) : directory.substr(0, directory.size() - 1));
+        }
+
+        // "**/nome" também procura o nome fixo no próprio diretório
+        if ( recursive and target < count and !compiled.recursive[target] and !compiled.components[target].hasWildcard() )
+            walk(compiled, nullptr, directory, target, emit);
+
+        bool matchItems = target < count and compiled.components[target].hasWildcard();
+        int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if ( fd < 0 ) return;
+
+        Runner::readDirectoryEntries(fd, true, [&](const char *name, const size_t & length,
+                                                  const unsigned char & type, const uint64_t &) {
+            if ( name[0] == '.' and ( length == 1 or ( length == 2 and name[1] == '.' ) ) ) return;
+
+            bool matched = matchItems and compiled.components[target].match(name, length);
+            bool descend = recursive and name[0] != '.';
+
+            if ( !matched and !descend and !( recursive and target == count ) ) return;
+
+            std::string path = directory;
+            path.append(name, length);
+
+            // Links simbólicos são seguidos apenas pelos componentes comuns, nunca pelo "**"
+            bool isDir = type == DT_DIR or ( ( type == DT_UNKNOWN or ( type == DT_LNK and matched ) ) and
+                                             isDirectory(path, type, fd, name) );
+
+            if ( recursive and target == count and name[0] != '.' and ( !compiled.directoriesOnly or isDir ) )
+                emit(compiled.directoriesOnly ? path + "/" : std::string(path));
+
+            if ( matched ) {
+                if ( target + 1 == count ) {
+                    if ( !compiled.directoriesOnly or isDir ) emit(compiled.directoriesOnly ? path + "/" : std::string(path));
+                }
+                else if ( isDir ) submit(compiled, pool, path + "/", target + 1, emit);
+            }
+
+            if ( descend and isDir and type != DT_LNK ) submit(compiled, pool, path + "/", index, emit, true);
+        });
+
+        close(fd);
+    }
+
+    template <typename Emit>
+    static void submit(const Compiled & compiled, ThreadPool *pool, std::string && directory, const size_t & index,
+                       Emit & emit, const bool & descending = false) {
+        if ( pool == nullptr ) walk(compiled, pool, directory, index, emit, descending);
+        else pool->submit([&compiled, pool, directory, index, &emit, descending] {
+            walk(compiled, pool, directory, index, emit, descending);
+        });
+    }
+
+    /**
+     * Indica se um caminho é um diretório, seguindo links simbólicos.
+    */
+    static bool isDirectory(const std::string & path, const unsigned char & type, const int & fd = -1,
+                            const char *name = nullptr) {
+        struct stat st;
+
+        if ( type == DT_DIR ) return true;
+        if ( fd >= 0 ) return fstatat(fd, name, &st, 0) == 0 and S_ISDIR(st.st_mode);
+
+        return stat(path.c_str(), &st) == 0 and S_ISDIR(st.st_mode);
+    }
+
+    std::vector<Compiled> patterns;
+    bool valid = true;
+};
+
+/**
+ * Busca de arquivos em árvores de diretórios (comando find).
+ * 
+ * Cada diretório é uma tarefa de um ThreadPool: o diretório é lido com
+ * getdents64 e os metadados dos itens, quando algum filtro precisa deles,
+ * são obtidos com statx relativo ao descritor do diretório, sem percorrer
+ * o caminho novamente. Os subdiretórios viram novas tarefas, exceto os
+ * descartados por -maxdepth ou -prune, que nunca são abertos. Cada thread
+ * acumula os caminhos encontrados em um buffer próprio e o grava na saída
+ * quando ele enche, de forma que os resultados aparecem enquanto a busca
+ * continua e nenhuma lista com todos os caminhos é criada. Os caminhos
+ * saem na ordem em que são encontrados, que varia entre execuções.
+*/
+class FileFinder {
+
+    public:
+
+    /// @brief Comparação numérica dos filtros: +N (maior), -N (menor) ou N (igual).
+    struct Range {
+        char mode = 0;                  // '+', '-', '=' ou 0 (sem filtro)
+        uint64_t value = 0;
+        uint64_t unit = 1;
+
+        bool accepts(const uint64_t & amount) const {
+            uint64_t units = ( amount + unit - 1 ) / unit;
+            return mode == 0 or ( mode == '+' ? units > value : mode == '-' ? units < value : units == value );
+        }
+    };
+
+    /// @brief Filtros da busca.
+    struct Filter {
+        std::vector<GlobPattern> names;         // -name (todos precisam corresponder)
+        std::vector<GlobPattern> lowerNames;    // -iname, comparados com o nome em minúsculas
+        std::vector<GlobPattern> prune;         // -prune: diretórios que não são percorridos
+        char type = 0;                          // -type: 'f', 'd' ou 'l'
+        Range size;                             // -size, em bytes com a unidade do filtro
+        Range age;                              // -mtime, em dias completos
+        size_t minDepth = 0;
+        size_t maxDepth = SIZE_MAX;
+    };
+
+    /// @brief Contadores da busca.
+    struct Stats {
+        std::atomic<size_t> directories { 0 };
+        std::atomic<size_t> entries { 0 };
+        std::atomic<size_t> matches { 0 };
+        std::atomic<size_t> failures { 0 };
+    };
+
+    /**
+     * Contrutor
+     * 
+     * @param[in] filter Os filtros
+     * @param[in] output Descritor em que os caminhos encontrados são gravados
+    */
+    FileFinder(const Filter & filter, const int & output) : filter(filter), output(output) {
+        now = time(nullptr);
+        needsStat = filter.size.mode != 0 or filter.age.mode != 0;
+    }
+
+    /**
+     * Busca a partir de um caminho. As tarefas dos subdiretórios devem ser
+     * aguardadas com ThreadPool::wait, e depois com finish.
+     * 
+     * @param[in] pool As threads da busca
+     * @param[in] root O caminho inicial
+     * @return status da operação (OPEN_FAILURE caso o caminho não exista).
+    */
+    int start(ThreadPool & pool, const std::string & root) {
+        struct statx stx;
+
+        if ( statx(AT_FDCWD, root.c_str(), AT_SYMLINK_NOFOLLOW, STATX_TYPE | STATX_SIZE | STATX_MTIME, &stx) < 0 )
+            return OPEN_FAILURE;
+
+        std::string name = Runner::getBaseName(root);
+
+        // O caminho inicial é gravado direto na saída, antes dos itens encontrados pelas threads
+        if ( accepts(name.c_str(), name.size(), 0, modeType(stx.stx_mode), &stx) ) {
+            std::string line = root + '\n';
+            std::lock_guard<std::mutex> lock(mutex);
+
+            stats.matches++;
+            if ( !stopped and Runner::writeAll(output, line.data(), line.size()) != EXIT_SUCCESS ) stop();
+        }
+
+        if ( S_ISDIR(stx.stx_mode) and filter.maxDepth > 0 and !pruned(name.c_str(), name.size()) ) {
+            std::string directory = root;
+            if ( directory.back() != '/' ) directory += '/';
+
+            pool.submit([this, &pool, directory] { walk(pool, directory, 1); });
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Grava os caminhos que ainda estão nos buffers das threads.
+     * 
+     * @return status da operação (WRITE_FAILURE caso a saída tenha sido fechada).
+    */
+    int finish() {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for ( auto & buffer: buffers ) {
+            if ( !stopped and !buffer.second.empty() and
+                 Runner::writeAll(output, buffer.second.data(), buffer.second.size()) != EXIT_SUCCESS )
+                stop();
+
+            buffer.second.clear();
+        }
+
+        // O errno da thread que falhou (e.g. EPIPE) é repassado a quem chamou
+        if ( stopped ) errno = error;
+
+        return stopped ? WRITE_FAILURE : EXIT_SUCCESS;
+    }
+
+    const Stats & getStats() const { return stats; }
+
+    private:
+
+    /**
+     * Lê um diretório, gravando os itens aceitos pelos filtros e enviando
+     * os subdiretórios para as threads.
+     * 
+     * @param[in] pool As threads da busca
+     * @param[in] directory O caminho do diretório, terminado em '/'
+     * @param[in] depth A profundidade dos itens do diretório
+    */
+    void walk(ThreadPool & pool, const std::string & directory, const size_t & depth) {
+        if ( stopped ) return;
+
+        TraceSpan span("find", directory);
+        int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+        if ( fd < 0 ) {
+            stats.failures++;
+            return;
+        }
+
+        stats.directories++;
+        std::string path = directory;
+
+        int status = Runner::readDirectoryEntries(fd, true, [&](const char *name, const size_t & length,
+                                                               const unsigned char & type, const uint64_t &) {
+            if ( name[0] == '.' and ( length == 1 or ( length == 2 and name[1] == '.' ) ) ) return;
+
+            stats.entries++;
+
+            struct statx stx;
+            unsigned char kind = type;
+            bool known = false;
+
+            // O statx só é feito quando algum filtro precisa do tamanho ou da data, ou o tipo é desconhecido
+            if ( needsStat or kind == DT_UNKNOWN ) {
+                if ( statx(fd, name, AT_SYMLINK_NOFOLLOW, STATX_TYPE | STATX_SIZE | STATX_MTIME, &stx) < 0 ) {
+                    stats.failures++;
+                    return;
+                }
+
+                kind = modeType(stx.stx_mode);
+                known = true;
+            }
+
+            path.resize(directory.size());
+            path.append(name, length);
+
+            if ( depth >= filter.minDepth and accepts(name, length, depth, kind, known ? &stx : nullptr) ) emit(path);
+
+            if ( kind == DT_DIR and depth < filter.maxDepth and !pruned(name, length) )
+                pool.submit([this, &pool, subdirectory = path + '/', depth] { walk(pool, subdirectory, depth + 1); });
+        });
+
+        if ( status != EXIT_SUCCESS ) stats.failures++;
+
+        close(fd);
+    }
+
+    /**
+     * Indica se um item é aceito por todos os filtros.
+    */
+    bool accepts(const char *name, const size_t & length, const size_t & depth, const unsigned char & type,
+                 const struct statx *stx) const {
+        if ( depth < filter.minDepth ) return false;
+
+        if ( filter.type != 0 and type != ( filter.type == 'f' ? DT_REG : filter.type == 'd' ? DT_DIR : DT_LNK ) )
+            return false;
+
+        for ( auto & pattern: filter.names ) if ( !pattern.match(name, length) ) return false;
+
+        if ( !filter.lowerNames.empty() ) {
+            std::string lower(name, length);
+
+            for ( auto & c: lower ) c = tolower((unsigned char) c);
+            for ( auto & pattern: filter.lowerNames ) if ( !pattern.match(lower) ) return false;
+        }
+
+        if ( stx != nullptr ) {
+            if ( !filter.size.accepts(stx->stx_size) ) return false;
+
+            int64_t seconds = now - stx->stx_mtime.tv_sec;
+            if ( !filter.age.accepts(seconds < 0 ? 0 : seconds / 86400) ) return false;
+        }
+
+        return true;
+    }
+
+    bool pruned(const char *name, const size_t & length) const {
+        for ( auto & pattern: filter.prune ) if ( pattern.match(name, length) ) return true;
+        return false;
+    }
+
+    static unsigned char modeType(const mode_t & mode) {
+        return S_ISDIR(mode) ? DT_DIR : S_ISLNK(mode) ? DT_LNK : S_ISREG(mode) ? DT_REG : DT_UNKNOWN;
+    }
+
+    /**
+     * Acrescenta um caminho ao buffer da thread, gravando-o na saída quando enche.
+    */
+    void emit(const std::string & path) {
+        stats.matches++;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        std::string & buffer = buffers[std::this_thread::get_id()];
+        lock.unlock();
+
+        buffer += path;
+        buffer += '\n';
+
+        if ( buffer.size() < OUTPUT_BUFFER_SIZE ) return;
+
+        // A gravação é serializada para que as linhas das threads não se misturem
+        lock.lock();
+
+        if ( !stopped and Runner::writeAll(output, buffer.data(), buffer.size()) != EXIT_SUCCESS ) stop();
+        buffer.clear();
+    }
+
+    // Interrompe a busca após uma falha de escrita
+    void stop() {
+        error = errno;
+        stopped = true;
+    }
+
+    const Filter & filter;
+    const int output;
+    time_t now;
+    bool needsStat;
+    Stats stats;
+    std::mutex mutex;
+    std::unordered_map<std::thread::id, std::string> buffers;
+    std::atomic<bool> stopped { false };
+    int error = 0;                  // errno da falha de escrita, protegido por mutex
+};
+
+/**
+ * Rotinas vetorizadas de busca em memória.
+ * 
+ * Em x86-64 as rotinas utilizam AVX2 quando o processador o suporta
+ * (verificado uma única vez, em tempo de execução) e SSE2 nos demais,
+ * já que o SSE2 faz parte da arquitetura. Nas outras arquiteturas são
+ * utilizadas as versões escalares.
+*/
+namespace Simd {
+
+    /// @brief Contagens do wc, acumuladas entre os blocos de um arquivo.
+    struct TextCounts {
+        uint64_t lines = 0;
+        uint64_t words = 0;
+        bool inWord = false;            // O bloco anterior terminou no meio de uma palavra
+    };
+
+    /**
+     * Compara um texto com um trecho ignorando maiúsculas e minúsculas (ASCII).
+     * O texto precisa estar em minúsculas.
+    */
+    static bool equalsFolded(const char *data, const char *needle, const size_t & n) {
+        for ( size_t i = 0; i < n; i++ ) {
+            unsigned char c = data[i];
+            if ( ( c >= 'A' and c <= 'Z' ? c + 32 : c ) != (unsigned char) needle[i] ) return false;
+        }
+
+        return true;
+    }
+
+    static const char * findLiteralScalar(const char *data, const size_t & size, const char *needle, const size_t & n, const bool & fold) {
+        if ( !fold ) return (const char *) memmem(data, size, needle, n);
+
+        for ( size_t i = 0; i + n <= size; i++ )
+            if ( equalsFolded(data + i, needle, n) ) return data + i;
+
+        return nullptr;
+    }
+
+    // Com `fold`, o bit 0x20 dos bytes é ligado antes da comparação com as letras do texto
+    static char foldMask(const char & c, const bool & fold) {
+        return fold and c >= 'a' and c <= 'z' ? 0x20 : 0;
+    }
+
+    #if defined(__x86_64__)
+
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+
+    /**
+     * Procura um texto de dois ou mais bytes comparando o primeiro e o
+     * último byte em 32 posições por vez; apenas as posições em que ambos
+     * coincidem são comparadas por inteiro.
+    */
+    __attribute__((target("avx2")))
+    static const char * findLiteralAvx2(const char *data, const size_t & size, const char *needle, const size_t & n, const bool & fold) {
+        const __m256i first = _mm256_set1_epi8(needle[0]);
+        const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+        const __m256i firstMask = _mm256_set1_epi8(foldMask(needle[0], fold));
+        const __m256i lastMask = _mm256_set1_epi8(foldMask(needle[n - 1], fold));
+        size_t i = 0;
+
+        for ( ; i + n - 1 + 32 <= size; i += 32 ) {
+            __m256i a = _mm256_or_si256(_mm256_loadu_si256((const __m256i *) ( data + i )), firstMask);
+            __m256i b = _mm256_or_si256(_mm256_loadu_si256((const __m256i *) ( data + i + n - 1 )), lastMask);
+            uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+
+            for ( ; mask != 0; mask &= mask - 1 ) {
+                size_t pos = i + __builtin_ctz(mask);
+
+                if ( fold ? equalsFolded(data + pos + 1, needle + 1, n - 2) : !memcmp(data + pos + 1, needle + 1, n - 2) )
+                    return data + pos;
+            }
+        }
+
+        return findLiteralScalar(data + i, size - i, needle, n, fold);
+    }
+
+    static const char * findLiteralSse2(const char *data, const size_t & size, const char *needle, const size_t & n, const bool & fold) {
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[n - 1]);
+        const __m128i firstMask = _mm_set1_epi8(foldMask(needle[0], fold));
+        const __m128i lastMask = _mm_set1_epi8(foldMask(needle[n - 1], fold));
+        size_t i = 0;
+
+        for ( ; i + n - 1 + 16 <= size; i += 16 ) {
+            __m128i a = _mm_or_si128(_mm_loadu_si128((const __m128i *) ( data + i )), firstMask);
+            __m128i b = _mm_or_si128(_mm_loadu_si128((const __m128i *) ( data + i + n - 1 )), lastMask);
+            uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+
+            for ( ; mask != 0; mask &= mask - 1 ) {
+                size_t pos = i + __builtin_ctz(mask);
+
+                if ( fold ? equalsFolded(data + pos + 1, needle + 1, n - 2) : !memcmp(data + pos + 1, needle + 1, n - 2) )
+                    return data + pos;
+            }
+        }
+
+        return findLiteralScalar(data + i, size - i, needle, n, fold);
+    }
+
+    /**
+     * Conta as ocorrências de um byte: as comparações são acumuladas em
+     * contadores de 8 bits e somadas com _mm256_sad_epu8 a cada 255 blocos.
+    */
+    __attribute__((target("avx2")))
+    static size_t countByteAvx2(const char *data, const size_t & size, const char & byte) {
+        const __m256i target = _mm256_set1_epi8(byte);
+        __m256i total = _mm256_setzero_si256();
+        size_t i = 0;
+
+        while ( i + 32 <= size ) {
+            __m256i counters = _mm256_setzero_si256();
+            size_t blocks = std::min<size_t>(255, ( size - i ) / 32);
+
+            for ( size_t j = 0; j < blocks; j++, i += 32 ) {
+                __m256i chunk = _mm256_loadu_si256((const __m256i *) ( data + i ));
+                counters = _mm256_sub_epi8(counters, _mm256_cmpeq_epi8(chunk, target));
+            }
+
+            total = _mm256_add_epi64(total, _mm256_sad_epu8(counters, _mm256_setzero_si256()));
+        }
+
+        size_t count = _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+                       _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+
+        for ( ; i < size; i++ ) count += data[i] == byte;
+
+        return count;
+    }
+
+    static size_t countByteSse2(const char *data, const size_t & size, const char & byte) {
+        const __m128i target = _mm_set1_epi8(byte);
+        __m128i total = _mm_setzero_si128();
+        size_t i = 0;
+
+        while ( i + 16 <= size ) {
+            __m128i counters = _mm_setzero_si128();
+            size_t blocks = std::min<size_t>(255, ( size - i ) / 16);
+
+            for ( size_t j = 0; j < blocks; j++, i += 16 ) {
+                __m128i chunk = _mm_loadu_si128((const __m128i *) ( data + i ));
+                counters = _mm_sub_epi8(counters, _mm_cmpeq_epi8(chunk, target));
+            }
+
+            total = _mm_add_epi64(total, _mm_sad_epu8(counters, _mm_setzero_si128()));
+        }
+
+        size_t count = _mm_cvtsi128_si64(total) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total));
+
+        for ( ; i < size; i++ ) count += data[i] == byte;
+
+        return count;
+    }
+
+    /**
+     * Conta as linhas e as palavras 32 bytes por vez. Os espaços (' ' e
+     * '\t' a '\r') de cada bloco viram uma máscara de bits; as palavras são
+     * os bytes que não são espaços precedidos por um espaço, com o último
+     * bit do bloco anterior deslocado para dentro do próximo.
+    */
+    __attribute__((target("avx2,popcnt")))
+    static size_t countTextAvx2(const char *data, const size_t & size, TextCounts & counts) {
+        const __m256i newline = _mm256_set1_epi8('\n'), blank = _mm256_set1_epi8(' ');
+        const __m256i tab = _mm256_set1_epi8('\t'), four = _mm256_set1_epi8(4);
+        uint64_t previous = !counts.inWord;
+        size_t i = 0;
+
+        for ( ; i + 32 <= size; i += 32 ) {
+            __m256i chunk = _mm256_loadu_si256((const __m256i *) ( data + i ));
+            __m256i control = _mm256_sub_epi8(chunk, tab);
+            __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, blank),
+                                            _mm256_cmpeq_epi8(_mm256_min_epu8(control, four), control));
+            uint64_t spaces = (uint32_t) _mm256_movemask_epi8(space);
+
+            counts.lines += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+            counts.words += __builtin_popcountll(~spaces & ( ( spaces << 1 ) | previous ) & 0xFFFFFFFF);
+            previous = spaces >> 31;
+        }
+
+        counts.inWord = !previous;
+        return i;
+    }
+
+    static size_t countTextSse2(const char *data, const size_t & size, TextCounts & counts) {
+        const __m128i newline = _mm_set1_epi8('\n'), blank = _mm_set1_epi8(' ');
+        const __m128i tab = _mm_set1_epi8('\t'), four = _mm_set1_epi8(4);
+        uint32_t previous = !counts.inWord;
+        size_t i = 0;
+
+        for ( ; i + 16 <= size; i += 16 ) {
+            __m128i chunk = _mm_loadu_si128((const __m128i *) ( data + i ));
+            __m128i control = _mm_sub_epi8(chunk, tab);
+            __m128i space = _mm_or_si128(_mm_cmpeq_epi8(chunk, blank), _mm_cmpeq_epi8(_mm_min_epu8(control, four), control));
+            uint32_t spaces = _mm_movemask_epi8(space);
+
+            counts.lines += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+            counts.words += __builtin_popcount(~spaces & ( ( spaces << 1 ) | previous ) & 0xFFFF);
+            previous = spaces >> 15;
+        }
+
+        counts.inWord = !previous;
+        return i;
+    }
+
+    #endif
+
+    /**
+     * Procura um texto em um bloco de memória.
+     * 
+     * @param[in] data O bloco
+     * @param[in] size O tamanho do bloco
+     * @param[in] needle O texto procurado
+     * @param[in] n O tamanho do texto
+     * @param[in] fold Ignora maiúsculas e minúsculas (ASCII); o texto precisa estar em minúsculas
+     * @return A primeira ocorrência, ou nullptr.
+    */
+    const char * findLiteral(const char *data, const size_t & size, const char *needle, const size_t & n, const bool & fold = false) {
+        if ( n == 0 ) return data;
+        if ( n > size ) return nullptr;
+        if ( n == 1 and foldMask(needle[0], fold) == 0 ) return (const char *) memchr(data, needle[0], size);
+        if ( n == 1 ) return findLiteralScalar(data, size, needle, n, fold);
+
+        #if defined(__x86_64__)
+        return hasAvx2 ? findLiteralAvx2(data, size, needle, n, fold) : findLiteralSse2(data, size, needle, n, fold);
+        #else
+        return findLiteralScalar(data, size, needle, n, fold);
+        #endif
+    }
+
+    /**
+     * Conta as ocorrências de um byte em um bloco de memória (e.g. '\n').
+     * 
+     * @param[in] data O bloco
+     * @param[in] size O tamanho do bloco
+     * @param[in] byte O byte
+     * @return A quantidade de ocorrências.
+    */
+    size_t countByte(const char *data, const size_t & size, const char & byte) {
+        #if defined(__x86_64__)
+        return hasAvx2 ? countByteAvx2(data, size, byte) : countByteSse2(data, size, byte);
+        #else
+        size_t count = 0;
+        for ( const char *p = data; ( p = (const char *) memchr(p, byte, data + size - p) ) != nullptr; p++ ) count++;
+        return count;
+        #endif
+    }
+
+    /**
+     * Conta as linhas ('\n') e as palavras (sequências sem espaços) de um bloco.
+     * 
+     * @param[in] data O bloco
+     * @param[in] size O tamanho do bloco
+     * @param[in, out] counts As contagens, continuadas a partir do bloco anterior
+    */
+    void countText(const char *data, const size_t & size, TextCounts & counts) {
+        size_t i = 0;
+
+        #if defined(__x86_64__)
+        i = hasAvx2 ? countTextAvx2(data, size, counts) : countTextSse2(data, size, counts);
+        #endif
+
+        for ( ; i < size; i++ ) {
+            unsigned char c = data[i];
+            bool space = c == ' ' or ( c >= '\t' and c <= '\r' );
+
+            counts.lines += c == '\n';
+            counts.words += !space and !counts.inWord;
+            counts.inWord = !space;
+        }
+    }
+}
+
+/**
+ * Expressões regulares estendidas (como as do grep -E) avaliadas por um
+ * DFA construído sob demanda.
+ * 
+ * O padrão é compilado em um NFA de Thompson. Durante a busca, cada
+ * conjunto de estados do NFA alcançado vira um estado do DFA, com uma
+ * linha na tabela de transições preenchida na primeira vez em que cada
+ * byte é visto; depois disso, cada byte do texto custa uma única consulta
+ * à tabela, sem retrocessos. Os estados ficam em cache até
+ * REGEX_MAX_STATES, quando o cache é descartado e reconstruído. A busca é
+ * por linhas e não ancorada: o estado inicial é reinserido a cada posição.
+ * 
+ * Suporta literais, '.', classes "[a-z]" e "[^a-z]", \d \w \s, '^', '$',
+ * '*', '+', '?', intervalos "{n}", "{n,}", "{,m}" e "{n,m}", '|' e grupos
+ * "( )". '.' corresponde a um caracter UTF-8. Os intervalos são expandidos
+ * em cópias do item, até REGEX_MAX_REPEAT; como no grep, um '{' que não
+ * inicia um intervalo é um caracter comum.
+ * O cache do DFA é modificado durante a busca: cada thread utiliza a sua
+ * própria cópia do objeto.
+*/
+class Regex {
+
+    public:
+
+    /**
+     * Compila um padrão.
+     * 
+     * @param[in] pattern O padrão
+     * @param[in] ignoreCase Ignora a diferença entre maiúsculas e minúsculas (ASCII)
+     * @return status da operação (SYNTAX_FAILURE caso o padrão seja inválido).
+    */
+    int compile(const std::string & pattern, const bool & ignoreCase = false) {
+        this->pattern = pattern;
+        this->ignoreCase = ignoreCase;
+        position = 0;
+        nodes.clear();
+        sets.clear();
+        reset();
+
+        Fragment fragment;
+
+        if ( parseAlternation(fragment) != EXIT_SUCCESS or position != pattern.size() ) return SYNTAX_FAILURE;
+
+        int match = addNode(MATCH);
+        patch(fragment.outs, match);
+        start = fragment.start;
+
+        findRequired();
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Obtém um texto presente em todas as linhas com ocorrências do padrão
+     * (em minúsculas quando a diferença entre elas é ignorada), que pode ser
+     * procurado antes de o DFA ser executado.
+     * 
+     * @return O texto, ou uma string vazia caso não haja um.
+    */
+    const std::string & getRequired() const {
+        return required;
+    }
+
+    /**
+     * Procura a primeira linha com uma ocorrência do padrão.
+     * 
+     * @param[in] data O início de uma linha
+     * @param[in] end O fim do bloco
+     * @return O início da linha encontrada, ou nullptr.
+    */
+    const char * findLine(const char *data, const char *end) {
+        const char *line = data;
+        int state = initial();
+        const int *table = transitions.data();
+
+        if ( flags[state >> 8] & MATCH_HERE ) return line;
+
+        for ( const char *p = data; p < end; p++ ) {
+            int next = table[state + (unsigned char) *p];
+
+            if ( next >= 0 ) {
+                state = next;
+                continue;
+            }
+
+            // Transições negativas: fim da linha, transição ainda não calculada ou ocorrência
+            if ( *p == '\n' ) {
+                if ( flags[state >> 8] & MATCH_AT_END ) return line;
+
+                line = p + 1;
+                state = initial();
+                table = transitions.data();
+
+                if ( flags[state >> 8] & MATCH_HERE ) return line;
+                continue;
+            }
+
+            if ( next == UNKNOWN ) {
+                next = step(state >> 8, *p);
+                table = transitions.data();
+            }
+
+            if ( next < 0 ) return line;
+
+            state = next;
+        }
+
+        // Depois do último '\n' não há outra linha
+        return line < end and flags[state >> 8] & MATCH_AT_END ? line : nullptr;
+    }
+
+    private:
+
+    enum Kind { CHAR, SPLIT, BOL, EOL, MATCH, GROUP };
+
+    enum Flags { MATCH_HERE = 1, MATCH_AT_END = 2 };
+
+    static constexpr int UNKNOWN = -1;
+
+    struct Node {
+        Kind kind;
+        int set = -1;           // Índice da classe de bytes aceita (CHAR)
+        int out = -1;
+        int out1 = -1;          // Segunda saída (SPLIT)
+    };
+
+    /// @brief Trecho do NFA em construção: o estado inicial e as saídas ainda não ligadas.
+    struct Fragment {
+        int start = -1;
+        std::vector<std::pair<int, bool>> outs;     // (estado, segunda saída)
+    };
+
+    std::string pattern;
+    bool ignoreCase = false;
+    size_t position = 0;
+    std::vector<Node> nodes;
+    std::vector<std::bitset<256>> sets;
+    int start = -1;
+    std::string required;
+
+    // Estados do DFA: a linha de cada um na tabela começa em (estado << 8). As transições
+    // para estados com ocorrência são guardadas como -(destino + 2), e UNKNOWN ainda não
+    // foi calculada; a transição com '\n' nunca é guardada.
+    std::vector<int> transitions;
+    std::vector<uint8_t> flags;
+    std::vector<std::vector<int>> states;
+    std::map<std::vector<int>, int> index;
+    std::vector<uint32_t> marks;
+    uint32_t mark = 0;
+    int first = -1;                     // Estado inicial do DFA (início da linha), já deslocado
+
+    int addNode(const Kind & kind, const int & set = -1) {
+        nodes.push_back({ kind, set });
+        return nodes.size() - 1;
+    }
+
+    void patch(const std::vector<std::pair<int, bool>> & outs, const int & target) {
+        for ( auto & out: outs ) ( out.second ? nodes[out.first].out1 : nodes[out.first].out ) = target;
+    }
+
+    Fragment single(const int & node) {
+        Fragment f;
+        f.start = node;
+        f.outs.push_back({ node, false });
+        return f;
+    }
+
+    // Concatena dois trechos
+    void append(Fragment & a, Fragment && b) {
+        if ( a.start < 0 ) {
+            a = std::move(b);
+            return;
+        }
+
+        patch(a.outs, b.start);
+        a.outs = std::move(b.outs);
+    }
+
+    int parseAlternation(Fragment & result) {
+        if ( parseConcatenation(result) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+
+        while ( position < pattern.size() and pattern[position] == '|' ) {
+            Fragment right;
+            position++;
+
+            if ( parseConcatenation(right) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+
+            int split = addNode(SPLIT);
+            nodes[split].out = result.start;
+            nodes[split].out1 = right.start;
+
+            result.start = split;
+            result.outs.insert(result.outs.end(), right.outs.begin(), right.outs.end());
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    int parseConcatenation(Fragment & result) {
+        result = Fragment();
+
+        while ( position < pattern.size() and pattern[position] != '|' and pattern[position] != ')' ) {
+            Fragment atom;
+
+            if ( parseRepetition(atom) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+            append(result, std::move(atom));
+        }
+
+        // Um trecho vazio (e.g. "a|") corresponde ao texto vazio
+        if ( result.start < 0 ) result = single(addNode(GROUP));
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Lê um item e os seus operadores de repetição.
+     * 
+     * @param[out] result O trecho do NFA
+     * @param[in] end Posição do padrão em que a leitura dos operadores termina
+     * @return status da operação
+    */
+    int parseRepetition(Fragment & result, const size_t & end = std::string::npos) {
+        size_t begin = position;
+
+        if ( parseAtom(result) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+
+        while ( position < pattern.size() and position < end ) {
+            if ( pattern[position] == '{' ) {
+                size_t at = position;
+                int min, max;
+
+                if ( !parseInterval(pattern, position, min, max) ) break;
+                if ( max >= 0 and min > max ) return SYNTAX_FAILURE;
+
+                size_t after = position;
+
+                if ( repeat(result, begin, at, min, max) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+
+                position = after;
+                continue;
+            }
+
+            if ( strchr("*+?", pattern[position]) == nullptr ) break;
+
+            char op = pattern[position++];
+            int split = addNode(SPLIT);
+
+            nodes[split].out = result.start;
+
+            if ( op == '*' ) {
+                patch(result.outs, split);
+                result.start = split;
+                result.outs = { { split, true } };
+            }
+            else if ( op == '+' ) {
+                patch(result.outs, split);
+                result.outs = { { split, true } };
+            }
+            else {
+                result.start = split;
+                result.outs.push_back({ split, true });
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Lê um intervalo "{n}", "{n,}", "{,m}" ou "{n,m}".
+     * 
+     * @param[in] pattern O padrão
+     * @param[in, out] pos A posição do '{', avançada para depois do '}'
+     * @param[out] min A quantidade mínima de repetições
+     * @param[out] max A quantidade máxima, ou -1 quando não há limite
+     * @return false caso o texto não seja um intervalo (pos não é alterada).
+    */
+    static bool parseInterval(const std::string & pattern, size_t & pos, int & min, int & max) {
+        size_t i = pos + 1;
+
+        // Os valores acima de REGEX_MAX_REPEAT são limitados a ele mais um, o que já é inválido
+        auto number = [&pattern, &i](int & value) {
+            size_t begin = i;
+
+            for ( value = 0; i < pattern.size() and isdigit((unsigned char) pattern[i]); i++ )
+                value = std::min(value * 10 + ( pattern[i] - '0' ), REGEX_MAX_REPEAT + 1);
+
+            return i > begin;
+        };
+
+        bool hasMin = number(min), hasMax = true;
+
+        if ( i < pattern.size() and pattern[i] == ',' ) {
+            i++;
+            hasMax = number(max);
+            if ( !hasMax ) max = -1;
+        }
+        else max = min;
+
+        if ( !hasMin ) min = 0;
+
+        if ( ( !hasMin and !hasMax ) or i >= pattern.size() or pattern[i] != '}' ) return false;
+
+        pos = i + 1;
+        return true;
+    }
+
+    /**
+     * Aplica um intervalo a um item. As cópias do item são obtidas lendo
+     * novamente o seu trecho do padrão, que gera novos estados do NFA.
+     * 
+     * @param[in, out] result O item, substituído pelas suas repetições
+     * @param[in] begin Início do item no padrão
+     * @param[in] end Posição do '{' do intervalo
+     * @param[in] min A quantidade mínima de repetições
+     * @param[in] max A quantidade máxima, ou -1 quando não há limite
+     * @return status da operação (SYNTAX_FAILURE caso o intervalo exceda REGEX_MAX_REPEAT
+     *         ou as cópias excedam REGEX_MAX_NODES).
+    */
+    int repeat(Fragment & result, const size_t & begin, const size_t & end, const int & min, const int & max) {
+        if ( min > REGEX_MAX_REPEAT or max > REGEX_MAX_REPEAT ) return SYNTAX_FAILURE;
+
+        Fragment sequence, item = std::move(result);
+        bool used = false;
+
+        auto next = [&](Fragment & copy) {
+            if ( !used ) {
+                used = true;
+                copy = std::move(item);
+                return EXIT_SUCCESS;
+            }
+
+            if ( nodes.size() > REGEX_MAX_NODES ) return SYNTAX_FAILURE;
+
+            position = begin;
+            return parseRepetition(copy, end);
+        };
+
+        for ( int i = 0; i < min; i++ ) {
+            Fragment copy;
+            if ( next(copy) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+            append(sequence, std::move(copy));
+        }
+
+        // Sem limite, a última cópia é repetida como em '*'; com limite, as restantes são opcionais
+        for ( int i = min; i < ( max < 0 ? min + 1 : max ); i++ ) {
+            Fragment copy;
+            if ( next(copy) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+
+            int split = addNode(SPLIT);
+            nodes[split].out = copy.start;
+
+            if ( max < 0 ) {
+                patch(copy.outs, split);
+                copy.outs = { { split, true } };
+            }
+            else copy.outs.push_back({ split, true });
+
+            copy.start = split;
+            append(sequence, std::move(copy));
+        }
+
+        // "{0}" corresponde ao texto vazio
+        result = sequence.start < 0 ? single(addNode(GROUP)) : std::move(sequence);
+
+        return EXIT_SUCCESS;
+    }
+
+    int parseAtom(Fragment & result) {
+        if ( position >= pattern.size() ) return SYNTAX_FAILURE;
+
+        char c = pattern[position++];
+        std::bitset<256> set;
+
+        switch ( c ) {
+            case '(':
+                if ( parseAlternation(result) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+                if ( position >= pattern.size() or pattern[position] != ')' ) return SYNTAX_FAILURE;
+                position++;
+                return EXIT_SUCCESS;
+
+            case '*': case '+': case '?': case ')':
+                return SYNTAX_FAILURE;
+
+            case '^':
+                result = single(addNode(BOL));
+                return EXIT_SUCCESS;
+
+            case '$':
+                result = single(addNode(EOL));
+                return EXIT_SUCCESS;
+
+            case '.':
+                result = anyCharacter();
+                return EXIT_SUCCESS;
+
+            case '[':
+                if ( parseClass(set) != EXIT_SUCCESS ) return SYNTAX_FAILURE;
+                break;
+
+            case '\\':
+                if ( position >= pattern.size() ) return SYNTAX_FAILURE;
+                escape(pattern[position++], set);
+                break;
+
+            default:
+                set[(unsigned char) c] = true;
+        }
+
+        result = single(addNode(CHAR, addSet(set)));
+        return EXIT_SUCCESS;
+    }
+
+    // \d, \w, \s ou um caracter escapado
+    static void escape(const char & c, std::bitset<256> & set) {
+        for ( unsigned i = 0; i < 256; i++ ) {
+            if ( c == 'd' ) set[i] = isdigit(i);
+            else if ( c == 'w' ) set[i] = isalnum(i) or i == '_';
+            else if ( c == 's' ) set[i] = i == ' ' or i == '\t' or i == '\r' or i == '\f' or i == '\v';
+        }
+
+        if ( c != 'd' and c != 'w' and c != 's' ) set[(unsigned char) c] = true;
+    }
+
+    int parseClass(std::bitset<256> & set) {
+        bool negate = position < pattern.size() and pattern[position] == '^';
+        if ( negate ) position++;
+
+        // Um ']' logo no início faz parte da classe
+        for ( bool first = true; position < pattern.size() and ( first or pattern[position] != ']' ); first = false ) {
+            unsigned char low = pattern[position++];
+
+            if ( low == '\\' and position < pattern.size() ) {
+                char e = pattern[position++];
+
+                if ( e == 'd' or e == 'w' or e == 's' ) {
+                    std::bitset<256> escaped;
+                    escape(e, escaped);
+                    set |= escaped;
+                    continue;
+                }
+
+                low = e;
+            }
+
+            unsigned char high = low;
+
+            if ( position + 1 < pattern.size() and pattern[position] == '-' and pattern[position + 1] != ']' ) {
+                high = pattern[position + 1];
+                position += 2;
+            }
+
+            for ( unsigned i = low; i <= high; i++ ) set[i] = true;
+        }
+
+        if ( position >= pattern.size() ) return SYNTAX_FAILURE;
+        position++;
+
+        if ( negate ) set.flip(), set['\n'] = false;
+
+        return EXIT_SUCCESS;
+    }
+
+    int addSet(std::bitset<256> set) {
+        if ( ignoreCase )
+            for ( unsigned c = 'a'; c <= 'z'; c++ )
+                if ( set[c] or set[c - 32] ) set[c] = set[c - 32] = true;
+
+        sets.push_back(set);
+        return sets.size() - 1;
+    }
+
+    /**
+     * '.': um caracter ASCII ou uma sequência UTF-8 de 2 a 4 bytes.
+    */
+    Fragment anyCharacter() {
+        std::bitset<256> single1, continuation, lead2, lead3, lead4;
+
+        for ( unsigned c = 0; c < 256; c++ ) {
+            // Bytes inválidos também são aceitos, como caracteres isolados
+            single1[c] = ( c < 0x80 and c != '\n' ) or ( c & 0xC0 ) == 0x80 or c >= 0xF8;
+            continuation[c] = ( c & 0xC0 ) == 0x80;
+            lead2[c] = ( c & 0xE0 ) == 0xC0;
+            lead3[c] = ( c & 0xF0 ) == 0xE0;
+            lead4[c] = ( c & 0xF8 ) == 0xF0;
+        }
+
+        int cont = addSet(continuation);
+        Fragment result = single(addNode(CHAR, addSet(single1)));
+
+        for ( auto lead: { std::make_pair(lead2, 1), std::make_pair(lead3, 2), std::make_pair(lead4, 3) } ) {
+            Fragment sequence = single(addNode(CHAR, addSet(lead.first)));
+
+            for ( int i = 0; i < lead.second; i++ ) append(sequence, single(addNode(CHAR, cont)));
+
+            int split = addNode(SPLIT);
+            nodes[split].out = result.start;
+            nodes[split].out1 = sequence.start;
+            result.start = split;
+            result.outs.insert(result.outs.end(), sequence.outs.begin(), sequence.outs.end());
+        }
+
+        return result;
+    }
+
+    /**
+     * Procura o maior texto obrigatório do padrão: uma sequência de
+     * caracteres simples fora de grupos, sem '?', '*' ou intervalos que
+     * aceitem zero repetições, em um padrão sem '|' no nível mais externo.
+    */
+    void findRequired() {
+        std::string current;
+        size_t depth = 0, k;
+        int min, max;
+
+        required.clear();
+
+        for ( size_t i = 0; i < pattern.size(); i++ ) {
+            char c = pattern[i];
+            bool literal = false;
+
+            if ( c == '[' ) {
+                // Pula a classe inteira, inclusive um ']' logo no início
+                k = i + 1;
+                if ( k < pattern.size() and pattern[k] == '^' ) k++;
+                if ( k < pattern.size() and pattern[k] == ']' ) k++;
+                while ( k < pattern.size() and pattern[k] != ']' ) k += pattern[k] == '\\' ? 2 : 1;
+                i = k;
+            }
+            else if ( c == '{' and parseInterval(pattern, k = i, min, max) ) i = k - 1;
+            else if ( c == '(' ) depth++;
+            else if ( c == ')' ) depth--;
+            else if ( c == '|' and depth == 0 ) {
+                required.clear();
+                return;
+            }
+            else if ( c == '\\' and i + 1 < pattern.size() ) {
+                c = pattern[++i];
+                literal = depth == 0 and c != 'd' and c != 'w' and c != 's';
+            }
+            else literal = depth == 0 and strchr(".^$*+?", c) == nullptr;
+
+            char next = i + 1 < pattern.size() ? pattern[i + 1] : '\0';
+            bool interval = next == '{' and parseInterval(pattern, k = i + 1, min, max);
+
+            // Com '?', '*' ou "{0,m}" o caracter é opcional; com '+' ou um intervalo ele é o último obrigatório da sequência
+            if ( literal and next != '?' and next != '*' and !( interval and min == 0 ) ) {
+                current += ignoreCase ? tolower((unsigned char) c) : c;
+                if ( next != '+' and !interval ) continue;
+            }
+
+            if ( current.size() > required.size() ) required = current;
+            current.clear();
+        }
+
+        if ( current.size() > required.size() ) required = current;
+    }
+
+    /// @brief Descarta os estados do DFA.
+    void reset() {
+        transitions.clear();
+        flags.clear();
+        states.clear();
+        index.clear();
+        first = -1;
+    }
+
+    /**
+     * Acrescenta a um conjunto os estados alcançados sem consumir bytes.
+     * 
+     * @param[in] node O estado
+     * @param[in] lineStart Permite passar por '^'
+     * @param[in] lineEnd Permite passar por '$'
+     * @param[in, out] set O conjunto
+    */
+    void closure(const int & node, const bool & lineStart, const bool & lineEnd, std::vector<int> & set) {
+        if ( node < 0 or marks[node] == mark ) return;
+
+        marks[node] = mark;
+
+        const Node & n = nodes[node];
+
+        if ( n.kind == SPLIT ) {
+            closure(n.out, lineStart, lineEnd, set);
+            closure(n.out1, lineStart, lineEnd, set);
+        }
+        else if ( n.kind == GROUP or ( n.kind == BOL and lineStart ) or ( n.kind == EOL and lineEnd ) )
+            closure(n.out, lineStart, lineEnd, set);
+        else set.push_back(node);
+    }
+
+    // Inicia um novo conjunto de estados visitados
+    void newMark() {
+        if ( marks.size() != nodes.size() ) marks.assign(nodes.size(), 0), mark = 0;
+        if ( ++mark == 0 ) marks.assign(nodes.size(), 0), mark = 1;
+    }
+
+    /**
+     * Obtém (ou cria) o estado do DFA de um conjunto de estados do NFA.
+     * 
+     * @return A linha do estado na tabela (estado << 8).
+    */
+    int addState(std::vector<int> & set) {
+        std::sort(set.begin(), set.end());
+
+        auto it = index.find(set);
+        if ( it != index.end() ) return it->second << 8;
+
+        uint8_t flag = 0;
+        std::vector<int> end;
+        newMark();
+
+        for ( auto & node: set ) {
+            if ( nodes[node].kind == MATCH ) flag |= MATCH_HERE;
+            closure(node, false, true, end);
+        }
+
+        for ( auto & node: end )
+            if ( nodes[node].kind == MATCH ) flag |= MATCH_AT_END;
+
+        int state = states.size();
+
+        states.push_back(set);
+        flags.push_back(flag);
+        transitions.resize(transitions.size() + 256, UNKNOWN);
+        index[set] = state;
+
+        return state << 8;
+    }
+
+    int initial() {
+        if ( first >= 0 ) return first;
+
+        std::vector<int> set;
+        newMark();
+        closure(start, true, false, set);
+
+        return first = addState(set);
+    }
+
+    /**
+     * Calcula e guarda a transição de um estado do DFA com um byte.
+     * 
+     * @return A transição, codificada como na tabela.
+    */
+    int step(int state, const unsigned char & c) {
+        // Com o cache cheio, os estados são descartados e o atual é recriado
+        if ( states.size() >= REGEX_MAX_STATES ) {
+            std::vector<int> current = states[state];
+            reset();
+            initial();
+            state = addState(current) >> 8;
+        }
+
+        std::vector<int> set;
+        newMark();
+
+        for ( auto & node: states[state] )
+            if ( nodes[node].kind == CHAR and sets[nodes[node].set][c] ) closure(nodes[node].out, false, false, set);
+
+        // A busca não é ancorada: uma ocorrência pode começar na próxima posição
+        closure(start, false, false, set);
+
+        int next = addState(set);
+        int entry = flags[next >> 8] & MATCH_HERE ? -( next + 2 ) : next;
+
+        transitions[( state << 8 ) + c] = entry;
+
+        return entry;
+    }
+};
+
+/**
+ * Busca de linhas em arquivos (comando grep).
+ * 
+ * Padrões sem caracteres especiais (ou com -F) são procurados como texto
+ * com Simd::findLiteral no bloco inteiro, e não linha a linha: a linha só
+ * é delimitada quando há uma ocorrência. Os demais padrões utilizam o
+ * Regex e, quando têm um texto obrigatório (e.g. "Command" em
+ * "[a-z]+Command"), o DFA só é executado nas linhas que o contêm. Os
+ * números das linhas (-n) são obtidos contando os '\n' entre as
+ * ocorrências com Simd::countByte.
+*/
+class Grep {
+
+    public:
+
+    struct Options {
+        bool count = false;             // -c: apenas a quantidade de linhas
+        bool list = false;              // -l: apenas o nome dos arquivos com ocorrências
+        bool number = false;            // -n: número de cada linha
+        bool invert = false;            // -v: linhas sem ocorrências
+        bool fixed = false;             // -F: o padrão é um texto, sem caracteres especiais
+        bool ignoreCase = false;        // -i
+    };
+
+    /// @brief Progresso da busca em um arquivo, mantido entre os blocos.
+    struct Progress {
+        uint64_t lines = 0;             // Linhas já processadas
+        uint64_t selected = 0;          // Linhas selecionadas
+    };
+
+    /**
+     * Contrutor
+     * 
+     * @param[in] pattern O padrão
+     * @param[in] options As opções
+    */
+    Grep(const std::string & pattern, const Options & options) : options(options), literal(pattern) {
+        useRegex = options.ignoreCase or ( !options.fixed and pattern.find_first_of(".[]{}()*+?|^$\\") != std::string::npos );
+
+        if ( useRegex ) {
+            std::string expression = pattern;
+
+            // Com -F -i o texto é escapado e procurado pelo Regex
+            if ( options.fixed ) {
+                expression.clear();
+                for ( char c: pattern ) {
+                    if ( strchr(".[]{}()*+?|^$\\", c) != nullptr ) expression += '\\';
+                    expression += c;
+                }
+            }
+
+            valid = regex.compile(expression, options.ignoreCase) == EXIT_SUCCESS;
+        }
+    }
+
+    bool isValid() const { return valid; }
+
+    /**
+     * Busca em todo o conteúdo de um descritor.
+     * 
+     * O conteúdo é lido em blocos, guardando a linha incompleta do fim de
+     * cada bloco. Arquivos regulares também são lidos com read, e não
+     * mapeados na memória: um arquivo truncado durante a busca (e.g. um log
+     * rotacionado) causaria um SIGBUS no acesso ao mapeamento, e a cópia
+     * dos blocos não torna a busca mais lenta.
+     * As linhas selecionadas são entregues a `output` a cada bloco de até
+     * SEARCH_BLOCK_SIZE bytes, e não apenas no fim do arquivo.
+     * 
+     * @param[in] fd O descritor
+     * @param[in] prefix Texto exibido antes de cada linha
+     * @param[out] progress O resultado da busca
+     * @param[in] output Recebe (e esvazia) as linhas formatadas; retorna false para encerrar a busca
+     * @return status da operação
+    */
+    int searchDescriptor(const int & fd, const std::string & prefix, Progress & progress,
+                         const std::function<bool(std::string &)> & output) {
+        struct stat st;
+        std::string out;
+
+        if ( fstat(fd, &st) < 0 ) return READ_FAILURE;
+
+        if ( S_ISREG(st.st_mode) ) posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        std::vector<char> buffer(SEARCH_BLOCK_SIZE);
+        size_t used = 0;
+        ssize_t n;
+
+        while ( true ) {
+            if ( used == buffer.size() ) buffer.resize(buffer.size() * 2);
+
+            n = read(fd, buffer.data() + used, buffer.size() - used);
+
+            if ( n < 0 ) {
+                if ( errno == EINTR ) continue;
+                return READ_FAILURE;
+            }
+
+            // No fim da entrada, a última linha é processada mesmo sem '\n'
+            size_t size = used + n;
+            const char *eol = n > 0 ? (const char *) memrchr(buffer.data() + used, '\n', n) :
+                              size > 0 ? buffer.data() + size - 1 : nullptr;
+
+            if ( eol == nullptr ) {
+                if ( n == 0 ) break;
+                used = size;
+                continue;
+            }
+
+            size_t complete = eol + 1 - buffer.data();
+            bool more = search(buffer.data(), complete, prefix, progress, out);
+
+            if ( !out.empty() and !output(out) ) break;
+            if ( !more or n == 0 ) break;
+
+            memmove(buffer.data(), buffer.data() + complete, size - complete);
+            used = size - complete;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Processa um bloco de linhas completas.
+     * 
+     * @param[in] data O bloco
+     * @param[in] size O tamanho do bloco
+     * @param[in] prefix Texto exibido antes de cada linha (e.g. "arquivo:")
+     * @param[in, out] progress O progresso no arquivo
+     * @param[out] out As linhas selecionadas, já formatadas
+     * @return false quando a busca no arquivo pode ser encerrada (-l com uma ocorrência).
+    */
+    bool search(const char *data, const size_t & size, const std::string & prefix, Progress & progress, std::string & out) {
+        const char *p = data, *end = data + size;
+        bool lines = !options.count and !options.list;
+
+        while ( p < end ) {
+            const char *begin = next(p, end);
+            const char *stop = begin != nullptr ? begin : end;
+
+            if ( options.invert ) {
+                // As linhas entre a posição atual e a próxima ocorrência são selecionadas
+                if ( lines or options.number ) {
+                    while ( p < stop ) {
+                        const char *eol = (const char *) memchr(p, '\n', stop - p);
+                        const char *lineEnd = eol != nullptr ? eol : stop;
+
+                        progress.lines++;
+                        progress.selected++;
+                        if ( options.list ) return false;
+                        if ( lines ) emit(p, lineEnd, prefix, progress.lines, out);
+
+                        p = lineEnd + 1;
+                    }
+                }
+                else if ( p < stop ) {
+                    uint64_t count = Simd::countByte(p, stop - p, '\n') + ( stop[-1] != '\n' );
+
+                    progress.lines += count;
+                    progress.selected += count;
+                    if ( options.list ) return false;
+                }
+
+                if ( begin == nullptr ) break;
+
+                const char *eol = (const char *) memchr(begin, '\n', end - begin);
+                progress.lines++;
+                p = eol != nullptr ? eol + 1 : end;
+                continue;
+            }
+
+            if ( begin == nullptr ) {
+                if ( options.number ) progress.lines += Simd::countByte(p, end - p, '\n');
+                break;
+            }
+
+            if ( options.number ) progress.lines += Simd::countByte(p, begin - p, '\n');
+
+            const char *eol = (const char *) memchr(begin, '\n', end - begin);
+            const char *lineEnd = eol != nullptr ? eol : end;
+
+            progress.lines++;
+            progress.selected++;
+            if ( options.list ) return false;
+            if ( lines ) emit(begin, lineEnd, prefix, progress.lines, out);
+
+            p = lineEnd + 1;
+        }
+
+        return true;
+    }
+
+    private:
+
+    /**
+     * Localiza a próxima linha com uma ocorrência do padrão.
+     * 
+     * @return O início da linha, ou nullptr.
+    */
+    const char * next(const char *p, const char *end) {
+        const std::string & required = useRegex ? regex.getRequired() : literal;
+
+        if ( useRegex and required.empty() ) return regex.findLine(p, end);
+
+        while ( p < end ) {
+            const char *found = Simd::findLiteral(p, end - p, required.data(), required.size(), options.ignoreCase);
+
+            if ( found == nullptr ) return nullptr;
+
+            const char *eol = (const char *) memrchr(p, '\n', found - p);
+            const char *begin = eol != nullptr ? eol + 1 : p;
+
+            if ( !useRegex ) return begin;
+
+            // O texto obrigatório apenas seleciona as linhas candidatas, confirmadas pelo DFA
+            eol = (const char *) memchr(found, '\n', end - found);
+            const char *lineEnd = eol != nullptr ? eol : end;
+
+            if ( regex.findLine(begin, lineEnd) != nullptr ) return begin;
+
+            p = lineEnd + 1;
+        }
+
+        return nullptr;
+    }
+
+    void emit(const char *begin, const char *end, const std::string & prefix, const uint64_t & line, std::string & out) {
+        out += prefix;
+
+        if ( options.number ) {
+            out += std::to_string(line);
+            out += ':';
+        }
+
+        out.append(begin, end);
+        out += '\n';
+    }
+
+    Options options;
+    std::string literal;
+    Regex regex;
+    bool useRegex = false;
+    bool valid = true;
+};
+
+/**
+ * Cache LRU das listagens ordenadas de diretórios.
+ * 
+ * As listagens são indexadas por (dispositivo, inode) e contêm todos os
+ * itens do diretório, inclusive os ocultos. Cada diretório em cache
+ * possui um watch inotify, e os eventos pendentes são lidos a cada
+ * consulta, invalidando as listagens cujos itens foram criados, removidos
+ * ou renomeados. Como o kernel registra o evento durante a própria
+ * alteração, uma listagem nunca é usada depois de ficar desatualizada.
+ * Uma listagem repetida de um diretório sem alterações custa apenas um
+ * stat e uma leitura vazia do inotify, sem leitura nem ordenação do
+ * diretório.
+*/
+class DirectoryCache {
+
+    public:
+
+    /// @brief Contadores exibidos pelo comando "cache stats".
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t invalidations = 0;
+        size_t evictions = 0;
+        size_t entries = 0;
+        size_t memory = 0;
+        size_t limit = 0;
+    };
+
+    /**
+     * Obtém a instância do cache.
+     * 
+     * @return O cache.
+    */
+    static DirectoryCache & instance() {
+        static DirectoryCache cache;
+        return cache;
+    }
+
+    /**
+     * Obtém a listagem ordenada de um diretório, lendo-a apenas se não
+     * estiver em cache.
+     * 
+     * @param[in] path Caminho do diretório
+     * @param[out] listing A listagem, com todos os itens
+     * @return status da operação. MALLOC_FAILURE indica que o diretório
+     *         é grande demais para o cache e deve ser lido diretamente.
+    */
+    int get(const std::string & path, std::shared_ptr<const DirListing> & listing) {
+        struct stat st;
+
+        if ( stat(path.c_str(), &st) < 0 ) return OPEN_FAILURE;
+        if ( not S_ISDIR(st.st_mode) ) return OPEN_FAILURE;
+
+        Key key { st.st_dev, st.st_ino };
+        uint64_t generation = 0;
+        int wd = -1;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            drain();
+
+            auto it = index.find(key);
+
+            if ( it != index.end() ) {
+                lru.splice(lru.begin(), lru, it->second);
+                listing = it->second->listing;
+                stats.hits++;
+                return EXIT_SUCCESS;
+            }
+
+            stats.misses++;
+
+            // O tamanho de um diretório é proporcional aos nomes que ele contém
+            if ( (size_t) st.st_size > limit or fd < 0 ) return MALLOC_FAILURE;
+
+            // O watch é criado antes da leitura, para que nenhuma alteração seja perdida
+            wd = inotify_add_watch(fd, path.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                                     IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+            if ( wd >= 0 ) generation = generations[wd];
+        }
+
+        auto fresh = std::make_shared<DirListing>();
+        int status = Runner::getItensOfDirectory(path, *fresh, true);
+        size_t size = fresh->memoryUsage();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        drain();
+
+        // Sem watch, ou com alterações durante a leitura, a listagem não é guardada
+        bool store = status == EXIT_SUCCESS and wd >= 0 and generations[wd] == generation and
+                     !index.count(key) and size <= limit;
+
+        if ( store ) {
+            lru.push_front({ key, wd, fresh, size });
+            index[key] = lru.begin();
+            keys[wd] = key;
+            memory += size;
+
+            evict();
+        } else if ( wd >= 0 and !keys.count(wd) )
+            inotify_rm_watch(fd, wd);
+
+        if ( status == EXIT_SUCCESS ) listing = fresh;
+
+        return status;
+    }
+
+    /**
+     * Obtém a listagem de um diretório apenas se ela estiver em cache, sem
+     * nunca ler o diretório.
+     * 
+     * @param[in] path Caminho do diretório
+     * @param[out] listing A listagem, com todos os itens
+     * @return true caso a listagem esteja em cache.
+    */
+    bool peek(const std::string & path, std::shared_ptr<const DirListing> & listing) {
+        struct stat st;
+
+        if ( stat(path.c_str(), &st) < 0 or not S_ISDIR(st.st_mode) ) return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        drain();
+
+        auto it = index.find({ st.st_dev, st.st_ino });
+
+        if ( it == index.end() ) return false;
+
+        lru.splice(lru.begin(), lru, it->second);
+        listing = it->second->listing;
+        stats.hits++;
+
+        return true;
+    }
+
+    /**
+     * Altera o limite de memória do cache, removendo as listagens menos
+     * utilizadas caso necessário.
+     * 
+     * @param[in] bytes O novo limite
+    */
+    void setLimit(const size_t & bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        limit = bytes;
+        evict();
+    }
+
+    /// @brief Remove todas as listagens do cache.
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        while ( !lru.empty() ) remove(std::prev(lru.end()));
+    }
+
+    /**
+     * Obtém os contadores do cache.
+     * 
+     * @return Os contadores.
+    */
+    Stats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats s = stats;
+
+        s.entries = lru.size();
+        s.memory = memory;
+        s.limit = limit;
+
+        return s;
+    }
+
+    private:
+
+    struct Key {
+        dev_t device;
+        ino_t inode;
+
+        bool operator==(const Key & other) const {
+            return device == other.device and inode == other.inode;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key & key) const {
+            return std::hash<uint64_t>()(key.inode * 31 + key.device);
+        }
+    };
+
+    struct Node {
+        Key key;
+        int wd;
+        std::shared_ptr<const DirListing> listing;
+        size_t size;
+    };
+
+    std::list<Node> lru;                                                    // Mais recentes no início
+    std::unordered_map<Key, std::list<Node>::iterator, KeyHash> index;
+    std::unordered_map<int, Key> keys;                                      // Watch de cada listagem
+    std::unordered_map<int, uint64_t> generations;                          // Eventos recebidos por watch
+    std::mutex mutex;
+    Stats stats;
+    size_t memory = 0;
+    size_t limit = 64 * 1024 * 1024;
+    int fd = -1;
+
+    DirectoryCache() {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+
+    ~DirectoryCache() {
+        if ( fd >= 0 ) close(fd);
+    }
+
+    // Remove uma listagem do cache e o seu watch
+    void remove(std::list<Node>::iterator it) {
+        inotify_rm_watch(fd, it->wd);
+        keys.erase(it->wd);
+        index.erase(it->key);
+        memory -= it->size;
+        lru.erase(it);
+    }
+
+    // Remove as listagens menos utilizadas até respeitar o limite de memória
+    void evict() {
+        while ( memory > limit and !lru.empty() ) {
+            remove(std::prev(lru.end()));
+            stats.evictions++;
+        }
+    }
+
+    // Lê os eventos pendentes do inotify e invalida as listagens alteradas
+    void drain() {
+        alignas(inotify_event) char buffer[16 * 1024];
+        ssize_t n;
+
+        while ( fd >= 0 and ( n = read(fd, buffer, sizeof buffer) ) > 0 ) {
+            for ( ssize_t pos = 0; pos < n; ) {
+                auto *event = reinterpret_cast<inotify_event *>(buffer + pos);
+                pos += sizeof(inotify_event) + event->len;
+
+                // Eventos foram perdidos: nenhuma listagem, nem as em leitura, pode ser confiável
+                if ( event->mask & IN_Q_OVERFLOW ) {
+                    for ( auto & generation: generations ) generation.second++;
+
+                    stats.invalidations += lru.size();
+                    while ( !lru.empty() ) remove(std::prev(lru.end()));
+                    continue;
+                }
+
+                generations[event->wd]++;
+
+                if ( event->mask & IN_IGNORED ) generations.erase(event->wd);
+
+                auto key = keys.find(event->wd);
+                if ( key == keys.end() ) continue;
+
+                auto it = index.find(key->second);
+                if ( it == index.end() ) continue;
+
+                remove(it->second);
+                stats.invalidations++;
+            }
+        }
+    }
+};
+
+/**
+ * Cache dos executáveis encontrados no PATH, como o "hash" do bash.
+ * 
+ * Cada diretório do PATH é lido apenas quando necessário, e os seus nomes
+ * ficam em uma tabela hash junto com a data de modificação do diretório.
+ * Um diretório é relido somente quando essa data muda. Os caminhos já
+ * resolvidos ficam em uma segunda tabela, consultada sem nenhuma chamada
+ * de sistema; ela é descartada quando o PATH ou algum diretório muda, e
+ * um caminho que deixou de existir é esquecido quando a execução falha.
+*/
+class PathCache {
+
+    public:
+
+    /**
+     * Obtém a instância do cache.
+     * 
+     * @return O cache.
+    */
+    static PathCache & instance() {
+        static PathCache cache;
+        return cache;
+    }
+
+    /**
+     * Localiza um executável no PATH.
+     * 
+     * @param[in] name O nome do programa
+     * @param[out] path O caminho completo do executável
+     * @return true caso o executável tenha sido encontrado.
+    */
+    bool find(const std::string & name, std::string & path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        refreshPath();
+
+        auto it = hits.find(name);
+
+        if ( it != hits.end() ) {
+            it->second.count++;
+            path = it->second.path;
+            return true;
+        }
+
+        bool changed = false;
+
+        for ( auto & dir: dirs ) changed |= refreshDirectory(dir);
+
+        // Um novo executável pode ter passado a ter prioridade sobre os já resolvidos
+        if ( changed ) hits.clear();
+
+        for ( auto & dir: dirs ) {
+            if ( !dir.names.count(name) ) continue;
+
+            std::string candidate = dir.path + "/" + name;
+            struct stat st;
+
+            if ( stat(candidate.c_str(), &st) == 0 and S_ISREG(st.st_mode) and
+                 access(candidate.c_str(), X_OK) == 0 ) {
+                hits[name] = { candidate, 1 };
+                path = candidate;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Esquece o caminho de um programa, que será procurado novamente.
+     * 
+     * @param[in] name O nome do programa
+    */
+    void forget(const std::string & name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        hits.erase(name);
+    }
+
+    /// @brief Esquece todos os caminhos e diretórios lidos.
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        reset();
+    }
+
+    /**
+     * Obtém os programas resolvidos e a quantidade de execuções de cada um.
+     * 
+     * @return Os programas, em ordem alfabética.
+    */
+    std::map<std::string, std::pair<std::string, size_t>> getHits() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::string, std::pair<std::string, size_t>> result;
+
+        for ( auto & hit: hits ) result[hit.first] = { hit.second.path, hit.second.count };
+
+        return result;
+    }
+
+    /**
+     * Obtém os nomes de todos os arquivos dos diretórios do PATH.
+     * 
+     * @return Os nomes, sem repetições.
+    */
+    std::vector<std::string> getNames() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unordered_set<std::string> unique;
+
+        refreshPath();
+
+        for ( auto & dir: dirs ) {
+            refreshDirectory(dir);
+            unique.insert(dir.names.begin(), dir.names.end());
+        }
+
+        return std::vector<std::string>(unique.begin(), unique.end());
+    }
+
+    /**
+     * Relê os diretórios do PATH alterados e obtém a versão dos nomes.
+     * 
+     * @return Um número que muda sempre que o PATH ou algum dos seus diretórios muda.
+    */
+    uint64_t getVersion() {
+        std::lock_guard<std::mutex> lock(mutex);
+        refreshPath();
+
+        for ( auto & dir: dirs ) refreshDirectory(dir);
+
+        return version;
+    }
+
+    private:
+
+    struct Directory {
+        std::string path;
+        timespec mtime = { -1, 0 };
+        std::unordered_set<std::string> names;
+    };
+
+    struct Hit {
+        std::string path;
+        size_t count;
+    };
+
+    std::string path;                               // Valor do PATH utilizado nas tabelas
+    std::vector<Directory> dirs;
+    std::unordered_map<std::string, Hit> hits;
+    uint64_t version = 0;                           // Alterações do PATH e dos seus diretórios
+    mutable std::mutex mutex;                       // Os estágios de um pipeline consultam o cache em paralelo
+
+    void reset() {
+        hits.clear();
+        path.clear();
+        dirs.clear();
+    }
+
+    // Reinicia as tabelas caso o PATH tenha mudado
+    void refreshPath() {
+        const char *current = getenv("PATH");
+        std::string value = current ? current : "/usr/local/bin:/usr/bin:/bin";
+
+        if ( value == path and !dirs.empty() ) return;
+
+        reset();
+        path = value;
+
+        for ( auto & dir: split(path, ':') )
+            dirs.push_back({ dir.empty() ? "." : dir, { -1, 0 }, {} });
+    }
+
+    /**
+     * Relê um diretório do PATH caso ele tenha sido alterado.
+     * 
+     * @param[in, out] dir O diretório
+     * @return true caso o diretório tenha sido relido.
+    */
+    bool refreshDirectory(Directory & dir) {
+        struct stat st;
+
+        if ( stat(dir.path.c_str(), &st) < 0 ) st.st_mtim = { -2, 0 };
+
+        if ( st.st_mtim.tv_sec == dir.mtime.tv_sec and st.st_mtim.tv_nsec == dir.mtime.tv_nsec )
+            return false;
+
+        dir.mtime = st.st_mtim;
+        dir.names.clear();
+        version++;
+
+        Runner::streamDirectory(dir.path, false, [&dir](const char *name, const size_t & length,
+                                                        const unsigned char & type, const uint64_t &) {
+            if ( type != DT_DIR ) dir.names.emplace(name, length);
+        });
+
+        return true;
+    }
+};
+
+/**
+ * Estatísticas dos comandos executados: um histograma de latência e os
+ * contadores de E/S (chamadas de leitura/escrita e bytes) por comando.
+ * Programas externos são registrados pelo nome e pipelines como "|".
+*/
+class CommandStats {
+
+    public:
+
+    struct Entry {
+        LatencyHistogram latency;
+        std::atomic<uint64_t> ioCalls{0};         // Chamadas de leitura e escrita (syscr + syscw)
+        std::atomic<uint64_t> readBytes{0};
+        std::atomic<uint64_t> writtenBytes{0};
+    };
+
+    /**
+     * Obtém a instância das estatísticas.
+     * 
+     * @return As estatísticas.
+    */
+    static CommandStats & instance() {
+        static CommandStats stats;
+        return stats;
+    }
+
+    /**
+     * Obtém as estatísticas de um comando, criando-as no primeiro uso.
+     * As entradas nunca são removidas, de forma que a referência permanece válida.
+     * 
+     * @param[in] name O nome do comando
+     * @return As estatísticas do comando.
+    */
+    Entry & get(const std::string & name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::unique_ptr<Entry> & entry = entries[name];
+
+        if ( entry == nullptr ) entry.reset(new Entry);
+
+        return *entry;
+    }
+
+    /**
+     * Registra uma execução de um comando.
+     * 
+     * @param[in, out] entry As estatísticas do comando
+     * @param[in] elapsed A duração da execução
+     * @param[in] before Os contadores de E/S antes da execução
+     * @param[in] after Os contadores de E/S após a execução
+    */
+    void record(Entry & entry, const std::chrono::steady_clock::duration & elapsed,
+                const Runner::IoCounters & before, const Runner::IoCounters & after) {
+        entry.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+        // Sem a contagem de E/S, apenas a latência é registrada
+        if ( after.readCalls == before.readCalls ) return;
+
+        // Desconta a leitura do próprio /proc/self/io
+        uint64_t calls = after.readCalls + after.writeCalls - before.readCalls - before.writeCalls;
+        uint64_t bytes = after.readBytes - before.readBytes;
+
+        entry.ioCalls.fetch_add(calls > 0 ? calls - 1 : 0, std::memory_order_relaxed);
+        entry.readBytes.fetch_add(bytes > probeBytes ? bytes - probeBytes : 0, std::memory_order_relaxed);
+        entry.writtenBytes.fetch_add(after.writtenBytes - before.writtenBytes, std::memory_order_relaxed);
+    }
+
+    /**
+     * Obtém os nomes dos comandos com estatísticas, em ordem alfabética.
+     * 
+     * @return Os nomes e as estatísticas de cada comando.
+    */
+    std::vector<std::pair<std::string, Entry *>> getEntries() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::pair<std::string, Entry *>> result;
+
+        for ( auto & entry: entries ) result.emplace_back(entry.first, entry.second.get());
+
+        return result;
+    }
+
+    /**
+     * Ativa ou desativa a contagem de E/S. Cada comando passa a custar duas
+     * leituras de /proc/self/io, o que domina o tempo de comandos curtos
+     * em scripts, onde ela começa desativada.
+     * 
+     * @param[in] value true para contar a E/S
+    */
+    void setTrackingIo(const bool & value) {
+        io = value;
+    }
+
+    bool isTrackingIo() const {
+        return io;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for ( auto & entry: entries ) {
+            entry.second->latency.clear();
+            entry.second->ioCalls = 0;
+            entry.second->readBytes = 0;
+            entry.second->writtenBytes = 0;
+        }
+    }
+
+    private:
+
+    CommandStats() {
+        Runner::IoCounters before, after;
+
+        // Mede quantos bytes uma leitura de /proc/self/io acrescenta aos contadores
+        Runner::readIoCounters(before);
+        Runner::readIoCounters(after);
+        probeBytes = after.readBytes - before.readBytes;
+    }
+
+    std::map<std::string, std::unique_ptr<Entry>> entries;
+    std::atomic<bool> io{true};
+    uint64_t probeBytes = 0;
+    std::mutex mutex;
+};
+
+/**
+ * Histórico de comandos, persistido em um arquivo compartilhado pelos shells.
+ * 
+ * O arquivo contém um comando por linha e só recebe acréscimos: cada
+ * comando é gravado com um único write em modo O_APPEND, de forma que
+ * shells executando ao mesmo tempo nunca misturam as suas linhas. O
+ * arquivo é lido através de um mmap e nada é lido na inicialização: as
+ * posições das linhas são indexadas apenas no primeiro acesso e, depois,
+ * somente os trechos acrescentados (por este ou por outro shell).
+ * 
+ * Para a busca reversa, cada bloco de HISTORY_BLOCK_SIZE comandos tem um
+ * filtro de Bloom com os trigramas dos seus comandos. A busca verifica os
+ * trigramas do texto no filtro e só percorre os blocos que podem conter o
+ * texto, o que a mantém instantânea com milhões de comandos.
+*/
+class History {
+
+    public:
+
+    /**
+     * Contrutor
+     * 
+     * @param[in] path Caminho do arquivo do histórico, criado caso não exista
+    */
+    explicit History(const std::string & path) {
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    }
+
+    ~History() {
+        if ( data != nullptr ) munmap((void *) data, mapped);
+        if ( fd >= 0 ) close(fd);
+    }
+
+    History(const History &) = delete;
+    History & operator=(const History &) = delete;
+
+    bool isOpen() const {
+        return fd >= 0;
+    }
+
+    /**
+     * Acrescenta um comando ao histórico.
+     * 
+     * @param[in] line O comando
+     * @return status da operação
+    */
+    int add(const std::string & line) {
+        if ( fd < 0 ) return OPEN_FAILURE;
+        if ( line.empty() or line.find('\n') != std::string::npos ) return FILE_FAILURE;
+
+        std::string record = line + '\n';
+
+        if ( write(fd, record.data(), record.size()) != (ssize_t) record.size() ) return WRITE_FAILURE;
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Obtém a quantidade de comandos do histórico.
+     * 
+     * @return A quantidade de comandos.
+    */
+    size_t size() {
+        sync();
+        return offsets.size();
+    }
+
+    /**
+     * Obtém um comando do histórico.
+     * 
+     * @param[in] number O número do comando, a partir de 1
+     * @param[out] line O comando
+     * @return false caso o comando não exista.
+    */
+    bool get(const size_t & number, std::string & line) {
+        sync();
+
+        if ( number == 0 or number > offsets.size() ) return false;
+
+        line.assign(data + offsets[number - 1], length(number - 1));
+        return true;
+    }
+
+    /**
+     * Procura o comando mais recente que contém um texto.
+     * 
+     * @param[in] query O texto procurado
+     * @param[in] before Apenas os comandos com número menor que este são considerados
+     * @return O número do comando encontrado, ou 0.
+    */
+    size_t search(const std::string & query, size_t before) {
+        std::vector<std::pair<unsigned, unsigned>> probes;
+
+        sync();
+        before = std::min(before, offsets.size() + 1);
+
+        // Textos com menos de três caracteres não têm trigramas e percorrem todos os blocos
+        if ( query.size() >= 3 ) {
+            indexTrigrams();
+
+            for ( size_t i = 0; i + 3 <= query.size(); i++ ) probes.push_back(trigramBits(query.data() + i));
+        }
+
+        for ( size_t end = before - 1; end > 0; ) {
+            size_t block = ( end - 1 ) / HISTORY_BLOCK_SIZE, first = block * HISTORY_BLOCK_SIZE;
+
+            if ( mayContain(block, probes) )
+                for ( size_t i = end; i-- > first; )
+                    if ( memmem(data + offsets[i], length(i), query.data(), query.size()) != nullptr ) return i + 1;
+
+            end = first;
+        }
+
+        return 0;
+    }
+
+    /**
+     * Procura o comando mais recente que começa com um texto (e.g. "!ls").
+     * 
+     * @param[in] prefix O início do comando
+     * @return O número do comando encontrado, ou 0.
+    */
+    size_t searchPrefix(const std::string & prefix) {
+        sync();
+
+        for ( size_t i = offsets.size(); i-- > 0; )
+            if ( length(i) >= prefix.size() and !memcmp(data + offsets[i], prefix.data(), prefix.size()) ) return i + 1;
+
+        return 0;
+    }
+
+    private:
+
+    /// @brief Filtro de Bloom de 4096 bits com os trigramas de um bloco de comandos
+    using Bloom = std::array<uint64_t, 64>;
+
+    /**
+     * Acompanha o crescimento do arquivo: refaz o mmap e indexa as linhas
+     * completas acrescentadas desde o último acesso.
+    */
+    void sync() {
+        struct stat st;
+
+        if ( fd < 0 or fstat(fd, &st) < 0 or (size_t) st.st_size == mapped ) return;
+
+        size_t size = st.st_size;
+
+        // O arquivo foi truncado por outro programa, o índice é refeito
+        if ( size < mapped ) {
+            munmap((void *) data, mapped);
+            data = nullptr;
+            mapped = indexed = trigrams = 0;
+            offsets.clear();
+            blooms.clear();
+        }
+
+        if ( size == 0 ) return;
+
+        void *map = data == nullptr ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)
+                                    : mremap((void *) data, mapped, size, MREMAP_MAYMOVE);
+
+        if ( map == MAP_FAILED ) return;
+
+        data = (const char *) map;
+        mapped = size;
+
+        while ( indexed < mapped ) {
+            const char *end = (const char *) memchr(data + indexed, '\n', mapped - indexed);
+
+            // Uma linha ainda sendo gravada por outro shell é indexada no próximo acesso
+            if ( end == nullptr ) break;
+
+            offsets.push_back(indexed);
+            indexed = end - data + 1;
+        }
+    }
+
+    /**
+     * Obtém o tamanho de um comando, sem o '\n'.
+    */
+    size_t length(const size_t & index) const {
+        return ( index + 1 < offsets.size() ? offsets[index + 1] : indexed ) - offsets[index] - 1;
+    }
+
+    /**
+     * Obtém as posições dos dois bits de um trigrama no filtro de Bloom.
+    */
+    static std::pair<unsigned, unsigned> trigramBits(const char *text) {
+        uint32_t h = ( (unsigned char) text[0] | (unsigned char) text[1] << 8 | (unsigned char) text[2] << 16 ) * 0x9E3779B1u;
+        return { h >> 20, ( h >> 8 ) & 4095 };
+    }
+
+    /**
+     * Acrescenta aos filtros os trigramas dos comandos ainda não indexados.
+    */
+    void indexTrigrams() {
+        for ( ; trigrams < offsets.size(); trigrams++ ) {
+            if ( trigrams % HISTORY_BLOCK_SIZE == 0 ) blooms.push_back(Bloom{});
+
+            Bloom & bloom = blooms.back();
+            const char *line = data + offsets[trigrams];
+            size_t n = length(trigrams);
+
+            for ( size_t i = 0; i + 3 <= n; i++ ) {
+                auto bits = trigramBits(line + i);
+                bloom[bits.first >> 6] |= 1ull << ( bits.first & 63 );
+                bloom[bits.second >> 6] |= 1ull << ( bits.second & 63 );
+            }
+        }
+    }
+
+    /**
+     * Indica se um bloco pode conter todos os trigramas da busca.
+    */
+    bool mayContain(const size_t & block, const std::vector<std::pair<unsigned, unsigned>> & probes) const {
+        if ( probes.empty() or block >= blooms.size() ) return true;
+
+        const Bloom & bloom = blooms[block];
+
+        for ( auto & bits: probes )
+            if ( !( bloom[bits.first >> 6] >> ( bits.first & 63 ) & 1 ) or !( bloom[bits.second >> 6] >> ( bits.second & 63 ) & 1 ) )
+                return false;
+
+        return true;
+    }
+
+    int fd = -1;
+    const char *data = nullptr;
+    size_t mapped = 0;
+    size_t indexed = 0;                 // Bytes do arquivo já divididos em linhas
+    size_t trigrams = 0;                // Comandos já incluídos nos filtros
+    std::vector<uint64_t> offsets;      // Posição de cada comando no arquivo
+    std::vector<Bloom> blooms;
+};
+
+/**
+ * Árvore de prefixos (trie) dos nomes de comandos, utilizada no
+ * autocompletar. Cada nó guarda a quantidade de nomes abaixo dele, e os
+ * filhos ficam ordenados, de forma que as sugestões saem em ordem
+ * alfabética e o custo de uma consulta depende apenas do tamanho do
+ * prefixo e da quantidade de sugestões pedidas.
+*/
+class CommandTrie {
+
+    public:
+
+    CommandTrie() : nodes(1) {}
+
+    /**
+     * Adiciona um nome à árvore.
+     * 
+     * @param[in] word O nome
+    */
+    void add(const std::string & word) {
+        std::vector<uint32_t> path = { 0 };
+        uint32_t node = 0;
+
+        for ( unsigned char c: word ) {
+            auto & children = nodes[node].children;
+            auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, (uint32_t) 0));
+
+            if ( it == children.end() or it->first != c ) {
+                it = children.insert(it, { c, (uint32_t) nodes.size() });
+                node = nodes.size();
+                nodes.emplace_back();
+            }
+            else node = it->second;
+
+            path.push_back(node);
+        }
+
+        if ( nodes[node].terminal ) return;
+
+        nodes[node].terminal = true;
+        for ( auto & n: path ) nodes[n].count++;
+    }
+
+    /// @brief Remove todos os nomes.
+    void clear() {
+        nodes.assign(1, Node());
+    }
+
+    /**
+     * Procura os nomes que começam com um prefixo.
+     * 
+     * @param[in] prefix O prefixo
+     * @param[out] common O maior prefixo comum aos nomes encontrados
+     * @param[out] words Os primeiros nomes encontrados, em ordem alfabética
+     * @param[in] limit Quantidade máxima de nomes em `words`
+     * @return A quantidade total de nomes que começam com o prefixo.
+    */
+    size_t complete(const std::string & prefix, std::string & common, std::vector<std::string> & words,
+                    const size_t & limit) const {
+        uint32_t node = 0;
+
+        words.clear();
+        common = prefix;
+
+        for ( unsigned char c: prefix ) {
+            auto & children = nodes[node].children;
+            auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, (uint32_t) 0));
+
+            if ( it == children.end() or it->first != c ) return 0;
+            node = it->second;
+        }
+
+        // O prefixo comum segue enquanto o caminho não se divide
+        for ( uint32_t n = node; !nodes[n].terminal and nodes[n].children.size() == 1; n = nodes[n].children[0].second )
+            common += (char) nodes[n].children[0].first;
+
+        std::string word = prefix;
+        collect(node, word, words, limit);
+
+        return nodes[node].count;
+    }
+
+    private:
+
+    struct Node {
+        std::vector<std::pair<unsigned char, uint32_t>> children;
+        uint32_t count = 0;
+        bool terminal = false;
+    };
+
+    void collect(const uint32_t & node, std::string & word, std::vector<std::string> & words, const size_t & limit) const {
+        if ( words.size() >= limit ) return;
+        if ( nodes[node].terminal ) words.push_back(word);
+
+        for ( auto & child: nodes[node].children ) {
+            word.push_back((char) child.first);
+            collect(child.second, word, words, limit);
+            word.pop_back();
+        }
+    }
+
+    std::vector<Node> nodes;
+};
+
+/**
+ * Autocompletar da linha de comando.
+ * 
+ * A primeira palavra de cada estágio é completada com os comandos internos
+ * e os programas do PATH, guardados em uma CommandTrie que só é refeita
+ * quando o PATH muda. As demais palavras são completadas com os itens do
+ * diretório, obtidos das listagens ordenadas do DirectoryCache por busca
+ * binária. Um diretório fora do cache é lido em segundo plano: enquanto a
+ * leitura não termina, complete retorna false e o editor continua aceitando
+ * as teclas digitadas.
+*/
+class Completer {
+
+    public:
+
+    /// @brief Resultado do autocompletar de uma palavra.
+    struct Completion {
+        size_t start = 0;                   // Início da palavra na linha
+        std::string text;                   // Texto que substitui a palavra, já com os escapes
+        std::vector<std::string> choices;   // Primeiras opções, quando há mais de uma
+        size_t total = 0;                   // Quantidade de opções
+    };
+
+    Completer() : loader(1) {}
+
+    /**
+     * Completa a palavra que termina no cursor.
+     * 
+     * @param[in] line A linha de comando
+     * @param[in] cursor A posição do cursor
+     * @param[out] completion O resultado
+     * @param[in] limit Quantidade máxima de opções em completion.choices
+     * @return false caso o diretório da palavra ainda esteja sendo lido.
+    */
+    bool complete(const std::string & line, const size_t & cursor, Completion & completion, const size_t & limit) {
+        std::string word;
+        bool command;
+
+        findWord(line, cursor, completion.start, word, command);
+        completion.choices.clear();
+        completion.total = 0;
+        completion.text = escape(word);
+
+        if ( command and word.find('/') == std::string::npos ) {
+            std::string common;
+
+            refreshCommands();
+            completion.total = commands.complete(word, common, completion.choices, limit);
+            completion.text = escape(common) + ( completion.total == 1 ? " " : "" );
+
+            return true;
+        }
+
+        size_t slash = word.rfind('/');
+        std::string directory = slash == std::string::npos ? "" : word.substr(0, slash + 1);
+        std::string base = word.substr(directory.size());
+        std::string path = directory.empty() ? "." : directory;
+
+        if ( path[0] == '~' and ( path.size() == 1 or path[1] == '/' ) ) {
+            const char *home = getenv("HOME");
+            if ( home != nullptr ) path.replace(0, 1, home);
+        }
+
+        std::shared_ptr<const DirListing> listing;
+
+        if ( !getListing(path, listing) ) return false;
+        if ( listing == nullptr ) return true;
+
+        // Os nomes que começam com `base` formam um intervalo contínuo da listagem ordenada
+        size_t first = lowerBound(*listing, base, false), last = lowerBound(*listing, base, true);
+        std::string common;
+        size_t only = 0;
+
+        // Itens ocultos só aparecem quando o nome começa com '.'
+        auto skip = [&](const size_t & i) {
+            const char *name = listing->name(i);
+            return ( name[0] == '.' and base.empty() ) or !strcmp(name, ".") or !strcmp(name, "..");
+        };
+
+        for ( size_t i = first; i < last; i++ ) {
+            if ( skip(i) ) continue;
+
+            const char *name = listing->name(i);
+
+            if ( completion.total++ == 0 ) common.assign(name, listing->length(i));
+            only = i;
+
+            if ( completion.choices.size() < limit ) completion.choices.emplace_back(name, listing->length(i));
+        }
+
+        if ( completion.total == 0 ) return true;
+
+        // Como a listagem está ordenada, o prefixo comum é o do primeiro e do último nome
+        for ( size_t i = last; i-- > first; ) {
+            if ( skip(i) ) continue;
+
+            const char *name = listing->name(i);
+            size_t n = 0;
+
+            while ( n < common.size() and n < listing->length(i) and common[n] == name[n] ) n++;
+            common.resize(n);
+            break;
+        }
+
+        completion.text = escape(directory + common);
+
+        if ( completion.total == 1 ) {
+            unsigned char type = listing->type(only);
+            struct stat st;
+
+            if ( type == DT_LNK or type == DT_UNKNOWN )
+                type = stat(( path + "/" + common ).c_str(), &st) == 0 and S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+
+            completion.text += type == DT_DIR ? "/" : " ";
+        }
+
+        return true;
+    }
+
+    /**
+     * Inicia a leitura em segundo plano do diretório de uma palavra, para
+     * que ele já esteja em cache quando a palavra for completada.
+     * 
+     * @param[in] line A linha de comando
+     * @param[in] cursor A posição do cursor
+    */
+    void prefetch(const std::string & line, const size_t & cursor) {
+        Completion completion;
+        complete(line, cursor, completion, 0);
+    }
+
+    private:
+
+    /**
+     * Localiza a palavra que termina no cursor, tratando aspas e escapes
+     * como o tokenize.
+     * 
+     * @param[in] line A linha de comando
+     * @param[in] cursor A posição do cursor
+     * @param[out] start O início da palavra na linha
+     * @param[out] word A palavra, sem aspas nem escapes
+     * @param[out] command Indica se a palavra é a primeira do estágio do pipeline
+    */
+    static void findWord(const std::string & line, const size_t & cursor, size_t & start, std::string & word,
+                         bool & command) {
+        char quote = 0;
+        size_t words = 0;
+        bool inWord = false;
+
+        start = 0;
+        word.clear();
+        command = true;
+
+        for ( size_t i = 0; i < cursor; i++ ) {
+            char c = line[i];
+
+            if ( quote != 0 ) {
+                if ( c == quote ) quote = 0;
+                else if ( quote == '"' and c == '\\' and i + 1 < cursor and ( line[i + 1] == '"' or line[i + 1] == '\\' ) )
+                    word += line[++i];
+                else word += c;
+                continue;
+            }
+
+            if ( c == ' ' or c == '\t' or c == '|' ) {
+                if ( inWord ) words++;
+                if ( c == '|' ) words = 0;
+
+                inWord = false;
+                word.clear();
+                continue;
+            }
+
+            if ( !inWord ) start = i, inWord = true;
+
+            if ( c == '\'' or c == '"' ) quote = c;
+            else if ( c == '\\' and i + 1 < cursor ) word += line[++i];
+            else word += c;
+        }
+
+        if ( !inWord ) start = cursor;
+
+        command = words == 0;
+    }
+
+    /**
+     * Escapa os caracteres que o tokenize trataria de forma especial.
+    */
+    static std::string escape(const std::string & text) {
+        std::string escaped;
+
+        for ( char c: text ) {
+            if ( strchr(" \t'\"\\|$*?[]{},", c) != nullptr ) escaped += '\\';
+            escaped += c;
+        }
+
+        return escaped;
+    }
+
+    /**
+     * Primeiro item da listagem que não é menor que o prefixo (ou, com
+     * `after`, que não começa com ele).
+    */
+    static size_t lowerBound(const DirListing & listing, const std::string & prefix, const bool & after) {
+        size_t low = 0, high = listing.size();
+
+        while ( low < high ) {
+            size_t middle = ( low + high ) / 2;
+            size_t n = std::min(prefix.size(), listing.length(middle));
+            int c = memcmp(listing.name(middle), prefix.data(), n);
+
+            bool before = c < 0 or ( c == 0 and ( after ? n == prefix.size() : n < prefix.size() ) );
+
+            if ( before ) low = middle + 1;
+            else high = middle;
+        }
+
+        return low;
+    }
+
+    /**
+     * Refaz a árvore de comandos caso o PATH tenha mudado.
+    */
+    void refreshCommands() {
+        uint64_t version = PathCache::instance().getVersion();
+
+        if ( version == commandsVersion and commandsVersion != 0 ) return;
+
+        commands.clear();
+
+        for ( auto & entry: helpDictionary ) commands.add(entry.first);
+        for ( auto & name: PathCache::instance().getNames() ) commands.add(name);
+
+        commandsVersion = version;
+    }
+
+    /**
+     * Obtém a listagem de um diretório sem bloquear: do DirectoryCache, da
+     * última leitura em segundo plano ou iniciando uma nova leitura.
+     * 
+     * @param[in] path O diretório
+     * @param[out] listing A listagem (nullptr caso o diretório não possa ser lido)
+     * @return false caso o diretório ainda esteja sendo lido.
+    */
+    bool getListing(const std::string & path, std::shared_ptr<const DirListing> & listing) {
+        if ( DirectoryCache::instance().peek(path, listing) ) return true;
+
+        struct stat st;
+        if ( stat(path.c_str(), &st) < 0 or not S_ISDIR(st.st_mode) ) {
+            listing = nullptr;
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // A última leitura fica aqui, enquanto o diretório não for alterado. Isso inclui os diretórios
+        // grandes demais para o DirectoryCache e as falhas, que não são repetidas a cada tecla.
+        // Uma leitura recém-concluída é entregue mesmo se o diretório mudou durante ela
+        if ( loaded.path == path and loaded.device == st.st_dev and loaded.inode == st.st_ino and
+             ( loaded.unread or ( loaded.mtime.tv_sec == st.st_mtim.tv_sec and loaded.mtime.tv_nsec == st.st_mtim.tv_nsec ) ) ) {
+            loaded.unread = false;
+            listing = loaded.listing;
+            return true;
+        }
+
+        if ( loading.count(path) ) return false;
+
+        loading.insert(path);
+        loader.submit([this, path, st] {
+            std::shared_ptr<const DirListing> result;
+            int status = DirectoryCache::instance().get(path, result);
+
+            if ( status == MALLOC_FAILURE ) {
+                auto fresh = std::make_shared<DirListing>();
+                if ( Runner::getItensOfDirectory(path, *fresh, true) == EXIT_SUCCESS ) result = fresh;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            loading.erase(path);
+
+            // Sem listagem, a próxima consulta retorna nullptr e o Tab apenas emite o aviso sonoro
+            loaded = { path, st.st_dev, st.st_ino, st.st_mtim, result, true };
+        });
+
+        return false;
+    }
+
+    struct Loaded {
+        std::string path;
+        dev_t device = 0;
+        ino_t inode = 0;
+        timespec mtime = { -1, 0 };
+        std::shared_ptr<const DirListing> listing;
+        bool unread = false;                        // Ainda não entregue a quem a aguardava
+    };
+
+    CommandTrie commands;
+    uint64_t commandsVersion = 0;
+    std::mutex mutex;
+    std::unordered_set<std::string> loading;        // Diretórios sendo lidos em segundo plano
+    Loaded loaded;
+    ThreadPool loader;
+};
+
+/**
+ * Editor da linha de comando do modo interativo.
+ * 
+ * O terminal é colocado em modo raw apenas durante a leitura da linha.
+ * Teclas: setas, Home/End, Ctrl-A/E (início e fim), Backspace/Delete,
+ * Ctrl-U (apaga até o início), Ctrl-K (apaga até o fim), Ctrl-C (descarta
+ * a linha), Ctrl-D (fim da entrada na linha vazia), ↑/↓ (histórico),
+ * Ctrl-R (busca reversa no histórico; Ctrl-R de novo procura a anterior) e
+ * Tab (autocompletar; sem nada a acrescentar, exibe as opções).
+*/
+class LineEditor {
+
+    public:
+
+    /**
+     * Contrutor
+     * 
+     * @param[in] history O histórico utilizado na navegação e na busca
+    */
+    explicit LineEditor(History & history) : history(history) {}
+
+    /**
+     * Lê uma linha do terminal.
+     * 
+     * @param[in] prompt A última linha do prompt, já exibido, utilizada ao redesenhar a linha
+     * @param[out] line A linha digitada
+     * @return false no fim da entrada.
+    */
+    bool read(const std::string & prompt, std::string & line) {
+        struct termios saved, raw;
+
+        if ( tcgetattr(STDIN_FILENO, &saved) < 0 ) return false;
+
+        raw = saved;
+        raw.c_iflag &= ~( BRKINT | ICRNL | INPCK | ISTRIP | IXON );
+        raw.c_lflag &= ~( ECHO | ICANON | IEXTEN | ISIG );
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+
+        bool status = edit(prompt, line);
+
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+        output("\r\n");
+
+        return status;
+    }
+
+    private:
+
+    enum Key {
+        CTRL_A = 1, CTRL_C = 3, CTRL_D = 4, CTRL_E = 5, CTRL_G = 7, BACKSPACE = 8, TAB = 9, NEWLINE = 10, CTRL_K = 11,
+        ENTER = 13, CTRL_R = 18, CTRL_U = 21, ESC = 27, DEL = 127,
+        UP = 1000, DOWN, LEFT, RIGHT, HOME, END, DELETE
+    };
+
+    /**
+     * Lê uma tecla, convertendo as sequências de escape das setas e afins.
+     * 
+     * @return A tecla, ou -1 no fim da entrada.
+    */
+    int readKey() {
+        unsigned char c, seq[3];
+
+        if ( readByte(c) <= 0 ) return -1;
+        if ( c != ESC ) return c;
+
+        if ( readByte(seq[0]) <= 0 or readByte(seq[1]) <= 0 ) return ESC;
+
+        if ( seq[0] == '[' and seq[1] >= '0' and seq[1] <= '9' ) {
+            if ( readByte(seq[2]) <= 0 or seq[2] != '~' ) return ESC;
+
+            switch ( seq[1] ) {
+                case '1': case '7': return HOME;
+                case '4': case '8': return END;
+                case '3': return DELETE;
+            }
+
+            return ESC;
+        }
+
+        if ( seq[0] == '[' or seq[0] == 'O' ) {
+            switch ( seq[1] ) {
+                case 'A': return UP;
+                case 'B': return DOWN;
+                case 'C': return RIGHT;
+                case 'D': return LEFT;
+                case 'H': return HOME;
+                case 'F': return END;
+            }
+        }
+
+        return ESC;
+    }
+
+    ssize_t readByte(unsigned char & c) {
+        ssize_t n;
+        while ( ( n = ::read(STDIN_FILENO, &c, 1) ) < 0 and errno == EINTR );
+        return n;
+    }
+
+    void output(const std::string & text) {
+        Runner::writeAll(STDOUT_FILENO, text.data(), text.size());
+    }
+
+    /**
+     * Quantidade de caracteres UTF-8 de um trecho (bytes de continuação não contam).
+    */
+    static size_t characters(const char *text, const size_t & size) {
+        size_t count = 0;
+        for ( size_t i = 0; i < size; i++ ) count += ( text[i] & 0xC0 ) != 0x80;
+        return count;
+    }
+
+    /**
+     * Redesenha a linha e posiciona o cursor.
+    */
+    void refresh(const std::string & prompt, const std::string & line, const size_t & cursor) {
+        std::string text = "\r" + prompt + line + "\x1b[K";
+        size_t back = characters(line.data() + cursor, line.size() - cursor);
+
+        if ( back > 0 ) text += "\x1b[" + std::to_string(back) + "D";
+
+        output(text);
+    }
+
+    /**
+     * Laço de edição da linha.
+    */
+    bool edit(const std::string & prompt, std::string & line) {
+        std::string draft;
+        size_t cursor = 0;
+        size_t position = 0;        // Comando do histórico exibido (0 ou size + 1 é a linha nova)
+
+        line.clear();
+
+        while ( true ) {
+            int key = readKey();
+
+            if ( key == CTRL_R ) key = search(line, cursor);
+
+            switch ( key ) {
+                case -1:
+                    return !line.empty();
+
+                case ENTER:
+                case NEWLINE:
+                    return true;
+
+                case CTRL_C:
+                    output("^C");
+                    line.clear();
+                    return true;
+
+                case CTRL_D:
+                    if ( line.empty() ) return false;
+                    // Fora da linha vazia, apaga o caracter sob o cursor
+                    [[fallthrough]];
+                case DELETE:
+                    if ( cursor < line.size() ) line.erase(cursor, next(line, cursor) - cursor);
+                    break;
+
+                case BACKSPACE:
+                case DEL:
+                    if ( cursor > 0 ) {
+                        size_t start = previous(line, cursor);
+                        line.erase(start, cursor - start);
+                        cursor = start;
+                    }
+                    break;
+
+                case LEFT: if ( cursor > 0 ) cursor = previous(line, cursor); break;
+                case RIGHT: if ( cursor < line.size() ) cursor = next(line, cursor); break;
+                case CTRL_A: case HOME: cursor = 0; break;
+                case CTRL_E: case END: cursor = line.size(); break;
+                case CTRL_U: line.erase(0, cursor); cursor = 0; break;
+                case CTRL_K: line.erase(cursor); break;
+
+                case UP:
+                case DOWN: {
+                    size_t size = history.size();
+
+                    // O histórico só é indexado quando é consultado, e não a cada linha lida
+                    if ( position == 0 or position > size + 1 ) position = size + 1;
+
+                    if ( key == UP and position > 1 ) {
+                        if ( position == size + 1 ) draft = line;
+                        history.get(--position, line);
+                    }
+                    else if ( key == DOWN and position <= size ) {
+                        if ( ++position == size + 1 ) line = draft;
+                        else history.get(position, line);
+                    }
+
+                    cursor = line.size();
+                    break;
+                }
+
+                case TAB:
+                    complete(line, cursor);
+                    break;
+
+                default:
+                    // Caracteres de controle não tratados são ignorados
+                    if ( key >= 32 and key < 256 ) line.insert(cursor++, 1, (char) key);
+
+                    // O diretório digitado começa a ser lido antes do Tab
+                    if ( key == '/' ) completer.prefetch(line, cursor);
+            }
+
+            refresh(prompt, line, cursor);
+        }
+    }
+
+    /**
+     * Completa a palavra sob o cursor (Tab). Enquanto o diretório da palavra
+     * é lido em segundo plano, a espera é interrompida por qualquer tecla.
+     * 
+     * @param[in, out] line A linha
+     * @param[in, out] cursor A posição do cursor
+    */
+    void complete(std::string & line, size_t & cursor) {
+        Completer::Completion completion;
+        struct pollfd input = { STDIN_FILENO, POLLIN, 0 };
+
+        while ( !completer.complete(line, cursor, completion, 100) )
+            if ( poll(&input, 1, 10) != 0 ) return;
+
+        if ( completion.total == 0 ) {
+            output("\a");
+            return;
+        }
+
+        std::string word = line.substr(completion.start, cursor - completion.start);
+
+        if ( completion.text != word ) {
+            line.replace(completion.start, word.size(), completion.text);
+            cursor = completion.start + completion.text.size();
+            return;
+        }
+
+        if ( completion.total < 2 ) return;
+
+        // Nada a acrescentar: as opções são exibidas em colunas abaixo da linha
+        struct winsize size;
+        size_t width = ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 and size.ws_col > 0 ? size.ws_col : 80;
+        size_t column = 0;
+
+        for ( auto & choice: completion.choices ) column = std::max(column, characters(choice.data(), choice.size()) + 2);
+
+        size_t columns = std::max<size_t>(1, width / column);
+        size_t rows = ( completion.choices.size() + columns - 1 ) / columns;
+        std::string text = "\r\n";
+
+        for ( size_t row = 0; row < rows; row++ ) {
+            for ( size_t i = row; i < completion.choices.size(); i += rows ) {
+                const std::string & choice = completion.choices[i];
+                text += choice;
+                if ( i + rows < completion.choices.size() )
+                    text += std::string(column - characters(choice.data(), choice.size()), ' ');
+            }
+
+            text += "\r\n";
+        }
+
+        if ( completion.total > completion.choices.size() )
+            text += "... e mais " + std::to_string(completion.total - completion.choices.size()) + " opções\r\n";
+
+        output(text);
+    }
+
+    /**
+     * Busca reversa incremental (Ctrl-R).
+     * 
+     * @param[in, out] line A linha, substituída pelo comando encontrado ao aceitar a busca
+     * @param[in, out] cursor A posição do cursor
+     * @return A tecla que encerrou a busca, a ser tratada pelo editor (0 quando cancelada).
+    */
+    int search(std::string & line, size_t & cursor) {
+        std::string query, match;
+        size_t found = history.size() + 1;
+        bool failed = false;
+
+        while ( true ) {
+            output("\r" + std::string(failed ? "(busca reversa falhou)`" : "(busca reversa)`") + query + "': " + match + "\x1b[K");
+
+            int key = readKey();
+
+            if ( key == CTRL_R or ( key >= 32 and key < 256 ) or key == BACKSPACE or key == DEL ) {
+                size_t before = found;
+
+                if ( key == CTRL_R ) {
+                    if ( query.empty() ) continue;
+                }
+                else {
+                    if ( key == BACKSPACE or key == DEL ) {
+                        if ( !query.empty() ) query.erase(previous(query, query.size()));
+                    }
+                    else query += (char) key;
+
+                    // Um novo texto recomeça a busca pelo comando mais recente
+                    before = history.size() + 1;
+                }
+
+                size_t number = query.empty() ? 0 : history.search(query, before);
+
+                failed = number == 0 and !query.empty();
+
+                if ( number != 0 ) {
+                    found = number;
+                    history.get(number, match);
+                }
+                else if ( query.empty() ) match.clear(), found = history.size() + 1;
+
+                continue;
+            }
+
+            // Ctrl-G e Esc cancelam a busca e mantêm a linha original
+            if ( key == CTRL_G or key == ESC ) return 0;
+
+            line = match;
+            cursor = line.size();
+
+            return key;
+        }
+    }
+
+    /**
+     * Posição do caracter UTF-8 anterior ao cursor.
+    */
+    static size_t previous(const std::string & text, size_t cursor) {
+        while ( cursor > 0 and ( text[--cursor] & 0xC0 ) == 0x80 );
+        return cursor;
+    }
+
+    /**
+     * Posição do caracter UTF-8 seguinte ao cursor.
+    */
+    static size_t next(const std::string & text, size_t cursor) {
+        while ( ++cursor < text.size() and ( text[cursor] & 0xC0 ) == 0x80 );
+        return cursor;
+    }
+
+    History & history;
+    Completer completer;
+};
+
+/**
+ * Prompt do shell.
+ * 
+ * O usuário, o dispositivo e o diretório home são obtidos uma única vez,
+ * e o diretório atual é informado pelo comando cd, sem consultar o kernel
+ * a cada prompt. O formato é compilado uma vez em segmentos, e o texto
+ * só é montado novamente quando o formato ou o diretório muda.
+ * 
+ * Sequências do formato:
+ *   \u usuário, \h dispositivo (até o primeiro '.'), \H dispositivo,
+ *   \w diretório atual (com ~), \W nome do diretório atual,
+ *   \$ '#' para o root e '$' para os demais, \n nova linha, \\ barra,
+ *   \e[...m cor ANSI (omitida quando a saída não é um terminal).
+*/
+class Prompt {
+
+    public:
+
+    /// @brief Formato padrão, equivalente ao prompt original do shell
+    static constexpr const char *DEFAULT_FORMAT = "\\e[36m\\n\\n\\u@\\H \\e[32m\\w  \\e[37m$ ";
+
+    /// @brief Estatísticas do tempo de exibição do prompt, em microssegundos
+    struct Stats {
+        size_t renders;
+        size_t rebuilds;
+        double last;
+        double mean;
+        double max;
+    };
+
+    Prompt() {
+        user = Runner::getCurrentUser();
+        host = Runner::getHostname();
+
+        const char *env = getenv("HOME");
+        if ( env != nullptr ) home = env;
+
+        // Mantém o caminho lógico herdado em $PWD, caso ele ainda aponte para o diretório atual
+        const char *pwd = getenv("PWD");
+        struct stat logical, physical;
+
+        if ( pwd != nullptr and pwd[0] == '/' and stat(pwd, &logical) == 0 and stat(".", &physical) == 0 and
+             logical.st_dev == physical.st_dev and logical.st_ino == physical.st_ino )
+            directory = Runner::normalizePath(pwd);
+        else directory = Runner::getCurrentDirectory();
+
+        setFormat(DEFAULT_FORMAT);
+    }
+
+    /**
+     * Compila um formato de prompt em segmentos.
+     * 
+     * @param[in] format O formato
+     * @return status da operação (SYNTAX_FAILURE para uma sequência inválida)
+    */
+    int setFormat(const std::string & format) {
+        std::vector<Segment> compiled;
+
+        for ( size_t i = 0; i < format.size(); i++ ) {
+            if ( format[i] != '\\' ) {
+                addText(compiled, std::string(1, format[i]));
+                continue;
+            }
+
+            if ( ++i == format.size() ) return SYNTAX_FAILURE;
+
+            switch ( format[i] ) {
+                case 'u': compiled.push_back({ USER, "" }); break;
+                case 'h': compiled.push_back({ HOST, "" }); break;
+                case 'H': compiled.push_back({ FULL_HOST, "" }); break;
+                case 'w': compiled.push_back({ DIRECTORY, "" }); break;
+                case 'W': compiled.push_back({ BASENAME, "" }); break;
+                case '$': addText(compiled, geteuid() == 0 ? "#" : "$"); break;
+                case 'n': addText(compiled, "\n"); break;
+                case '\\': addText(compiled, "\\"); break;
+                case 'e': {
+                    size_t end = format.find('m', i);
+                    if ( end == std::string::npos ) return SYNTAX_FAILURE;
+
+                    compiled.push_back({ COLOR, "\x1b" + format.substr(i + 1, end - i) });
+                    i = end;
+                    break;
+                }
+                default: return SYNTAX_FAILURE;
+            }
+        }
+
+        segments = std::move(compiled);
+        this->format = format;
+        dirty = true;
+
+        return EXIT_SUCCESS;
+    }
+
+    const std::string & getFormat() const {
+        return format;
+    }
+
+    /**
+     * Informa o novo diretório atual, após uma mudança de diretório.
+     * 
+     * @param[in] path O caminho absoluto do diretório
+    */
+    void setDirectory(const std::string & path) {
+        if ( path == directory ) return;
+
+        directory = path;
+        dirty = true;
+    }
+
+    const std::string & getDirectory() const {
+        return directory;
+    }
+
+    /**
+     * Obtém o texto do prompt, montando-o apenas se algo mudou.
+     * 
+     * @return O texto do prompt.
+    */
+    const std::string & render() {
+        stats.renders++;
+
+        if ( !dirty ) return text;
+
+        bool colors = OutputBuffer::instance().isTerminal();
+
+        text.clear();
+
+        for ( auto & segment: segments ) {
+            switch ( segment.type ) {
+                case TEXT: text += segment.text; break;
+                case COLOR: if ( colors ) text += segment.text; break;
+                case USER: text += user; break;
+                case HOST: text += host.substr(0, host.find('.')); break;
+                case FULL_HOST: text += host; break;
+                case DIRECTORY: text += getDisplayDirectory(); break;
+                case BASENAME: text += directory == "/" ? "/" : directory.substr(directory.rfind('/') + 1); break;
+            }
+        }
+
+        stats.rebuilds++;
+        dirty = false;
+
+        return text;
+    }
+
+    /**
+     * Registra o tempo gasto para exibir o prompt.
+     * 
+     * @param[in] elapsed O tempo gasto
+    */
+    void record(const std::chrono::steady_clock::duration & elapsed) {
+        double micros = std::chrono::duration<double, std::micro>(elapsed).count();
+
+        stats.last = micros;
+        stats.max = std::max(stats.max, micros);
+        total += micros;
+        samples++;
+        stats.mean = total / samples;
+    }
+
+    Stats getStats() const {
+        return stats;
+    }
+
+    private:
+
+    enum SegmentType { TEXT, COLOR, USER, HOST, FULL_HOST, DIRECTORY, BASENAME };
+
+    struct Segment {
+        SegmentType type;
+        std::string text;
+    };
+
+    /**
+     * Adiciona um texto fixo, juntando-o ao segmento anterior quando possível.
+    */
+    static void addText(std::vector<Segment> & compiled, const std::string & value) {
+        if ( !compiled.empty() and compiled.back().type == TEXT ) compiled.back().text += value;
+        else compiled.push_back({ TEXT, value });
+    }
+
+    /**
+     * Obtém o diretório atual com o diretório home abreviado para "~".
+    */
+    std::string getDisplayDirectory() const {
+        if ( !home.empty() and home != "/" and directory.compare(0, home.size(), home) == 0 and
+             ( directory.size() == home.size() or directory[home.size()] == '/' ) )
+            return "~" + directory.substr(home.size());
+
+        return directory;
+    }
+
+    std::vector<Segment> segments;
+    std::string format;
+    std::string user;
+    std::string host;
+    std::string home;
+    std::string directory;
+    std::string text;               // Texto montado na última mudança
+    bool dirty = true;
+    double total = 0;
+    size_t samples = 0;
+    Stats stats = {};
+};
+
+/**
+ * Implementação do Shell
+ * 
+ * É utilizada para representar um shell simples.
+*/
+class Shell {
+
+    private:
+
+    /// @brief Assinatura das funções que executam os comandos internos.
+    using Handler = int (Shell::*)(std::vector<std::string> & args);
+
+    /// @brief Tabela de despacho dos comandos internos, indexada pelo nome.
+    static const std::unordered_map<std::string, Handler> commands;
+
+    /**
+     * Obtém o caminho no formato ./caminho/qualquer.
+     * 
+     * @param[in, out] arg O caminho a ser convertido.
+    */
+    void getPath(std::string & arg) {
+        if ( arg.empty() ) return;
+
+        if ( arg[0] == '~' and ( arg.size() == 1 or arg[1] == '/' ) ) {
+            const char *home = getenv("HOME");
+            if ( home != nullptr ) arg.replace(0, 1, home);
+        }
+
+        if ( not (arg[0] == '/' or ( arg[0] == '.' and arg[1] == '/') ) )
+            arg = "./" + arg;
+    }
+
+    /**
+     * Valida a quantidade de caminhos passados a um comando e os converte
+     * para o formato ./caminho/qualquer.
+     * 
+     * @param[in, out] args Os argumentos do comando, incluindo o seu nome.
+     * @param[in] count A quantidade de caminhos esperada.
+     * @param[in] missing Mensagem exibida quando nenhum caminho é informado.
+     * @return true caso os caminhos sejam válidos.
+    */
+    bool getPathArgs(std::vector<std::string> & args, const size_t & count,
+                     const std::string & missing = "É necessário especificar o caminho correto do arquivo.") {
+
+        if ( args.size() == 1 ) {
+            Runner::display(missing, 'e');
+            return false;
+        }
+
+        if ( args.size() != count + 1 ) {
+            Runner::display("Parâmetros inválidos.\n", 'e');
+            Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas no início e no fim.\n");
+            Runner::display(count == 1 ? "OBS 2: Este comando aceita apenas um parâmetro."
+                                       : "OBS 2: Este comando aceita apenas dois parâmetros.");
+            return false;
+        }
+
+        for ( size_t i = 1; i < args.size(); i++ ) {
+            if ( args[i].empty() ) {
+                Runner::display(missing, 'e');
+                return false;
+            }
+
+            getPath(args[i]);
+        }
+
+        return true;
+    }
+
+    /**
+     * Valida os caminhos passados a um comando que aceita vários caminhos
+     * (e.g. os gerados por um glob) e os converte para o formato ./caminho/qualquer.
+     * 
+     * @param[in, out] args Os argumentos do comando, incluindo o seu nome.
+     * @param[in] minimum A quantidade mínima de caminhos.
+     * @param[in] missing Mensagem exibida quando faltam caminhos.
+     * @return true caso os caminhos sejam válidos.
+    */
+    bool getPathList(std::vector<std::string> & args, const size_t & minimum,
+                     const std::string & missing = "É necessário especificar o caminho correto do arquivo.") {
+
+        if ( args.size() < minimum + 1 ) {
+            Runner::display(missing, 'e');
+            return false;
+        }
+
+        for ( size_t i = 1; i < args.size(); i++ ) {
+            if ( args[i].empty() ) {
+                Runner::display(missing, 'e');
+                return false;
+            }
+
+            getPath(args[i]);
+        }
+
+        return true;
+    }
+
+    /**
+     * Converte a quantidade de threads passada com -j. O valor é limitado
+     * a quatro threads por núcleo, pois cada uma reserva a sua pilha e
+     * valores muito grandes esgotam os recursos do processo.
+     * 
+     * @param[in] value O valor informado pelo usuário
+     * @param[out] threads A quantidade de threads
+     * @return true caso o valor seja válido.
+    */
+    bool getThreadCount(const std::string & value, size_t & threads) {
+        if ( value.empty() or value.size() > 9 or value.find_first_not_of("0123456789") != std::string::npos )
+            return false;
+
+        threads = std::min<size_t>(std::stoul(value), 4 * std::max(1u, std::thread::hardware_concurrency()));
+
+        return threads > 0;
+    }
+
+    /**
+     * Substitui os tokens com padrões de glob pelos caminhos encontrados,
+     * atualizando as posições dos estágios do pipeline. Um padrão sem
+     * nenhum caminho correspondente é mantido, como no bash.
+     * 
+     * @param[in, out] args Os tokens da linha de comando
+     * @param[in, out] pipes Os índices dos tokens que iniciam cada estágio
+     * @param[in] patterns O padrão de cada token (vazio quando não há glob)
+    */
+    void expandGlobs(std::vector<std::string> & args, std::vector<size_t> & pipes,
+                     const std::vector<std::string> & patterns) {
+        std::vector<std::string> expanded, paths;
+        size_t pipe = 0;
+
+        for ( size_t i = 0; i < args.size(); i++ ) {
+            while ( pipe < pipes.size() and pipes[pipe] == i ) pipes[pipe++] = expanded.size();
+
+            Glob glob(patterns[i]);
+
+            if ( patterns[i].empty() or !glob.isValid() or glob.expand(paths) == 0 ) {
+                expanded.push_back(std::move(args[i]));
+                continue;
+            }
+
+            for ( auto & path: paths ) expanded.push_back(std::move(path));
+        }
+
+        while ( pipe < pipes.size() ) pipes[pipe++] = expanded.size();
+
+        args = std::move(expanded);
+    }
+
+    // Comando de saída do shell
+    int exitCommand(std::vector<std::string> & args) {
+        if ( args.size() > 2 or ( args.size() == 2 and
+             ( args[1].empty() or args[1].size() > 9 or args[1].find_first_not_of("0123456789") != std::string::npos ) ) ) {
+            Runner::display("Parâmetros inválidos.\n", 'e');
+            Runner::display("USO: exit [status]");
+            return EXIT_FAILURE;
+        }
+
+        isRunning = false;
+
+        // Sem argumentos, o shell termina com o status do último comando
+        return args.size() == 2 ? std::stoi(args[1]) & 0xff : lastStatus;
+    }
+
+    // Apresenta a lista de comandos ou a ajuda de um comando específico
+    int helpCommand(std::vector<std::string> & args) {
+        if ( args.size() == 1 ) Runner::display(getHelpText());
+        else Runner::display(Runner::getCommandDescription(args[1]));
+
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para mostrar um texto
+    int echoCommand(std::vector<std::string> & args) {
+        std::string text;
+
+        for ( size_t i = 1; i < args.size(); i++ ) {
+            if ( i > 1 ) text += ' ';
+            text += args[i];
+        }
+
+        Runner::display(text);
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para limpar a tela do shell
+    int clearCommand(std::vector<std::string> &) {
+        Runner::clear();
+        return EXIT_SUCCESS;
+    }
+
+    // Comando de alteração de diretório
+    int cdCommand(std::vector<std::string> & args) {
+        if ( !getPathArgs(args, 1, "É necessário especificar o diretório de destino.") )
+            return EXIT_FAILURE;
+
+        // O caminho lógico é mantido pelo prompt, de forma que ".." desfaz o último "cd" mesmo após links simbólicos
+        std::string target = Runner::normalizePath(args[1][0] == '/' ? args[1] : prompt.getDirectory() + "/" + args[1]);
+
+        if ( Runner::changeDirectory(target) == 0 ) prompt.setDirectory(target);
+        else if ( Runner::changeDirectory(args[1]) == 0 ) prompt.setDirectory(Runner::getCurrentDirectory());
+        else {
+            Runner::display("Diretório não encontrado: " + args[1], 'e');
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para exibir o atual diretório
+    int pwdCommand(std::vector<std::string> & args) {
+        if ( args.size() != 1 ) return invalidCommand(args);
+
+        Runner::display(prompt.getDirectory());
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para consultar e configurar o formato do prompt
+    int promptCommand(std::vector<std::string> & args) {
+        if ( args.size() == 1 ) Runner::display(prompt.getFormat());
+        else if ( args.size() == 2 and args[1] == "reset" ) prompt.setFormat(Prompt::DEFAULT_FORMAT);
+        else if ( args.size() == 2 and args[1] == "stats" ) {
+            Prompt::Stats stats = prompt.getStats();
+            std::stringstream ss;
+
+            ss << std::fixed << std::setprecision(1);
+            ss << padRight("Exibições", 16) << stats.renders << '\n';
+            ss << padRight("Montagens", 16) << stats.rebuilds << '\n';
+            ss << padRight("Último", 16) << stats.last << " us\n";
+            ss << padRight("Média", 16) << stats.mean << " us\n";
+            ss << padRight("Máximo", 16) << stats.max << " us";
+
+            Runner::display(ss.str());
+        }
+        else if ( args.size() == 2 and prompt.setFormat(args[1]) == EXIT_SUCCESS ) return EXIT_SUCCESS;
+        else {
+            Runner::display("Parâmetros inválidos.\n", 'e');
+            Runner::display("USO: prompt | prompt <formato> | prompt reset | prompt stats");
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para listar os itens do diretório atual
+    int lsCommand(std::vector<std::string> & args) {
+        bool a = false, l = false, unsorted = false;
+        std::vector<std::string> operands;
+
+        for ( size_t i = 1; i < args.size(); i++ ) {
+            if ( args[i].size() < 2 or args[i][0] != '-' ) {
+                operands.push_back(args[i]);
+                continue;
+            }
+
+            if ( args[i].find_first_not_of("alU", 1) != std::string::npos ) {
+                Runner::display("Parâmetros inválidos.", 'e');
+                return EXIT_FAILURE;
+            }
+
+            a |= args[i].find('a') != std::string::npos;
+            l |= args[i].find('l') != std::string::npos;
+            unsorted |= args[i].find('U') != std::string::npos;
+        }
+
+        if ( operands.empty() ) return listDirectory(".", a, l, unsorted) == EXIT_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+
+        // Como no ls do sistema, os arquivos são exibidos primeiro e depois cada diretório
+        std::vector<std::string> files, directories, missing;
+        bool failed = false;
+
+        for ( auto & operand: operands ) {
+            std::string path = operand;
+            struct stat st;
+
+            getPath(path);
+
+            if ( stat(path.c_str(), &st) < 0 and lstat(path.c_str(), &st) < 0 ) missing.push_back(operand);
+            else if ( S_ISDIR(st.st_mode) ) directories.push_back(operand);
+            else files.push_back(operand);
+        }
+
+        if ( !missing.empty() ) {
+            Runner::display("Arquivo ou diretório não encontrado: " + join(missing, ", ") + "\n", 'e');
+            failed = true;
+        }
+
+        if ( !files.empty() ) {
+            std::string output;
+
+            if ( l ) {
+                DirListing listing;
+                std::vector<Runner::EntryInfo> entries;
+
+                for ( auto & file: files ) listing.add(file.c_str(), file.size(), DT_UNKNOWN, 0);
+
+                entries.assign(listing.size(), Runner::EntryInfo());
+
+                for ( size_t i = 0; i < listing.size(); i++ ) {
+                    std::string path = files[i];
+                    char link[PATH_MAX];
+
+                    getPath(path);
+                    entries[i].valid = statx(AT_FDCWD, path.c_str(), AT_SYMLINK_NOFOLLOW, STATX_BASIC_STATS, &entries[i].stx) == 0;
+
+                    ssize_t n = entries[i].valid and S_ISLNK(entries[i].stx.stx_mode) ? readlink(path.c_str(), link, sizeof link) : -1;
+                    if ( n > 0 ) entries[i].link.assign(link, n);
+                }
+
+                output = Runner::formatLongListing(listing, entries);
+            }
+            else output = join(files, isatty(Runner::outputFd) ? "\t" : "\n") + "\n";
+
+            Runner::display(output);
+        }
+
+        for ( size_t i = 0; i < directories.size(); i++ ) {
+            std::string path = directories[i];
+
+            if ( operands.size() > 1 ) Runner::display(( i > 0 or !files.empty() ? "\n" : "" ) + directories[i] + ":\n");
+
+            getPath(path);
+            failed |= listDirectory(path, a, l, unsorted) != EXIT_SUCCESS;
+        }
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    /**
+     * Exibe os itens de um diretório (ls).
+     * 
+     * @param[in] path O diretório
+     * @param[in] a Exibe os itens ocultos
+     * @param[in] l Listagem longa
+     * @param[in] unsorted Exibe os itens na ordem do diretório
+     * @return status da operação
+    */
+    int listDirectory(const std::string & path, const bool & a, const bool & l, const bool & unsorted) {
+        if ( l ) {
+            std::vector<Runner::EntryInfo> entries;
+            DirListing listing;
+
+            if ( Runner::getLongListing(path, a, !unsorted, listing, entries) != EXIT_SUCCESS ) {
+                Runner::display("Diretório não encontrado!", 'e');
+                return OPEN_FAILURE;
+            }
+
+            Runner::display(Runner::formatLongListing(listing, entries));
+            return EXIT_SUCCESS;
+        }
+
+        // Os nomes são exibidos em blocos, à medida que são obtidos, um por linha fora do terminal
+        std::string output;
+        char separator = isatty(Runner::outputFd) ? '\t' : '\n';
+
+        auto print = [&output, separator](const char *name, const size_t & length, const unsigned char &, const uint64_t &) {
+            output.append(name, length);
+            output += separator;
+
+            if ( output.size() >= STREAM_BUFFER_SIZE ) {
+                Runner::display(output);
+                output.clear();
+            }
+        };
+
+        std::shared_ptr<const DirListing> listing;
+        int status;
+
+        if ( unsorted ) status = Runner::streamDirectory(path, a, print);
+        else if ( ( status = DirectoryCache::instance().get(path, listing) ) == EXIT_SUCCESS ) {
+            for ( size_t i = 0; i < listing->size(); i++ )
+                if ( a or listing->name(i)[0] != '.' )
+                    print(listing->name(i), listing->length(i), listing->type(i), listing->inode(i));
+        }
+
+        // Diretórios grandes demais para o cache são ordenados em blocos
+        else if ( status == MALLOC_FAILURE ) status = Runner::listDirectorySorted(path, a, print);
+
+        Runner::display(output);
+
+        if ( status == OPEN_FAILURE ) Runner::display("Diretório não encontrado!", 'e');
+        else if ( status != EXIT_SUCCESS ) Runner::display("Erro ao realizar a leitura do diretório.", 'e');
+
+        return status;
+    }
+
+    // Comando para consultar e configurar o cache de listagens de diretórios
+    int cacheCommand(std::vector<std::string> & args) {
+        DirectoryCache & cache = DirectoryCache::instance();
+
+        if ( args.size() == 2 and args[1] == "stats" ) {
+            DirectoryCache::Stats stats = cache.getStats();
+            size_t lookups = stats.hits + stats.misses;
+            std::stringstream ss;
+
+            ss << padRight("Acertos", 16) << stats.hits << '\n';
+            ss << padRight("Falhas", 16) << stats.misses << '\n';
+            ss << padRight("Taxa de acerto", 16) << std::fixed << std::setprecision(1);
+            ss << ( lookups ? 100.0 * stats.hits / lookups : 0.0 ) << "%\n";
+            ss << padRight("Invalidações", 16) << stats.invalidations << '\n';
+            ss << padRight("Descartes", 16) << stats.evictions << '\n';
+            ss << padRight("Diretórios", 16) << stats.entries << '\n';
+            ss << padRight("Memória", 16) << stats.memory / 1024 << " KB de ";
+            ss << stats.limit / 1024 << " KB";
+
+            Runner::display(ss.str());
+        }
+        else if ( args.size() == 2 and args[1] == "clear" ) {
+            cache.clear();
+            Runner::display("Cache esvaziado!");
+        }
+        // O limite em bytes precisa caber em um size_t
+        else if ( args.size() == 3 and args[1] == "limit" and !args[2].empty() and args[2].size() <= 9 and
+                  args[2].find_first_not_of("0123456789") == std::string::npos and
+                  std::stoul(args[2]) <= SIZE_MAX / ( 1024 * 1024 ) ) {
+            cache.setLimit(std::stoul(args[2]) * 1024 * 1024);
+            Runner::display("Limite do cache alterado para " + args[2] + " MB.");
+        }
+        else {
+            Runner::display("Parâmetros inválidos.\n", 'e');
+            Runner::display("USO: cache stats | cache clear | cache limit <MB>");
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para visualizar o conteúdo de um arquivo
+    int catCommand(std::vector<std::string> & args) {
+        int status;
+
+        // Sem argumentos, a entrada é copiada para a saída (e.g. no meio de um pipeline)
+        if ( args.size() == 1 ) {
+            Runner::flush();
+            status = Runner::streamDescriptor(Runner::inputFd, Runner::outputFd);
+            return status == EXIT_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        if ( !getPathList(args, 1) ) return EXIT_FAILURE;
+
+        bool failed = false;
+
+        // Os arquivos são concatenados na ordem dos argumentos
+        for ( size_t i = 1; i < args.size(); i++ ) {
+            // Garante que as mensagens pendentes sejam exibidas antes do conteúdo
+            Runner::flush();
+
+            status = Runner::streamFileContent(args[i], Runner::outputFd);
+            failed |= status < 0;
+
+            if ( status  == OPEN_FAILURE ) {
+                Runner::display("Arquivo não encontrado: " + args[i] + "\n", 'e');
+                Runner::display("OBS 1: Verifique se o caminho para o arquivo está correto.\n");
+                Runner::display("OBS 2: É necessário informar a extensão do arquivo.\n");
+            }
+            else if ( status == READ_FAILURE ) Runner::display("Erro ao realizar a leitura do arquivo: " + args[i], 'e');
+            // O leitor do pipeline pode encerrar antes do fim do arquivo (e.g. "cat x | head")
+            else if ( status == WRITE_FAILURE ) {
+                if ( errno != EPIPE ) Runner::display("Erro ao escrever o conteúdo do arquivo.", 'e');
+                break;
+            }
+        }
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    // Comando para criar um arquivo em branco
+    int touchCommand(std::vector<std::string> & args) {
+        if ( !getPathArgs(args, 1) ) return EXIT_FAILURE;
+
+        if ( Runner::createBlankFile(args[1]) == OPEN_FAILURE ) {
+            Runner::display("O arquivo não pode ser criado!", 'e');
+            return EXIT_FAILURE;
+        }
+
+        Runner::display("Arquivo gerado com sucesso!");
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para copiar arquivos e diretórios
+    int cpCommand(std::vector<std::string> & args) {
+        std::vector<std::string> paths = { args[0] };
+        bool recursive = false;
+        size_t threads = 0;
+
+        for ( size_t i = 1; i < args.size(); i++ ) {
+            const std::string & arg = args[i];
+
+            if ( arg == "-r" or arg == "-R" ) recursive = true;
+            else if ( arg.compare(0, 2, "-j") == 0 ) {
+                std::string value = arg.size() > 2 ? arg.substr(2) : ( i + 1 < args.size() ? args[++i] : "" );
+
+                if ( !getThreadCount(value, threads) ) {
+                    Runner::display("Quantidade de threads inválida: " + value, 'e');
+                    return EXIT_FAILURE;
+                }
+            }
+            else paths.push_back(arg);
+        }
+
+        if ( !getPathList(paths, 2, "É necessário especificar os nomes dos arquivos.") )
+            return EXIT_FAILURE;
+
+        std::string target = paths.back();
+        struct stat st;
+        bool intoDirectory = stat(target.c_str(), &st) == 0 and S_ISDIR(st.st_mode);
+
+        // Com várias origens (e.g. "cp *.txt backup") o destino precisa ser um diretório
+        if ( paths.size() > 3 and !intoDirectory ) {
+            Runner::display("Com várias origens, o destino precisa ser um diretório existente.", 'e');
+            return EXIT_FAILURE;
+        }
+
+        // Um único arquivo é copiado diretamente, sem criar as threads
+        std::unique_ptr<ThreadPool> pool;
+        if ( recursive or paths.size() > 3 ) pool.reset(new ThreadPool(threads));
+
+        Runner::CopyStats stats;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::string> errors;
+        int status = EXIT_SUCCESS;
+
+        // As origens são copiadas pelas mesmas threads, em paralelo
+        for ( size_t i = 1; i + 1 < paths.size(); i++ ) {
+            const std::string & source = paths[i];
+            std::string suffix = paths.size() > 3 ? ": " + source : "";
+
+            bool directory = stat(source.c_str(), &st) == 0 and S_ISDIR(st.st_mode);
+
+            if ( directory and !recursive ) {
+                errors.push_back("A origem é um diretório. Utilize cp -r para copiá-lo" + ( suffix.empty() ? "." : suffix ));
+                continue;
+            }
+
+            // Copiar para um diretório existente mantém o nome da origem
+            std::string destination = intoDirectory ? target + "/" + Runner::getBaseName(source) : target;
+
+            // A cópia de um diretório para dentro dele mesmo percorreria o próprio destino
+            if ( directory and Runner::isInside(destination, source) ) {
+                errors.push_back("O destino está dentro do diretório de origem" + ( suffix.empty() ? "." : suffix ));
+                continue;
+            }
+
+            int result;
+
+            if ( pool ) result = Runner::copyTree(*pool, source, destination, stats);
+            else {
+                off_t size = 0;
+
+                if ( ( result = Runner::copyContentFile(source, destination, &size) ) == EXIT_SUCCESS )
+                    stats.files++, stats.bytes += size;
+            }
+
+            if ( result  == OPEN_FAILURE ) errors.push_back("O arquivo de origem não pode ser encontrado" + ( suffix.empty() ? "!" : suffix ));
+            else if ( result  == READ_FAILURE ) errors.push_back("O arquivo de origem não pode ser lido" + ( suffix.empty() ? "!" : suffix ));
+            else if ( result == SAME_FILE ) errors.push_back("A origem e o destino são o mesmo arquivo" + ( suffix.empty() ? "!" : suffix ));
+            else if ( result  == WRITE_FAILURE) errors.push_back("O arquivo de destino não pode escrito" + ( suffix.empty() ? "!" : suffix ));
+
+            if ( result < 0 ) status = result;
+        }
+
+        // Exibe o progresso enquanto as threads copiam a árvore
+        while ( pool and !pool->wait(std::chrono::milliseconds(1000)) ) {
+            std::stringstream ss;
+            ss << "\rCopiando... " << stats.files << " arquivos, " << stats.bytes / ( 1 << 20 ) << " MB";
+            Runner::display(ss.str());
+            Runner::flush();
+        }
+
+        if ( pool and Runner::restoreDirectoryModes(stats) != EXIT_SUCCESS )
+            errors.push_back("As permissões dos diretórios copiados não puderam ser aplicadas.");
+
+        if ( !errors.empty() ) {
+            Runner::display(join(errors, "\n"), 'e');
+            return EXIT_FAILURE;
+        }
+
+        if ( !recursive ) Runner::display(paths.size() > 3 ? std::to_string(paths.size() - 2) + " arquivos copiados com sucesso!"
+                                                            : "Conteúdo copiado com sucesso!");
+        else {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double megabytes = stats.bytes / 1048576.0;
+            std::stringstream ss;
+
+            ss << std::fixed << std::setprecision(2);
+            ss << "\rCópia concluída: " << stats.files << " arquivos, " << stats.directories << " diretórios, ";
+            ss << megabytes << " MB em " << seconds << " s (" << megabytes / std::max(seconds, 1e-9) << " MB/s, ";
+            ss << pool->size() << " threads)";
+
+            if ( stats.failures > 0 ) {
+                Runner::display(ss.str() + "\n");
+                Runner::display(std::to_string(stats.failures) + " itens não puderam ser copiados.", 'e');
+                return EXIT_FAILURE;
+            }
+
+            Runner::display(ss.str());
+        }
+
+        return status < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    // Comando para criar um diretório
+    int mkdirCommand(std::vector<std::string> & args) {
+        if ( !getPathArgs(args, 1) ) return EXIT_FAILURE;
+
+        if ( Runner::createDirectory(args[1]) == EXIT_FAILURE ) {
+            Runner::display("Ocorreu um problema ao criar o diretório!", 'e');
+            return EXIT_FAILURE;
+        }
+
+        Runner::display("Diretório criado com sucesso!");
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para remover um diretório
+    int rmdirCommand(std::vector<std::string> & args) {
+        if ( !getPathArgs(args, 1) ) return EXIT_FAILURE;
+
+        std::string & arg = args[1];
+        if ( !Runner::isDirectoryEmpty(arg) ) {
+            Runner::display("Este diretório contém arquivos e/ou diretórios. Ao continuar, todos serão removidos.\n");
+            Runner::display("Deseja continuar [s/n]? ");
+            Runner::flush();
+            std::string res;
+
+            // A resposta vem da mesma entrada que os comandos
+            if ( !input.getLine(res) or trim(res) != "s" ) {
+                Runner::display("Diretório não removido!");
+                return EXIT_SUCCESS;
+            }
+        }
+
+        if ( Runner::removeDirectory(arg) == EXIT_FAILURE ) {
+            Runner::display("Ocorreu um problema ao remover o diretório!", 'e');
+            return EXIT_FAILURE;
+        }
+
+        Runner::display("Diretório removido com sucesso!");
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para remover um arquivo
+    int rmfileCommand(std::vector<std::string> & args) {
+        if ( !getPathList(args, 1) ) return EXIT_FAILURE;
+
+        std::vector<std::string> failures;
+
+        for ( size_t i = 1; i < args.size(); i++ )
+            if ( Runner::removeFile(args[i]) == EXIT_FAILURE ) failures.push_back(args[i]);
+
+        if ( failures.size() == 1 and args.size() == 2 ) Runner::display("O arquivo não pode ser removido!", 'e');
+        else if ( !failures.empty() ) {
+            Runner::display(std::to_string(failures.size()) + " arquivos não puderam ser removidos:\n", 'e');
+            Runner::display(join(failures, "\n"));
+        }
+
+        if ( !failures.empty() ) return EXIT_FAILURE;
+
+        Runner::display(args.size() == 2 ? "Arquivo removido com sucesso!"
+                                         : std::to_string(args.size() - 1) + " arquivos removidos com sucesso!");
+        return EXIT_SUCCESS;
+    }
+
+    // Move arquivos
+    int mvCommand(std::vector<std::string> & args) {
+        if ( !getPathList(args, 2, "É necessário especificar os nomes dos arquivos.") )
+            return EXIT_FAILURE;
+
+        // Várias origens (e.g. "mv *.log antigos") são movidas, uma a uma, para dentro do destino
+        if ( args.size() > 3 ) return moveMany(args);
+
+        Runner::CopyStats stats;
+        auto start = std::chrono::steady_clock::now();
+
+        int status = Runner::moveFiles(args[1], args[2], stats);
+        
+        if ( status  == FILE_FAILURE ) Runner::display("O arquivo de origem não pode ser encontrado!", 'e');
+        else if ( status  == SAME_FILE ) Runner::display("A origem e o destino são o mesmo arquivo!", 'e');
+        else if ( stats.move and status != EXIT_SUCCESS ) {
+            Runner::display("A cópia para o outro sistema de arquivos não foi concluída. A origem foi mantida.\n", 'e');
+            Runner::display("OBS: Execute o mesmo comando novamente para retomar a movimentação.");
+        }
+        else if ( status != EXIT_SUCCESS ) Runner::display("O arquivo não pode ser movido!", 'e');
+        else if ( stats.move ) {
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double megabytes = stats.bytes / 1048576.0;
+            std::stringstream ss;
+
+            ss << std::fixed << std::setprecision(2);
+            ss << "Movido entre sistemas de arquivos: " << stats.files << " arquivos, ";
+            ss << stats.directories << " diretórios, " << megabytes << " MB em " << seconds << " s (";
+            ss << megabytes / std::max(seconds, 1e-9) << " MB/s)";
+
+            if ( stats.skipped > 0 ) ss << ". " << stats.skipped << " arquivos já haviam sido copiados.";
+
+            Runner::display(ss.str());
+        }
+        else Runner::display("Arquivo movido com sucesso!");
+
+        return status == EXIT_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    /**
+     * Move várias origens para um diretório (mv com mais de dois caminhos).
+     * 
+     * @param[in] args Os argumentos do mv, com o diretório de destino no final
+     * @return status da operação
+    */
+    int moveMany(std::vector<std::string> & args) {
+        const std::string & target = args.back();
+        std::vector<std::string> failures;
+        Runner::CopyStats stats;
+        struct stat st;
+
+        if ( stat(target.c_str(), &st) < 0 or not S_ISDIR(st.st_mode) ) {
+            Runner::display("Com várias origens, o destino precisa ser um diretório existente.", 'e');
+            return EXIT_FAILURE;
+        }
+
+        for ( size_t i = 1; i + 1 < args.size(); i++ )
+            if ( Runner::moveFiles(args[i], target, stats) != EXIT_SUCCESS ) failures.push_back(args[i]);
+
+        if ( !failures.empty() ) {
+            Runner::display(std::to_string(failures.size()) + " itens não puderam ser movidos:\n", 'e');
+            Runner::display(join(failures, "\n"));
+            return EXIT_FAILURE;
+        }
+
+        Runner::display(std::to_string(args.size() - 2) + " itens movidos com sucesso!");
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Lê o valor de um filtro numérico do find (e.g. "+10M", "-7", "3").
+     * 
+     * @param[in] text O valor
+     * @param[out] range O filtro
+     * @param[in] units Sufixos aceitos e os seus tamanhos ("" para nenhum)
+     * @return false caso o valor seja inválido.
+    */
+    static bool parseRange(std::string text, FileFinder::Range & range, const std::string & units) {
+        range.mode = '=';
+
+        if ( !text.empty() and ( text[0] == '+' or text[0] == '-' ) ) {
+            range.mode = text[0];
+            text.erase(0, 1);
+        }
+
+        if ( !text.empty() and !units.empty() and !isdigit((unsigned char) text.back()) ) {
+            switch ( text.back() ) {
+                case 'c': range.unit = 1; break;
+                case 'k': range.unit = 1024; break;
+                case 'M': range.unit = 1024 * 1024; break;
+                case 'G': range.unit = 1024 * 1024 * 1024; break;
+                default: return false;
+            }
+
+            text.pop_back();
+        }
+
+        if ( text.empty() or text.size() > 18 or text.find_first_not_of("0123456789") != std::string::npos ) return false;
+
+        range.value = std::stoull(text);
+        return true;
+    }
+
+    // Comando para buscar arquivos em árvores de diretórios
+    int findCommand(std::vector<std::string> & args) {
+        FileFinder::Filter filter;
+        std::vector<std::string> roots;
+        size_t threads = 0;
+        size_t i = 1;
+
+        for ( ; i < args.size() and ( args[i].empty() or args[i][0] != '-' ); i++ ) roots.push_back(args[i]);
+
+        for ( ; i < args.size(); i++ ) {
+            const std::string & option = args[i];
+
+            if ( i + 1 >= args.size() ) {
+                Runner::display("Falta o valor de " + option + ".", 'e');
+                return EXIT_FAILURE;
+            }
+
+            const std::string & value = args[++i];
+            bool valid = true;
+
+            if ( option == "-name" ) valid = filter.names.emplace_back().compile(value, false) == EXIT_SUCCESS;
+            else if ( option == "-iname" ) {
+                std::string lower = value;
+                for ( auto & c: lower ) c = tolower((unsigned char) c);
+
+                valid = filter.lowerNames.emplace_back().compile(lower, false) == EXIT_SUCCESS;
+            }
+            else if ( option == "-prune" ) valid = filter.prune.emplace_back().compile(value, false) == EXIT_SUCCESS;
+            else if ( option == "-type" ) {
+                valid = value == "f" or value == "d" or value == "l";
+                filter.type = value[0];
+            }
+            else if ( option == "-size" ) {
+                filter.size.unit = 512;             // Sem sufixo, o tamanho é em blocos de 512 bytes, como no find
+                valid = parseRange(value, filter.size, "ckMG");
+            }
+            else if ( option == "-mtime" ) valid = parseRange(value, filter.age, "");
+            else if ( option == "-j" ) valid = getThreadCount(value, threads);
+            else if ( option == "-mindepth" or option == "-maxdepth" ) {
+                valid = !value.empty() and value.size() < 10 and value.find_first_not_of("0123456789") == std::string::npos;
+
+                size_t number = valid ? std::stoul(value) : 0;
+
+                if ( option == "-mindepth" ) filter.minDepth = number;
+                else filter.maxDepth = number;
+            }
+            else {
+                Runner::display("Parâmetro desconhecido: " + option + "\n", 'e');
+                Runner::display("USO: find [caminhos...] [-name padrão] [-iname padrão] [-type f|d|l] [-size [+|-]N[c|k|M|G]]");
+                Runner::display(" [-mtime [+|-]dias] [-mindepth N] [-maxdepth N] [-prune padrão] [-j threads]");
+                return EXIT_FAILURE;
+            }
+
+            if ( !valid ) {
+                Runner::display("Valor inválido para " + option + ": " + value, 'e');
+                return EXIT_FAILURE;
+            }
+        }
+
+        if ( roots.empty() ) roots.push_back(".");
+
+        // Os caminhos são gravados diretamente na saída, depois das mensagens pendentes
+        Runner::flush();
+
+        FileFinder finder(filter, Runner::outputFd);
+        ThreadPool pool(threads);
+        std::vector<std::string> missing;
+
+        for ( auto & root: roots ) {
+            std::string path = root;
+
+            if ( path[0] == '~' and ( path.size() == 1 or path[1] == '/' ) ) getPath(path);
+            if ( finder.start(pool, path) == OPEN_FAILURE ) missing.push_back(root);
+        }
+
+        pool.wait();
+
+        // O leitor do pipeline pode encerrar antes do fim da busca (e.g. "find | head")
+        if ( finder.finish() == WRITE_FAILURE and errno != EPIPE ) {
+            Runner::display("Erro ao escrever os resultados da busca.", 'e');
+            return EXIT_FAILURE;
+        }
+
+        if ( !missing.empty() ) Runner::display("Caminho não encontrado: " + join(missing, ", "), 'e');
+
+        if ( finder.getStats().failures > 0 )
+            Runner::display(std::to_string(finder.getStats().failures) + " itens não puderam ser lidos.", 'e');
+
+        return missing.empty() and finder.getStats().failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Comando para buscar linhas em arquivos
+    int grepCommand(std::vector<std::string> & args) {
+        Grep::Options options;
+        std::vector<std::string> files;
+        std::string pattern;
+        bool hasPattern = false;
+        size_t threads = 0;
+
+        for ( size_t i = 1; i < args.size(); i++ ) {
+            const std::string & arg = args[i];
+
+            if ( hasPattern or arg.size() < 2 or arg[0] != '-' ) {
+                if ( hasPattern ) files.push_back(arg);
+                else pattern = arg, hasPattern = true;
+                continue;
+            }
+
+            if ( arg == "-j" and i + 1 < args.size() and args[i + 1].size() < 10 and
+                 args[i + 1].find_first_not_of("0123456789") == std::string::npos ) {
+                threads = std::stoul(args[++i]);
+                continue;
+            }
+
+            // Opções combinadas, e.g. -cv
+            for ( size_t k = 1; k < arg.size(); k++ ) {
+                switch ( arg[k] ) {
+                    case 'c': options.count = true; break;
+                    case 'l': options.list = true; break;
+                    case 'n': options.number = true; break;
+                    case 'v': options.invert = true; break;
+                    case 'F': options.fixed = true; break;
+                    case 'E': break;
+                    case 'i': options.ignoreCase = true; break;
+                    default:
+                        Runner::display("Parâmetro desconhecido: " + arg + "\n", 'e');
+                        Runner::display("USO: grep [-c] [-l] [-n] [-v] [-i] [-F] [-j threads] <padrão> [arquivos...]");
+                        return 2;
+                }
+            }
+        }
+
+        if ( !hasPattern ) {
+            Runner::display("É necessário informar o padrão.\n", 'e');
+            Runner::display("USO: grep [-c] [-l] [-n] [-v] [-i] [-F] [-j threads] <padrão> [arquivos...]");
+            return 2;
+        }
+
+        Grep grep(pattern, options);
+
+        if ( !grep.isValid() ) {
+            Runner::display("Expressão regular inválida: " + pattern, 'e');
+            return 2;
+        }
+
+        // As linhas são gravadas diretamente na saída, depois das mensagens pendentes
+        Runner::flush();
+
+        int out = Runner::outputFd;
+        std::atomic<bool> stopped { false };
+        std::atomic<int> error { 0 };
+
+        // A escrita pode ser feita pelas threads da busca; o errno delas é guardado em `error`
+        auto write = [&](std::string & text) {
+            if ( !stopped and Runner::writeAll(out, text.data(), text.size()) != EXIT_SUCCESS ) {
+                error = errno;
+                stopped = true;
+            }
+
+            text.clear();
+            return !stopped;
+        };
+
+        // Sem arquivos, a busca é feita na entrada (e.g. no meio de um pipeline)
+        if ( files.empty() ) {
+            Grep::Progress progress;
+            std::string text;
+
+            if ( grep.searchDescriptor(Runner::inputFd, "", progress, write) != EXIT_SUCCESS ) {
+                Runner::display("Erro ao realizar a leitura da entrada.", 'e');
+                return 2;
+            }
+
+            if ( options.list and progress.selected > 0 ) text = "(entrada padrão)\n";
+            else if ( options.count and !options.list ) text = std::to_string(progress.selected) + "\n";
+
+            if ( !text.empty() ) write(text);
+
+            if ( stopped and error != EPIPE ) Runner::display("Erro ao escrever os resultados da busca.", 'e');
+
+            return progress.selected > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        // As threads buscam os arquivos na ordem dos argumentos, que também é a ordem da
+        // saída: o arquivo da vez (`head`) grava as suas linhas diretamente, enquanto os
+        // seguintes as acumulam até a sua vez chegar. Ao acumular GREP_BUFFER_LIMIT bytes,
+        // a thread aguarda a vez do seu arquivo, limitando a memória da busca.
+        struct Result {
+            std::string text;
+            Grep::Progress progress;
+            int status = EXIT_SUCCESS;
+            bool done = false;
+        };
+
+        std::vector<Result> results(files.size());
+        std::mutex mutex;
+        std::condition_variable changed;
+        size_t head = files.size();
+        std::atomic<size_t> next { 0 };
+        bool prefixed = files.size() > 1;
+
+        ThreadPool pool(std::min(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads, files.size()));
+
+        auto search = [&](const size_t & i) {
+            Result & result = results[i];
+            Grep local = grep;
+            std::string path = files[i];
+            int status = EXIT_SUCCESS;
+
+            if ( path[0] == '~' and ( path.size() == 1 or path[1] == '/' ) ) getPath(path);
+
+            int fd = stopped ? -1 : open(path.c_str(), O_RDONLY | O_CLOEXEC);
             struct stat st;
 
-            for ( auto &item: itens ) {
+            if ( stopped ) status = EXIT_SUCCESS;
+            else if ( fd < 0 ) status = OPEN_FAILURE;
+            else if ( fstat(fd, &st) == 0 and S_ISDIR(st.st_mode) ) status = FILE_FAILURE;
+            else {
+                status = local.searchDescriptor(fd, prefixed ? files[i] + ":" : "", result.progress, [&](std::string & text) {
+                    std::unique_lock<std::mutex> lock(mutex);
+
+                    if ( head != i and result.text.size() >= GREP_BUFFER_LIMIT )
+                        changed.wait(lock, [&] { return head == i or stopped or result.text.size() < GREP_BUFFER_LIMIT; });
+
+                    if ( head == i ) {
+                        lock.unlock();
+                        return write(text);
+                    }
+
+                    result.text += text;
+                    text.clear();
+                    return !stopped;
+                });
+            }
+
+            if ( fd >= 0 ) close(fd);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            result.status = status;
+            result.done = true;
+            changed.notify_all();
+        };
+
+        for ( size_t t = 0; t < pool.size(); t++ )
+            pool.submit([&] {
+                for ( size_t i; ( i = next++ ) < files.size(); ) search(i);
+            });
+
+        bool selected = false, failed = false;
+
+        for ( size_t i = 0; i < files.size(); i++ ) {
+            Result & result = results[i];
+            std::string text;
+            std::unique_lock<std::mutex> lock(mutex);
+
+            // Grava o que foi acumulado e passa a vez para o arquivo
+            while ( !result.text.empty() ) {
+                text.swap(result.text);
+                changed.notify_all();
+                lock.unlock();
+                write(text);
+                lock.lock();
+            }
+
+            head = i;
+            changed.notify_all();
+            changed.wait(lock, [&] { return result.done; });
+            lock.unlock();
+
+            if ( result.status == OPEN_FAILURE ) Runner::display("Arquivo não encontrado: " + files[i] + "\n", 'e');
+            else if ( result.status == FILE_FAILURE ) Runner::display(files[i] + " é um diretório.\n", 'e');
+            else if ( result.status != EXIT_SUCCESS ) Runner::display("Erro ao realizar a leitura do arquivo: " + files[i] + "\n", 'e');
+
+            failed |= result.status != EXIT_SUCCESS;
+            selected |= result.progress.selected > 0;
+
+            if ( options.list and result.progress.selected > 0 ) text = files[i] + "\n";
+            else if ( options.count and !options.list and result.status == EXIT_SUCCESS )
+                text = ( prefixed ? files[i] + ":" : "" ) + std::to_string(result.progress.selected) + "\n";
+
+            if ( !text.empty() ) write(text);
+        }
+
+        pool.wait();
+
+        // O leitor do pipeline pode encerrar antes do fim da busca (e.g. "grep x arquivo | head")
+        if ( stopped and error != EPIPE ) Runner::display("Erro ao escrever os resultados da busca.", 'e');
+
+        return failed ? 2 : selected ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    /**
+     * Conta as linhas, as palavras e os bytes de um descritor (comando wc).
+     * 
+     * @param[in] fd O descritor
+     * @param[in] bytesOnly Apenas os bytes: arquivos regulares respondem com o fstat, sem leitura
+     * @param[in] words Conta as palavras; sem elas, apenas os '\n' são contados
+     * @param[out] counts As linhas e as palavras
+     * @param[out] bytes Os bytes
+     * @return status da operação
+    */
+    static int countDescriptor(const int & fd, const bool & bytesOnly, const bool & words, Simd::TextCounts & counts, uint64_t & bytes) {
+        struct stat st;
+
+        bytes = 0;
+
+        if ( fstat(fd, &st) < 0 ) return READ_FAILURE;
+        if ( S_ISDIR(st.st_mode) ) return FILE_FAILURE;
+
+        if ( bytesOnly and S_ISREG(st.st_mode) ) {
+            bytes = st.st_size;
+            return EXIT_SUCCESS;
+        }
+
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        // Um bloco que cabe no cache L2: os dados são contados enquanto ainda estão nele
+        std::vector<char> buffer(2 * STREAM_BUFFER_SIZE);
+        ssize_t n;
+
+        while ( ( n = read(fd, buffer.data(), buffer.size()) ) != 0 ) {
+            if ( n < 0 ) {
+                if ( errno == EINTR ) continue;
+                return READ_FAILURE;
+            }
+
+            bytes += n;
+
+            if ( words ) Simd::countText(buffer.data(), n, counts);
+            else if ( !bytesOnly ) counts.lines += Simd::countByte(buffer.data(), n, '\n');
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para contar as linhas, as palavras e os bytes de arquivos
+    int wcCommand(std::vector<std::string> & args) {
+        std::vector<std::string> files;
+        bool lines = false, words = false, bytes = false;
+        size_t threads = 0;
+
+        for ( size_t i = 1; i < args.size(); i++ ) {
+            const std::string & arg = args[i];
+
+            if ( arg.size() < 2 or arg[0] != '-' ) {
+                files.push_back(arg);
+                continue;
+            }
+
+            if ( arg == "-j" and i + 1 < args.size() and args[i + 1].size() < 10 and
+                 args[i + 1].find_first_not_of("0123456789") == std::string::npos ) {
+                threads = std::stoul(args[++i]);
+                continue;
+            }
+
+            // Opções combinadas, e.g. -lw
+            for ( size_t k = 1; k < arg.size(); k++ ) {
+                if ( arg[k] == 'l' ) lines = true;
+                else if ( arg[k] == 'w' ) words = true;
+                else if ( arg[k] == 'c' ) bytes = true;
+                else {
+                    Runner::display("Parâmetro desconhecido: " + arg + "\n", 'e');
+                    Runner::display("USO: wc [-l] [-w] [-c] [-j threads] [arquivos...]");
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+
+        if ( !lines and !words and !bytes ) lines = words = bytes = true;
+
+        struct Result {
+            Simd::TextCounts counts;
+            uint64_t bytes = 0;
+            int status = EXIT_SUCCESS;
+        };
+
+        std::vector<Result> results(std::max<size_t>(1, files.size()));
+        bool bytesOnly = bytes and !lines and !words;
+
+        // Sem arquivos, conta a entrada (e.g. no meio de um pipeline)
+        if ( files.empty() ) results[0].status = countDescriptor(Runner::inputFd, bytesOnly, words, results[0].counts, results[0].bytes);
+        else {
+            // As threads contam os arquivos na ordem dos argumentos
+            std::atomic<size_t> next { 0 };
+            ThreadPool pool(std::min(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads, files.size()));
+
+            for ( size_t t = 0; t < pool.size(); t++ ) {
+                pool.submit([&] {
+                    for ( size_t i; ( i = next++ ) < files.size(); ) {
+                        std::string path = files[i];
+
+                        if ( path[0] == '~' and ( path.size() == 1 or path[1] == '/' ) ) getPath(path);
+
+                        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+                        if ( fd < 0 ) {
+                            results[i].status = OPEN_FAILURE;
+                            continue;
+                        }
+
+                        results[i].status = countDescriptor(fd, bytesOnly, words, results[i].counts, results[i].bytes);
+                        close(fd);
+                    }
+                });
+            }
+
+            pool.wait();
+        }
+
+        Result total;
+        bool failed = false;
+
+        for ( auto & result: results ) {
+            total.counts.lines += result.counts.lines;
+            total.counts.words += result.counts.words;
+            total.bytes += result.bytes;
+        }
+
+        // As colunas têm a largura do maior valor, exceto quando há um único valor
+        size_t columns = lines + words + bytes;
+        size_t width = 1;
+
+        if ( columns > 1 or files.size() > 1 )
+            width = std::to_string(std::max({ total.counts.lines, total.counts.words, total.bytes })).size();
+
+        auto format = [&](const Result & result, const std::string & name) {
+            std::string text;
+
+            for ( auto value: { std::make_pair(lines, result.counts.lines), std::make_pair(words, result.counts.words),
+                                std::make_pair(bytes, result.bytes) } ) {
+                if ( !value.first ) continue;
+
+                std::string number = std::to_string(value.second);
+
+                if ( !text.empty() ) text += ' ';
+                text += std::string(width - std::min(width, number.size()), ' ') + number;
+            }
+
+            return text + ( name.empty() ? "" : " " + name ) + "\n";
+        };
+
+        for ( size_t i = 0; i < results.size(); i++ ) {
+            std::string name = files.empty() ? "" : files[i];
+
+            if ( results[i].status == EXIT_SUCCESS ) Runner::display(format(results[i], name));
+            else if ( results[i].status == OPEN_FAILURE ) Runner::display("Arquivo não encontrado: " + name + "\n", 'e');
+            else if ( results[i].status == FILE_FAILURE ) Runner::display(name + " é um diretório.\n", 'e');
+            else Runner::display("Erro ao realizar a leitura " + ( name.empty() ? std::string("da entrada") : "do arquivo: " + name ) + "\n", 'e');
+
+            failed |= results[i].status != EXIT_SUCCESS;
+        }
+
+        if ( files.size() > 1 ) Runner::display(format(total, "total"));
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    /**
+     * Copia as primeiras linhas de um descritor (comando head). A leitura
+     * termina no bloco que contém a última linha pedida; em um arquivo, a
+     * posição volta para logo após essa linha, como no head do GNU, e o
+     * restante fica para o próximo leitor (e.g. o shell lendo um script).
+     * 
+     * @param[in] fd O descritor
+     * @param[in] lines A quantidade de linhas
+     * @param[in] out Descritor de saída
+     * @return status da operação
+    */
+    static int headDescriptor(const int & fd, uint64_t lines, const int & out) {
+        char buffer[STREAM_BUFFER_SIZE];
+        ssize_t n;
+
+        while ( lines > 0 and ( n = read(fd, buffer, sizeof buffer) ) != 0 ) {
+            if ( n < 0 ) {
+                if ( errno == EINTR ) continue;
+                return READ_FAILURE;
+            }
+
+            size_t size = n;
+            uint64_t found = Simd::countByte(buffer, size, '\n');
+
+            if ( found >= lines ) {
+                const char *p = buffer;
+                for ( ; lines > 0; lines-- ) p = (const char *) memchr(p, '\n', buffer + size - p) + 1;
+                size = p - buffer;
+
+                if ( size < (size_t) n ) lseek(fd, -(off_t) ( n - size ), SEEK_CUR);
+            }
+            else lines -= found;
+
+            if ( Runner::writeAll(out, buffer, size) != EXIT_SUCCESS ) return WRITE_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Procura, de trás para frente, o início das últimas linhas de um bloco.
+     * 
+     * Os '\n' do bloco são contados com Simd::countByte; apenas o bloco que
+     * contém o início procurado é percorrido com memrchr.
+     * 
+     * @param[in] data O bloco
+     * @param[in] size O tamanho do bloco
+     * @param[in, out] lines Os '\n' que ainda precisam ser pulados, descontados os do bloco
+     * @param[out] start O início encontrado, relativo ao bloco
+     * @return true caso o início esteja no bloco.
+    */
+    static bool findLastLines(const char *data, const size_t & size, uint64_t & lines, size_t & start) {
+        uint64_t found = Simd::countByte(data, size, '\n');
+
+        if ( found < lines ) {
+            lines -= found;
+            return false;
+        }
+
+        const char *p = data + size;
+        for ( ; lines > 0; lines-- ) p = (const char *) memrchr(data, '\n', p - data);
+
+        start = p - data + 1;
+        return true;
+    }
+
+    /**
+     * Copia as últimas linhas de um descritor (comando tail).
+     * 
+     * Em arquivos regulares, o fim do arquivo é lido de trás para frente em
+     * blocos de TAIL_BLOCK_SIZE até o início das linhas, que são enviadas
+     * com Runner::streamDescriptor: o custo depende do tamanho da saída, e
+     * não do arquivo. Pipes são lidos até o fim, guardando apenas as
+     * últimas linhas.
+     * 
+     * @param[in] fd O descritor
+     * @param[in] lines A quantidade de linhas
+     * @param[in] out Descritor de saída
+     * @param[out] end A posição em que a leitura terminou (para o tail -f)
+     * @return status da operação
+    */
+    static int tailDescriptor(const int & fd, const uint64_t & lines, const int & out, off_t & end) {
+        struct stat st;
+
+        end = 0;
+
+        if ( fstat(fd, &st) < 0 ) return READ_FAILURE;
+        if ( S_ISDIR(st.st_mode) ) return FILE_FAILURE;
+
+        if ( S_ISREG(st.st_mode) ) {
+            std::vector<char> buffer(TAIL_BLOCK_SIZE);
+            off_t position = st.st_size, start = 0;
+            uint64_t remaining = lines;
+            bool last = true;
+
+            while ( position > 0 and lines > 0 ) {
+                size_t size = std::min<off_t>(position, TAIL_BLOCK_SIZE), found;
+                position -= size;
+
+                if ( pread(fd, buffer.data(), size, position) != (ssize_t) size ) return READ_FAILURE;
+
+                // O '\n' do fim do arquivo não inicia uma nova linha
+                if ( last and buffer[size - 1] == '\n' ) size--;
+                last = false;
+
+                if ( findLastLines(buffer.data(), size, remaining, found) ) {
+                    start = position + found;
+                    break;
+                }
+            }
+
+            if ( lines == 0 ) start = st.st_size;
+            if ( lseek(fd, start, SEEK_SET) < 0 ) return READ_FAILURE;
+
+            int status = Runner::streamDescriptor(fd, out);
+            end = lseek(fd, 0, SEEK_CUR);
+
+            return status;
+        }
+
+        // Sem como voltar, a entrada é lida até o fim e apenas as últimas linhas ficam no buffer
+        std::string content;
+        char buffer[STREAM_BUFFER_SIZE];
+        size_t start = 0, limit = 4 * STREAM_BUFFER_SIZE;
+        ssize_t n;
+
+        while ( ( n = read(fd, buffer, sizeof buffer) ) != 0 ) {
+            if ( n < 0 ) {
+                if ( errno == EINTR ) continue;
+                return READ_FAILURE;
+            }
+
+            content.append(buffer, n);
+
+            // O limite dobra a cada corte, para que o buffer não seja percorrido a cada leitura
+            if ( content.size() >= limit ) {
+                uint64_t remaining = lines;
+                size_t size = content.size() - ( content.back() == '\n' );
+
+                if ( lines == 0 ) content.clear();
+                else if ( findLastLines(content.data(), size, remaining, start) ) content.erase(0, start);
+
+                limit = std::max<size_t>(4 * STREAM_BUFFER_SIZE, 2 * content.size());
+            }
+        }
+
+        uint64_t remaining = lines;
+        size_t size = content.size() - ( !content.empty() and content.back() == '\n' );
+
+        if ( lines == 0 ) start = content.size();
+        else if ( !findLastLines(content.data(), size, remaining, start) ) start = 0;
+
+        return Runner::writeAll(out, content.data() + start, content.size() - start) == EXIT_SUCCESS ? EXIT_SUCCESS : WRITE_FAILURE;
+    }
+
+    /**
+     * Copia os bytes de um arquivo a partir de uma posição até o fim.
+     * 
+     * @return status da operação
+    */
+    static int copyFrom(const int & fd, off_t & offset, const int & out) {
+        char buffer[STREAM_BUFFER_SIZE];
+        ssize_t n;
+
+        while ( ( n = pread(fd, buffer, sizeof buffer, offset) ) != 0 ) {
+            if ( n < 0 ) {
+                if ( errno == EINTR ) continue;
+                return READ_FAILURE;
+            }
+
+            if ( Runner::writeAll(out, buffer, n) != EXIT_SUCCESS ) return WRITE_FAILURE;
+            offset += n;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Acompanha o crescimento de um arquivo (tail -f) até um Ctrl-C.
+     * 
+     * O arquivo é observado com inotify, sem consultas periódicas. O
+     * diretório dele também é observado: quando o arquivo é renomeado ou
+     * removido e outro é criado com o mesmo nome (rotação de logs), o
+     * restante do antigo é exibido e o novo passa a ser acompanhado desde o
+     * início. Um arquivo truncado volta a ser lido do início. Enquanto o
+     * arquivo é acompanhado, o SIGINT apenas escreve em um pipe observado
+     * junto com o inotify, de forma que o Ctrl-C encerra o acompanhamento, e
+     * não o shell.
+     * 
+     * @param[in] path O caminho do arquivo
+     * @param[in] fd O descritor do arquivo (fechado ao final)
+     * @param[in] offset A posição até onde o arquivo já foi exibido
+     * @param[in] out Descritor de saída
+     * @return status da operação
+    */
+    static int followFile(const std::string & path, int fd, off_t offset, const int & out) {
+        int watcher = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        size_t slash = path.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+        std::string name = Runner::getBaseName(path);
+        const uint32_t fileEvents = IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF;
+        static int interrupted = -1;
+        int wakeup[2];
+
+        if ( watcher < 0 or pipe2(wakeup, O_CLOEXEC | O_NONBLOCK) < 0 ) {
+            if ( watcher >= 0 ) close(watcher);
+            close(fd);
+            return OPEN_FAILURE;
+        }
+
+        int file = inotify_add_watch(watcher, path.c_str(), fileEvents);
+        int parent = inotify_add_watch(watcher, directory.c_str(), IN_CREATE | IN_MOVED_TO);
+
+        // O sinal pode ser recebido por qualquer thread do shell; o pipe acorda o poll de qualquer forma
+        struct sigaction action = {}, previous;
+        interrupted = wakeup[1];
+        action.sa_handler = [](int) {
+            int saved = errno;
+            char c = 0;
+
+            if ( write(interrupted, &c, 1) < 0 ) {}
+            errno = saved;
+        };
+        sigaction(SIGINT, &action, &previous);
+
+        struct pollfd fds[2] = { { watcher, POLLIN, 0 }, { wakeup[0], POLLIN, 0 } };
+        alignas(struct inotify_event) char events[4096];
+        int status = EXIT_SUCCESS;
+        struct stat st;
+
+        while ( status == EXIT_SUCCESS ) {
+            if ( poll(fds, 2, -1) < 0 ) {
+                if ( errno == EINTR ) continue;
+                break;
+            }
+
+            if ( fds[1].revents & POLLIN ) break;
+
+            bool replaced = false;
+            ssize_t n;
+
+            while ( ( n = read(watcher, events, sizeof events) ) > 0 ) {
+                for ( char *p = events; p < events + n; p += sizeof(struct inotify_event) + ( (struct inotify_event *) p )->len ) {
+                    struct inotify_event *event = (struct inotify_event *) p;
+
+                    if ( event->wd == file and event->mask & ( IN_DELETE_SELF | IN_MOVE_SELF ) ) replaced = true;
+                    if ( event->wd == parent and event->len > 0 and name == event->name ) replaced = true;
+                }
+            }
+
+            // Exibe o que foi acrescentado, inclusive o restante de um arquivo substituído
+            if ( fstat(fd, &st) == 0 and st.st_size < offset ) {
+                Runner::display(path + ": arquivo truncado\n", 'e');
+                Runner::flush();
+                offset = 0;
+            }
+
+            status = copyFrom(fd, offset, out);
+
+            if ( !replaced or status != EXIT_SUCCESS ) continue;
+
+            // O novo arquivo pode ainda não existir (removido e não recriado)
+            int next = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat nextSt;
+
+            if ( next < 0 or fstat(next, &nextSt) < 0 or ( nextSt.st_dev == st.st_dev and nextSt.st_ino == st.st_ino ) ) {
+                if ( next >= 0 ) close(next);
+                continue;
+            }
+
+            Runner::display(path + ": arquivo substituído, acompanhando o novo arquivo\n", 'e');
+            Runner::flush();
+
+            inotify_rm_watch(watcher, file);
+            close(fd);
+
+            fd = next;
+            offset = 0;
+            file = inotify_add_watch(watcher, path.c_str(), fileEvents);
+            status = copyFrom(fd, offset, out);
+        }
+
+        sigaction(SIGINT, &previous, nullptr);
+        close(wakeup[0]);
+        close(wakeup[1]);
+        close(watcher);
+        close(fd);
+
+        return status;
+    }
+
+    /**
+     * Lê as opções comuns do head e do tail.
+     * 
+     * @param[in] args Os argumentos do comando
+     * @param[out] lines A quantidade de linhas (-n N, padrão 10)
+     * @param[out] follow -f (apenas no tail)
+     * @param[out] files Os arquivos
+     * @return false caso algum parâmetro seja inválido.
+    */
+    static bool parseLineArgs(std::vector<std::string> & args, uint64_t & lines, bool * follow, std::vector<std::string> & files) {
+        lines = 10;
+
+        for ( size_t i = 1; i < args.size(); i++ ) {
+            const std::string & arg = args[i];
+
+            if ( arg.size() < 2 or arg[0] != '-' ) files.push_back(arg);
+            else if ( arg == "-f" and follow != nullptr ) *follow = true;
+            else if ( arg == "-n" and i + 1 < args.size() and !args[i + 1].empty() and args[i + 1].size() < 19 and
+                      args[i + 1].find_first_not_of("0123456789") == std::string::npos )
+                lines = std::stoull(args[++i]);
+            else {
+                Runner::display("Parâmetro inválido: " + arg + "\n", 'e');
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Comando para exibir as primeiras linhas de arquivos
+    int headCommand(std::vector<std::string> & args) {
+        std::vector<std::string> files;
+        uint64_t lines;
+
+        if ( !parseLineArgs(args, lines, nullptr, files) ) {
+            Runner::display("USO: head [-n linhas] [arquivos...]");
+            return EXIT_FAILURE;
+        }
+
+        // Sem arquivos, lê a entrada (e.g. no meio de um pipeline)
+        if ( files.empty() ) files.push_back("");
+
+        bool failed = false;
+
+        for ( size_t i = 0; i < files.size(); i++ ) {
+            std::string path = files[i];
+            int fd = Runner::inputFd, status;
+
+            if ( !path.empty() ) {
+                if ( path[0] == '~' and ( path.size() == 1 or path[1] == '/' ) ) getPath(path);
+                fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            }
+
+            if ( fd < 0 ) {
+                Runner::display("Arquivo não encontrado: " + files[i] + "\n", 'e');
+                failed = true;
+                continue;
+            }
+
+            if ( files.size() > 1 ) Runner::display(std::string(i > 0 ? "\n" : "") + "==> " + files[i] + " <==\n");
+
+            // As linhas são gravadas diretamente na saída, depois das mensagens pendentes
+            Runner::flush();
+
+            status = headDescriptor(fd, lines, Runner::outputFd);
+            if ( !path.empty() ) close(fd);
+
+            // O leitor do pipeline pode encerrar antes (e.g. "head arquivo | head -n 1")
+            if ( status == WRITE_FAILURE ) {
+                if ( errno != EPIPE ) Runner::display("Erro ao escrever as linhas.", 'e');
+                return EXIT_FAILURE;
+            }
+
+            if ( status != EXIT_SUCCESS ) {
+                Runner::display("Erro ao realizar a leitura do arquivo: " + files[i] + "\n", 'e');
+                failed = true;
+            }
+        }
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    // Comando para exibir as últimas linhas de arquivos
+    int tailCommand(std::vector<std::string> & args) {
+        std::vector<std::string> files;
+        uint64_t lines;
+        bool follow = false;
+
+        if ( !parseLineArgs(args, lines, &follow, files) ) {
+            Runner::display("USO: tail [-n linhas] [-f] [arquivos...]");
+            return EXIT_FAILURE;
+        }
+
+        if ( follow and files.size() != 1 ) {
+            Runner::display("O tail -f acompanha um único arquivo.", 'e');
+            return EXIT_FAILURE;
+        }
+
+        // Sem arquivos, lê a entrada (e.g. no meio de um pipeline)
+        if ( files.empty() ) files.push_back("");
+
+        bool failed = false;
+
+        for ( size_t i = 0; i < files.size(); i++ ) {
+            std::string path = files[i];
+            int fd = Runner::inputFd, status;
+            off_t end;
+
+            if ( !path.empty() ) {
+                if ( path[0] == '~' and ( path.size() == 1 or path[1] == '/' ) ) getPath(path);
+                fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            }
+
+            if ( fd < 0 ) {
+                Runner::display("Arquivo não encontrado: " + files[i] + "\n", 'e');
+                failed = true;
+                continue;
+            }
+
+            if ( files.size() > 1 ) Runner::display(std::string(i > 0 ? "\n" : "") + "==> " + files[i] + " <==\n");
+
+            // As linhas são gravadas diretamente na saída, depois das mensagens pendentes
+            Runner::flush();
+
+            status = tailDescriptor(fd, lines, Runner::outputFd, end);
+
+            if ( follow and status == EXIT_SUCCESS ) status = followFile(path, fd, end, Runner::outputFd);
+            else if ( !path.empty() ) close(fd);
+
+            if ( status == WRITE_FAILURE ) {
+                if ( errno != EPIPE ) Runner::display("Erro ao escrever as linhas.", 'e');
+                return EXIT_FAILURE;
+            }
+
+            if ( status == FILE_FAILURE ) Runner::display(files[i] + " é um diretório.\n", 'e');
+            else if ( status != EXIT_SUCCESS ) Runner::display("Erro ao realizar a leitura do arquivo: " + files[i] + "\n", 'e');
+
+            failed |= status != EXIT_SUCCESS;
+        }
+
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    // Comando para consultar e configurar o buffer da saída
+    int outputCommand(std::vector<std::string> & args) {
+        OutputBuffer & output = OutputBuffer::instance();
+
+        if ( args.size() == 1 ) {
+            Runner::display(std::string("Saída ") + ( output.isBuffered() ? "com" : "sem" ) + " buffer");
+            Runner::display(std::string(", cores ") + ( output.isTerminal() ? "ativadas" : "desativadas" ) + ".");
+        }
+        else if ( args.size() == 2 and args[1] == "buffered" ) output.setBuffered(true);
+        else if ( args.size() == 2 and args[1] == "unbuffered" ) output.setBuffered(false);
+        else {
+            Runner::display("Parâmetros inválidos.\n", 'e');
+            Runner::display("USO: output | output buffered | output unbuffered");
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para exibir o histórico de comandos
+    int historyCommand(std::vector<std::string> & args) {
+        if ( history == nullptr or !history->isOpen() ) {
+            Runner::display("O histórico só está disponível no modo interativo.", 'e');
+            return EXIT_FAILURE;
+        }
+
+        if ( args.size() > 2 or ( args.size() == 2 and
+             ( args[1].empty() or args[1].find_first_not_of("0123456789") != std::string::npos ) ) ) {
+            Runner::display("Parâmetros inválidos.\n", 'e');
+            Runner::display("USO: history [quantidade]");
+            return EXIT_FAILURE;
+        }
+
+        size_t size = history->size();
+        size_t count = args.size() == 2 ? std::min<size_t>(std::stoull(args[1].substr(0, 18)), size) : size;
+        std::string output, line;
+
+        for ( size_t i = size - count + 1; i <= size; i++ ) {
+            history->get(i, line);
+
+            std::string number = std::to_string(i);
+            output += std::string(number.size() < 5 ? 5 - number.size() : 0, ' ') + number + "  " + line + '\n';
+
+            if ( output.size() >= STREAM_BUFFER_SIZE ) {
+                Runner::display(output);
+                output.clear();
+            }
+        }
+
+        if ( !output.empty() ) output.pop_back();
+        Runner::display(output);
+
+        return EXIT_SUCCESS;
+    }
+
+    // Comando para consultar e limpar o cache de executáveis do PATH
+    int hashCommand(std::vector<std::string> & args) {
+        if ( args.size() == 2 and args[1] == "-r" ) {
+            PathCache::instance().clear();
+            return EXIT_SUCCESS;
+        }
+
+        if ( args.size() != 1 ) {
+            Runner::display("Parâmetros inválidos.\n", 'e');
+            Runner::display("USO: hash | hash -r");
+            return EXIT_FAILURE;
+        }
+
+        std::stringstream ss;
+
+        ss << "execuções  comando\n";
+
+        for ( auto & hit: PathCache::instance().getHits() )
+            ss << std::right << std::setw(10) << hit.second.second << "  " << hit.second.first << '\n';
+
+        Runner::display(ss.str());
+        return EXIT_SUCCESS;
+    }
+
+    /**
+     * Executa um programa externo. Programas sem '/' no nome são
+     * procurados no PATH através do PathCache.
+     * 
+     * @param[in] args O nome do programa e os seus argumentos
+     * @return O status de saída do programa.
+    */
+    int externalCommand(std::vector<std::string> & args) {
+        PathCache & cache = PathCache::instance();
+        std::string path = args[0];
+        bool hashed = path.find('/') == std::string::npos;
+        int exitStatus;
+
+        if ( hashed and !cache.find(args[0], path) ) return invalidCommand(args);
+
+        int status = Runner::runProgram(path, args, exitStatus);
+
+        // O executável foi removido desde que foi encontrado, procura novamente no PATH
+        if ( hashed and status == OPEN_FAILURE and errno == ENOENT ) {
+            cache.forget(args[0]);
+
+            if ( !cache.find(args[0], path) ) return invalidCommand(args);
+
+            status = Runner::runProgram(path, args, exitStatus);
+        }
+
+        if ( status == OPEN_FAILURE ) {
+            Runner::display("Não foi possível executar " + path + ": " + strerror(errno), 'e');
+        }
+
+        return exitStatus;
+    }
+
+    /// @brief Um estágio de um pipeline: um comando interno ou um programa externo.
+    struct Stage {
+        std::vector<std::string> args;
+        Handler handler = nullptr;  /// @brief O comando interno, ou nullptr para um programa externo
+        std::string path;           /// @brief O caminho do programa externo
+        int in = STDIN_FILENO;
+        int out = STDOUT_FILENO;
+        pid_t pid = -1;
+        int status = 0;
+    };
+
+    /**
+     * Fecha as pontas dos pipes utilizadas por um estágio.
+     * 
+     * @param[in, out] stage O estágio
+    */
+    void closeStage(Stage & stage) {
+        if ( stage.in != STDIN_FILENO ) close(stage.in);
+        if ( stage.out != STDOUT_FILENO ) close(stage.out);
+        stage.in = STDIN_FILENO;
+        stage.out = STDOUT_FILENO;
+    }
+
+    /**
+     * Executa um comando interno como estágio de um pipeline, com a entrada
+     * e a saída da thread atual redirecionadas para os pipes do estágio.
+     * As pontas são fechadas ao final para que os estágios vizinhos
+     * recebam o fim dos dados.
+     * 
+     * @param[in, out] stage O estágio
+    */
+    void runStage(Stage & stage) {
+        Runner::inputFd = stage.in;
+        Runner::outputFd = stage.out;
+
+        stage.status = (this->*stage.handler)(stage.args);
+
+        Runner::inputFd = STDIN_FILENO;
+        Runner::outputFd = STDOUT_FILENO;
+        closeStage(stage);
+    }
+
+    /**
+     * Indica se um comando interno altera o estado do shell (diretório
+     * atual, saída, prompt, histórico, PATH em cache) e, por isso, não pode
+     * executar em paralelo com outros estágios de um pipeline.
+     * 
+     * @param[in] name O nome do comando
+     * @return true caso o comando precise executar na thread do shell.
+    */
+    static bool changesShellState(const std::string & name) {
+        static const std::unordered_set<std::string> names = {
+            "exit", "quit", "cd", "clear", "hash", "output", "prompt", "history"
+        };
+
+        return names.count(name) > 0;
+    }
+
+    /**
+     * Executa os estágios de um pipeline conectados por pipes.
+     * 
+     * Os programas externos são criados com posix_spawn, e os comandos
+     * internos executam em threads do próprio shell, sem fork. O último
+     * estágio, quando interno, executa na thread atual. Os comandos que
+     * alteram o estado do shell (changesShellState) executam sempre na
+     * thread atual, em ordem, depois que os demais estágios já foram
+     * iniciados; nesse caso o último estágio também ganha uma thread. Os
+     * dados entre arquivos e pipes são transferidos pelo kernel
+     * (sendfile/splice).
+     * 
+     * @param[in, out] stages Os estágios, na ordem do pipeline
+     * @return O status de saída do último estágio.
+    */
+    int pipelineCommand(std::vector<Stage> & stages) {
+        for ( auto & stage: stages ) {
+            auto it = commands.find(stage.args[0]);
+
+            if ( it != commands.end() ) {
+                stage.handler = it->second;
+                continue;
+            }
 
-                if ( !strcmp(item->d_name, ".") or !strcmp(item->d_name, "..") )
-                    continue;
+            stage.path = stage.args[0];
 
-                
-                std::string p = path + "/" + item->d_name;
+            if ( stage.path.find('/') == std::string::npos and !PathCache::instance().find(stage.args[0], stage.path) )
+                return invalidCommand(stage.args);
+        }
 
-                if ( lstat(p.c_str(), &st) < 0 ) return READ_FAILURE;
+        for ( size_t i = 0; i + 1 < stages.size(); i++ ) {
+            int fds[2];
 
-                if ( S_ISDIR(st.st_mode) and removeDirectory(p) != EXIT_SUCCESS )
-                    return EXIT_FAILURE;
+            if ( pipe2(fds, O_CLOEXEC) < 0 ) {
+                for ( auto & stage: stages ) closeStage(stage);
+                Runner::display("Não foi possível criar o pipeline: " + std::string(strerror(errno)), 'e');
+                return EXIT_FAILURE;
+            }
+
+            // Pipes maiores reduzem a quantidade de trocas de contexto entre os estágios
+            fcntl(fds[1], F_SETPIPE_SZ, PIPELINE_PIPE_SIZE);
+
+            stages[i].out = fds[1];
+            stages[i + 1].in = fds[0];
+        }
+
+        // Garante que as mensagens pendentes sejam exibidas antes da saída dos estágios
+        Runner::flush();
+
+        Runner::InterruptState saved;
+        std::vector<std::thread> threads;
+        std::vector<Stage *> local;         // Estágios executados na thread atual
+        bool stateful = false;
+
+        for ( auto & stage: stages ) stateful |= stage.handler != nullptr and changesShellState(stage.args[0]);
 
+        Runner::ignoreInterrupts(saved);
 
-                int status = removeFile(p);
-            
-                if ( status == EXIT_SUCCESS ) continue;
-                else return status;
+        for ( size_t i = 0; i < stages.size(); i++ ) {
+            Stage & stage = stages[i];
+
+            if ( stage.handler != nullptr ) {
+                if ( stateful ? changesShellState(stage.args[0]) : i + 1 == stages.size() ) local.push_back(&stage);
+                else threads.emplace_back(&Shell::runStage, this, std::ref(stage));
+                continue;
+            }
+
+            if ( Runner::spawnProgram(stage.path, stage.args, stage.in, stage.out, stage.pid) != EXIT_SUCCESS ) {
+                stage.status = errno == ENOENT ? 127 : 126;
+                Runner::display("Não foi possível executar " + stage.path + ": " + strerror(errno), 'e');
             }
+
+            closeStage(stage);
         }
 
+        for ( auto stage: local ) runStage(*stage);
 
-        if ( rmdir(path.c_str()) != 0 ) return EXIT_FAILURE;
-        return EXIT_SUCCESS;
-        
+        for ( auto & stage: stages )
+            if ( stage.pid > 0 ) stage.status = Runner::waitProgram(stage.pid);
+
+        for ( auto & thread: threads ) thread.join();
+
+        Runner::restoreInterrupts(saved);
+
+        return stages.back().status;
     }
 
     /**
-     * Move ou renomeia arquivos e diretórios.
+     * Executa um comando ou um pipeline já dividido em tokens, registrando
+     * a sua latência e a sua E/S nas estatísticas do comando.
      * 
-     * @param[in] source Diretório ou arquivo de origem
-     * @param[in] target Diretório ou arquivo de destino
-     * @return status da operação
+     * @param[in, out] args Os tokens
+     * @param[in, out] pipes Os índices dos tokens que iniciam cada estágio após o primeiro
+     * @param[in] text A linha de comando, para as mensagens de erro
+     * @return O status de saída do comando.
     */
-    int moveFiles( std::string & source, const std::string & target ) {
+    int execute(std::vector<std::string> & args, std::vector<size_t> & pipes, const std::string & text) {
+        std::vector<Stage> stages;
 
-        // Verifica se a origem existe
-        struct stat source_sb;
-        
-        if ( stat(source.c_str(), &source_sb) == -1 ) 
-            return FILE_FAILURE;
-    
-        // Verifica se a origem e o destino são o mesmo arquivo
-        struct stat target_sb;
-        
-        if ( stat(target.c_str(), &target_sb) != -1 && target_sb.st_ino == source_sb.st_ino ) 
-            return SAME_FILE;
+        if ( !pipes.empty() ) {
+            stages.resize(pipes.size() + 1);
 
-        // Verifica se o destino já existe
-        if ( stat(target.c_str(), &target_sb) != -1 ) {
+            pipes.insert(pipes.begin(), 0);
+            pipes.push_back(args.size());
+
+            for ( size_t i = 0; i < stages.size(); i++ ) {
+                if ( pipes[i] == pipes[i + 1] ) {
+                    Runner::display("Erro de sintaxe próximo a '|': " + text, 'e');
+                    return 2;
+                }
 
-            if ( S_ISDIR(target_sb.st_mode) ) {
+                stages[i].args.assign(args.begin() + pipes[i], args.begin() + pipes[i + 1]);
+            }
+        }
 
-                // O destino é um diretório, adiciona o nome do arquivo à pasta
-                const char *filename = strrchr(source.c_str(), '/');
+        CommandStats & stats = CommandStats::instance();
+        std::string name = stages.empty() ? args[0] : "|";
+        Runner::IoCounters before, after;
+        int status;
 
-                if ( !filename ) filename = source.c_str();
-                else filename++;
+        bool io = stats.isTrackingIo();
 
-                char targetPath[ source.size() + strlen(filename) + 2];
+        // Programas externos, pipelines e os comandos que leem a entrada padrão não podem
+        // perder as linhas do script que o shell já leu dela
+        if ( !stages.empty() or !commands.count(name) or name == "cat" or name == "grep" or
+             name == "wc" or name == "head" or name == "tail" )
+            input.release();
 
-                sprintf(targetPath, "%s/%s", target.c_str(), filename);
+        if ( io ) Runner::readIoCounters(before);
+        auto start = std::chrono::steady_clock::now();
 
-                if ( rename(source.c_str(), targetPath) == -1 ) 
-                    return EXIT_FAILURE;
+        if ( !stages.empty() ) status = pipelineCommand(stages);
+        else {
+            auto it = commands.find(args[0]);
 
-            } else if ( rename(source.c_str(), target.c_str()) == -1 )
-                return EXIT_FAILURE;
-        } else {
-            // O destino não existe, renomeia o arquivo
-            if ( rename(source.c_str(), target.c_str()) == -1 )
-                return EXIT_FAILURE;
+            if ( it != commands.end() ) status = (this->*(it->second))(args);
+            else status = externalCommand(args);
         }
 
-        return EXIT_SUCCESS;
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        if ( io ) Runner::readIoCounters(after);
+        else after = before;
+
+        // Comandos digitados errado não criam entradas nas estatísticas
+        std::string path;
+        bool found = !stages.empty() or commands.count(name) or
+                     ( name.find('/') == std::string::npos ? PathCache::instance().find(name, path) : access(name.c_str(), X_OK) == 0 );
+
+        if ( found ) stats.record(stats.get(name), elapsed, before, after);
+
+        return status;
     }
 
     /**
-     * Obtém a descrição de um comando específico.
+     * Executa um comando e exibe o tempo real, de usuário e de sistema
+     * gasto por ele, e o pico de memória residente.
      * 
-     * @return A descrição do comando.
+     * O getrusage informa apenas o maior pico desde o início do shell, e
+     * não o de um comando. O pico do shell é exibido como tal; o dos
+     * programas externos só é atribuído ao comando quando o supera, e caso
+     * contrário apenas o limite superior é conhecido.
+     * 
+     * @param[in, out] args Os tokens do comando, sem o "time"
+     * @param[in, out] pipes Os índices dos tokens que iniciam cada estágio após o primeiro
+     * @param[in] text A linha de comando, para as mensagens de erro
+     * @return O status de saída do comando.
     */
-    std::string getCommandDescription(std::string name) {
+    int timeCommand(std::vector<std::string> & args, std::vector<size_t> & pipes, const std::string & text) {
+        struct rusage selfBefore, childrenBefore, self, children;
+
+        getrusage(RUSAGE_SELF, &selfBefore);
+        getrusage(RUSAGE_CHILDREN, &childrenBefore);
+        auto start = std::chrono::steady_clock::now();
+
+        int status = execute(args, pipes, text);
+
+        double real = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        getrusage(RUSAGE_SELF, &self);
+        getrusage(RUSAGE_CHILDREN, &children);
+
+        auto seconds = [](const struct timeval & after, const struct timeval & before) {
+            return ( after.tv_sec - before.tv_sec ) + ( after.tv_usec - before.tv_usec ) / 1e6;
+        };
+
         std::stringstream ss;
 
-        auto args = cmdArgsDescription[name];
+        ss << std::fixed << std::setprecision(3);
+        ss << "\n" << padRight("real", 10) << real << " s\n";
+        ss << padRight("user", 10) << seconds(self.ru_utime, selfBefore.ru_utime) + seconds(children.ru_utime, childrenBefore.ru_utime) << " s\n";
+        ss << padRight("sys", 10) << seconds(self.ru_stime, selfBefore.ru_stime) + seconds(children.ru_stime, childrenBefore.ru_stime) << " s\n";
+        ss << padRight("max RSS", 10) << self.ru_maxrss << " KB (pico do shell desde o início)";
 
-        if ( !args.empty() ) {
-            ss << "COMANDO:\n" << name << "\n\n";
-            ss << "DESCRIÇÃO:\n" << helpDictionary[name] << "\n\n";
-            ss << "USO:\n";
+        // Os programas externos executados pelo comando acumulam trocas de contexto
+        if ( children.ru_maxrss > childrenBefore.ru_maxrss )
+            ss << "\n" << padRight("", 10) << children.ru_maxrss << " KB (programas)";
+        else if ( children.ru_nvcsw + children.ru_nivcsw != childrenBefore.ru_nvcsw + childrenBefore.ru_nivcsw )
+            ss << "\n" << padRight("", 10) << "até " << children.ru_maxrss << " KB (programas)";
 
-            for ( auto & arg: args ) {
-                ss << "$ " << std::left << std::setw(32);
-                ss << arg.name << arg.description << '\n';
-            }
-        } else ss << "Comando não encontrado: " << name;
+        Runner::display(ss.str());
 
-        return ss.str();
+        return status;
     }
-    
-}
-/**
- * Implementação do Shell
- * 
- * É utilizada para representar um shell simples.
-*/
-class Shell {
 
-    private:
+    // Comando para registrar os spans das operações de E/S em um trace do Chrome
+    int traceCommand(std::vector<std::string> & args) {
+        Tracer & tracer = Tracer::instance();
 
-    /**
-     * Obtém o(s) argumento(s) de um comando a partir de um texto.
-     * 
-     * @param[in] command O nome do comando.
-     * @param[in] text O texto com o comando e o(s) seu(s) parâmetro(s).
-     * @return Os argumentos. 
-    */
-    std::string getArgs(const std::string & command, std::string & text) {
-        std::string arg;
+        if ( args.size() == 1 ) {
+            Runner::display(std::string("Trace ") + ( Tracer::isEnabled() ? "ativo." : "inativo." ));
+            return EXIT_SUCCESS;
+        }
+
+        if ( args.size() == 2 and args[1] == "start" ) {
+            tracer.start();
+            Runner::display("Trace iniciado.");
+            return EXIT_SUCCESS;
+        }
 
-        size_t pos = text.find(command);
+        if ( args.size() != 3 or args[1] != "stop" ) {
+            Runner::display("Parâmetros inválidos.\n", 'e');
+            Runner::display("USO: trace | trace start | trace stop <arquivo.json>");
+            return EXIT_FAILURE;
+        }
+
+        size_t written, dropped;
+
+        tracer.stop();
+
+        if ( tracer.dump(args[2], written, dropped) != EXIT_SUCCESS ) {
+            Runner::display("Não foi possível gravar o trace em " + args[2], 'e');
+            return EXIT_FAILURE;
+        }
+
+        Runner::display(std::to_string(written) + " eventos gravados em " + args[2]);
 
-        if ( pos != std::string::npos )
-            text.erase(pos, command.size());
+        if ( dropped > 0 ) Runner::display(" (" + std::to_string(dropped) + " eventos antigos descartados)");
 
-        return trim(text);
+        return EXIT_SUCCESS;
     }
 
-    /**
-     * Obtém o caminho no formato ./caminho/qualquer.
-     * 
-     * @param[in] path O caminho a ser convertido.
-     * @return status da operação. 
-    */
-    int getPath(std::string & arg) {
-        if ( arg == "" ) return -1;
+    // Comando para exibir as estatísticas de latência e E/S dos comandos
+    int statsCommand(std::vector<std::string> & args) {
+        if ( args.size() == 2 and args[1] == "clear" ) {
+            CommandStats::instance().clear();
+            return EXIT_SUCCESS;
+        }
 
-        if ( std::regex_match(arg, std::regex("\"(.*)\"")) )
-            arg = arg.substr(1, arg.size() - 2);
-        else if ( arg.find(" ") != std::string::npos ) return -2;
-        
-        if ( not (arg[0] == '/' or ( arg[0] == '.' and arg[1] == '/') ) )
-            arg = "./" + arg;
+        if ( args.size() == 3 and args[1] == "io" and ( args[2] == "on" or args[2] == "off" ) ) {
+            CommandStats::instance().setTrackingIo(args[2] == "on");
+            return EXIT_SUCCESS;
+        }
 
-        std::string home = getenv("HOME");
-        int pos = arg.find("./~");
+        if ( args.size() != 1 ) {
+            Runner::display("Parâmetros inválidos.\n", 'e');
+            Runner::display("USO: stats | stats clear | stats io on | stats io off");
+            return EXIT_FAILURE;
+        }
+
+        auto duration = [](const uint64_t & ns) {
+            std::stringstream ss;
+            ss << std::fixed << std::setprecision(1);
 
-        if ( pos != std::string::npos )
-            arg.replace(pos, 3, home);
+            if ( ns < 1000 ) ss << ns << " ns";
+            else if ( ns < 1000000 ) ss << ns / 1e3 << " us";
+            else if ( ns < 1000000000 ) ss << ns / 1e6 << " ms";
+            else ss << ns / 1e9 << " s";
 
-        return 0;
+            return ss.str();
+        };
+
+        std::stringstream ss;
+
+        ss << padRight("comando", 12) << std::right << std::setw(8) << "n" << std::setw(11) << "p50";
+        ss << std::setw(11) << "p99" << std::setw(11) << "max" << std::setw(14) << "chamadas E/S";
+        ss << std::setw(12) << "lidos KB" << std::setw(12) << "escritos KB";
+
+        for ( auto & item: CommandStats::instance().getEntries() ) {
+            CommandStats::Entry & entry = *item.second;
+            uint64_t n = entry.latency.count();
+
+            if ( n == 0 ) continue;
+
+            ss << '\n' << padRight(item.first, 12) << std::right << std::setw(8) << n;
+            ss << std::setw(11) << duration(entry.latency.percentile(50));
+            ss << std::setw(11) << duration(entry.latency.percentile(99));
+            ss << std::setw(11) << duration(entry.latency.max());
+            ss << std::setw(14) << entry.ioCalls.load() / n;
+            ss << std::setw(12) << entry.readBytes.load() / n / 1024;
+            ss << std::setw(12) << entry.writtenBytes.load() / n / 1024;
+        }
+
+        Runner::display(ss.str());
+        return EXIT_SUCCESS;
+    }
+
+    // Quando não é possível obter o comando do texto
+    int invalidCommand(std::vector<std::string> & args) {
+        std::string text;
+
+        for ( auto & arg: args ) text += ( text.empty() ? "" : " " ) + arg;
+
+        Runner::display("Comando inválido: " + text, 'e');
+        return 127;
     }
     
     public: 
 
     bool isRunning = false;     /// @brief Indica se o shell está executando
+    bool interactive = true;    /// @brief Indica se o shell exibe o prompt e as mensagens de boas vindas
+    int lastStatus = 0;         /// @brief Status do último comando executado, disponível em "$?"
+    LineReader input;           /// @brief Origem dos comandos
+    Prompt prompt;              /// @brief Prompt exibido no modo interativo
+    std::unique_ptr<History> history;       /// @brief Histórico de comandos do modo interativo
+    std::unique_ptr<LineEditor> editor;     /// @brief Editor da linha, quando a entrada é um terminal
+    std::string lastCommand;                /// @brief Último comando lido, que não é repetido no histórico
+
+    /**
+     * Contrutor
+     * 
+     * Inicaliza o Shell que lê os comandos do terminal e apresenta a
+     * mensagem de boas vindas.
+    */
+    Shell() : Shell(STDIN_FILENO, true) {}
+
+    /**
+     * Contrutor
+     * 
+     * Inicaliza o Shell que lê os comandos de um descritor. A tela só é
+     * limpa e as mensagens de boas vindas só são exibidas no modo interativo.
+     * 
+     * @param[in] fd Descritor de onde os comandos são lidos
+     * @param[in] interactive Indica se o shell é interativo
+    */
+    Shell(const int & fd, const bool & interactive) : input(fd) {
+        start(interactive);
+    }
 
     /**
      * Contrutor
      * 
-     * Inicaliza o Shell e apresenta a mensagem de boas vindas.
+     * Inicaliza o Shell não interativo que executa os comandos de um texto (-c).
+     * 
+     * @param[in] text Os comandos, um por linha
     */
-    Shell() {
+    explicit Shell(const std::string & text) : input(text) {
+        start(false);
+    }
+
+    private:
+
+    void start(const bool & interactive) {
         isRunning = true;
+        this->interactive = interactive;
+
+        // A escrita em um pipe fechado deve apenas falhar, sem encerrar o shell
+        signal(SIGPIPE, SIG_IGN);
+
+        CommandStats::instance().setTrackingIo(interactive);
+
+        if ( !interactive ) return;
+
+        const char *file = getenv("SHELL_PROJECT_HISTORY"), *home = getenv("HOME");
+        std::string path = file != nullptr ? file : std::string(home != nullptr ? home : ".") + "/.shell_project_history";
+
+        history.reset(new History(path));
+        if ( isatty(STDIN_FILENO) ) editor.reset(new LineEditor(*history));
 
         Runner::clear();
         Runner::display (
-            ANSI_COLOR_RESET + 
+            Runner::color(ANSI_COLOR_RESET) + 
             "Bem vindo ao Shell Project!\n" +
             "Digite \"exit\" ou \"quit\" para sair."
         );
@@ -619,6 +9169,8 @@ class Shell {
         Runner::display(getHelpText());
     }
 
+    public:
+
     std::string getHelpText() {
         std::stringstream ss;
 
@@ -642,351 +9194,215 @@ class Shell {
      * Mostra a linha de comando para o usuário.
     */
     void showCommandLine(void) {
-        std::string current = Runner::getCurrentDirectory();
-        std::string home = getenv("HOME");
-        int pos = current.find(home);
+        auto start = std::chrono::steady_clock::now();
 
-        if ( pos != std::string::npos )
-            current.replace(pos, home.size(), "~");
+        Runner::display(prompt.render());
 
-        Runner::display(
-            ANSI_COLOR_CYAN + "\n\n" + Runner::getCurrentUser() + "@" + Runner::getHostname() + " " +
-            ANSI_COLOR_GREEN + current + "  " +
-            ANSI_COLOR_WHITE + "$ "
-        );
+        // A saída acumulada pelo último comando é exibida junto com o prompt
+        Runner::flush();
+
+        prompt.record(std::chrono::steady_clock::now() - start);
     }
 
     /**
      * Obtém o texto digitado pelo usuário na linha de comando.
      * 
-     * @return O texto digitado.
+     * @param[out] text O texto digitado.
+     * @return false quando a entrada termina.
     */
-    std::string getTextFromCommandLine() {
-        std::string text;
-        std::getline(std::cin, text);
-        return text;
+    bool getTextFromCommandLine(std::string & text) {
+        if ( editor == nullptr ) return input.getLine(text);
+
+        const std::string & current = prompt.render();
+
+        return editor->read(current.substr(current.rfind('\n') + 1), text);
     }
 
     /**
-     * Tenta executar um comando a partir de um texto.
-     * Caso o texto seja válido, o comando é executado.
-     * Caso contrário, uma mensagem de erro é apresentada.
+     * Expande uma referência ao histórico: "!!" (último comando), "!n"
+     * (comando n), "!-n" (n-ésimo comando a partir do fim) e "!texto"
+     * (último comando iniciado pelo texto).
      * 
+     * @param[in, out] text A linha de comando, substituída pelo comando do histórico
+     * @return false caso a referência não exista no histórico.
     */
-    void runCommandFromText(std::string text) {
+    bool expandHistory(std::string & text) {
+        std::string event = trim(text);
 
-        // Comando de saída do shell
-        if ( std::regex_match(text, std::regex("(\\s*)(exit|quit)(\\s*)")) )
-            isRunning = false;
+        if ( event.size() < 2 or event[0] != '!' ) return true;
 
-        // Apresenta a lista de comandos disponíveis
-        else if ( std::regex_match(text, std::regex("(\\s*)(help)(\\s*)")) ) {
-            Runner::display(getHelpText());
-        }
+        std::string reference = event.substr(1);
+        size_t size = history->size(), number = 0;
 
-        // Comando de ajuda de um comando específico
-        else if ( std::regex_match(text, std::regex("(\\s*)(help)(\\s*)(.*)")) ) {
-            std::string cmd = getArgs("help", text);
-            Runner::display(Runner::getCommandDescription(cmd));
+        if ( reference == "!" ) number = size;
+        else if ( reference.find_first_not_of("0123456789") == std::string::npos ) number = std::stoull(reference.substr(0, 18));
+        else if ( reference[0] == '-' and reference.size() > 1 and
+                  reference.find_first_not_of("0123456789", 1) == std::string::npos ) {
+            size_t back = std::stoull(reference.substr(1, 18));
+            number = back > 0 and back <= size ? size - back + 1 : 0;
         }
+        else number = history->searchPrefix(reference);
 
-        // Comando para mostrar um texto
-        else if ( std::regex_match(text, std::regex("(\\s*)(echo)(\\s*)(.*)")) ) {
-            Runner::display(getArgs("echo", text));
-        } 
-
-        // Comando para limpar a tela do shell
-        else if ( std::regex_match(text, std::regex("(\\s*)(clear)(\\s*)(.*)")) ) {
-            Runner::clear();
-        } 
-
-        // Comando de alteração de diretório
-        else if ( std::regex_match(text, std::regex("(\\s*)(cd)(\\s*)(.*)")) ) {
-            std::string arg = getArgs("cd", text);
-            int status = getPath(arg);
-
-            if ( status == -1 ) {
-                Runner::display("É necessário especificar o diretório de destino.", 'e');
-                return;
-            } else if ( status == -2 ) {
-                Runner::display("Diretório de destino inválido.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas um parâmetro.");
-                return;
-            }
-
-            if ( Runner::changeDirectory(arg) < 0 ) 
-                Runner::display("Diretório não encontrado: " + arg, 'e');
+        if ( number == 0 or !history->get(number, text) ) {
+            Runner::display("Evento não encontrado: " + event, 'e');
+            return false;
         }
 
-        // Comando para exibir o atual diretório
-        else if ( std::regex_match(text, std::regex("(\\s*)(pwd)(\\s*)")) )
-            Runner::display(Runner::getCurrentDirectory());
-
-            // Comando para exibir o atual diretório
-        else if ( std::regex_match(text, std::regex("(\\s*)(ls)(\\s*)(.*)")) ) {
-            std::string args = getArgs("ls", text);
-            bool a = false, l = false;
-            std::stringstream ss;
-
-            if ( args == "-a") a = true;
-            else if ( args == "-l" ) l = true;
-            else if ( args == "-la" ) a = true, l = true;
-            else if ( !args.empty() ) {
-                Runner::display("Parâmetros inválidos.", 'e');
-                return;
-            }
+        // Exibe o comando que será executado, como o bash
+        Runner::display(text + "\n");
+        return true;
+    }
 
-            for (dirent * d: Runner::getItensOfDirectory(Runner::getCurrentDirectory(), a))
-                ss << d->d_name << (l ?'\n' :'\t');
+    /**
+     * Executa os comandos da entrada até o fim dela ou até o comando exit.
+     * O prompt só é exibido no modo interativo.
+     * 
+     * @return O status do último comando executado.
+    */
+    int run() {
+        std::string text;
 
-            if (errno == ENOENT) {
-                Runner::display("Diretório não encontrado!", 'e');
-                return;
-            }
-        
-            Runner::display(ss.str());
-        }
+        while ( isRunning ) {
+            if ( interactive ) showCommandLine();
+            if ( !getTextFromCommandLine(text) ) break;
 
-        // Comando para visualizar o conteúdo de um arquivo
-        else if ( std::regex_match(text, std::regex("(\\s*)(cat)(\\s*)(.*)")) ) {
-            std::string arg = getArgs("cat", text);
-            int status = getPath(arg);
+            if ( history != nullptr ) {
+                if ( !expandHistory(text) ) {
+                    lastStatus = EXIT_FAILURE;
+                    continue;
+                }
 
-            if ( status == -1 ) {
-                Runner::display("É necessário especificar o caminho correto do arquivo.", 'e');
-                return;
-            } else if ( status == -2 ) {
-                Runner::display("Diretório de destino inválido.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas um parâmetro.");
-                return;
+                // Linhas vazias e repetições do último comando não entram no histórico
+                if ( !trim(text).empty() and text != lastCommand ) history->add(text);
+                lastCommand = text;
             }
 
-            std::string content;
-            status = Runner::getFileContent(arg, content);
-            
-            if ( status  == OPEN_FAILURE ) {
-                Runner::display("Arquivo não encontrado: " + arg + "\n", 'e');
-                Runner::display("OBS 1: Verifique se o caminho para o arquivo está correto.\n");
-                Runner::display("OBS 2: É necessário informar a extensão do arquivo.\n");
-            }
-            else if ( status == MALLOC_FAILURE ) Runner::display("Erro ao alocar recursos.", 'e');
-            else if ( status == READ_FAILURE ) Runner::display("Erro ao realizar a leitura do arquivo.", 'e');
-            else Runner::display(content);
+            runCommandFromText(text);
 
+            if ( !interactive ) OutputBuffer::instance().endLine();
         }
 
-        // Comando para criar um arquivo em branco
-        else if ( std::regex_match(text, std::regex("(\\s*)(touch)(\\s*)(.*)")) ) {
-            std::string arg = getArgs("touch", text);
-            int status = getPath(arg);
-
-            if ( status == -1 ) {
-                Runner::display("É necessário especificar o caminho correto do arquivo.", 'e');
-                return;
-            } else if ( status == -2 ) {
-                Runner::display("Diretório de destino inválido.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas um parâmetro.");
-                return;
-            }
+        return lastStatus;
+    }
 
-            status = Runner::createBlankFile(arg);
-            
-            if ( status  == OPEN_FAILURE ) Runner::display("O arquivo não pode ser criado!", 'e');
-            else Runner::display("Arquivo gerado com sucesso!");
+    /**
+     * Tenta executar um comando a partir de um texto.
+     * Caso o texto seja válido, o comando é executado.
+     * Caso contrário, uma mensagem de erro é apresentada.
+     * 
+     * O texto é dividido em tokens uma única vez e o comando
+     * é localizado na tabela de despacho pelo primeiro token.
+     * Comandos que não são internos são executados como programas, e
+     * comandos separados por '|' são executados como um pipeline.
+    */
+    void runCommandFromText(const std::string & text) {
+        std::vector<std::string> args, patterns;
+        std::vector<size_t> pipes;
+
+        // Linhas iniciadas por '#' são comentários (e.g. "#!" na primeira linha de um script)
+        size_t first = text.find_first_not_of(" \t");
+        if ( first == std::string::npos or text[first] == '#' ) return;
+
+        if ( tokenize(text, args, lastStatus, &pipes, &patterns) == SYNTAX_FAILURE ) {
+            Runner::display("Aspas não foram fechadas: " + text, 'e');
+            lastStatus = 2;
+            return;
         }
 
-        // Comando para criar um arquivo em branco
-        else if ( std::regex_match(text, std::regex("(\\s*)(cp)(\\s*)(.*)")) ) {
-            std::string args = getArgs("cp", text);
-            std::vector<std::string> paths;
-
-            if ( std::regex_match(args, std::regex("(\"(.*)\")(\\s)+((\"(.*)\"))")) )
-                paths = getSubstrings(args, '"');
-            else if ( std::regex_match(args, std::regex("([^\\s]+)(\\s)+([^\\s]+)")) )
-                paths = split(args, ' ');
-            else {
-                Runner::display("Parâmetros inválidos.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas dois parâmetro.");
-                return;
-            }
-
-            if ( paths.empty() ) {
-                Runner::display("É necessário especificar os nomes dos arquivos.", 'e');
-                return;
-            }
-
-            int s1 = getPath(paths[0]), s2 = getPath(paths[1]);
+        for ( auto & pattern: patterns ) {
+            if ( pattern.empty() ) continue;
 
-            if ( s1 == -1 or s2 == -1 ) {
-                Runner::display("É necessário especificar o caminho correto do arquivo.", 'e');
-                return;
-            } else if ( s1 == -2 or s2 == -2 ) {
-                Runner::display("Diretório de destino inválido.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas dois parâmetro.");
-                return;
-            }
-            
-            int status = Runner::copyContentFile(paths[0], paths[1]);
-           
-            if ( status  == OPEN_FAILURE ) Runner::display("O arquivo de origem não pode ser encontrado!", 'e');
-            else if ( status  == READ_FAILURE ) Runner::display("O arquivo de origem não pode ser lido!", 'e');
-            else if ( status == MALLOC_FAILURE ) Runner::display("Erro ao alocar recursos.", 'e');
-            else if ( status  == WRITE_FAILURE) Runner::display("O arquivo de destino não pode escrito!", 'e');
-            else Runner::display("Conteúdo copiado com sucesso!");
+            expandGlobs(args, pipes, patterns);
+            break;
         }
 
-        // Comando para criar um diretório
-        else if ( std::regex_match(text, std::regex("(\\s*)(mkdir)(\\s*)(.*)")) ) {
-            std::string arg = getArgs("mkdir", text);
-            int status = getPath(arg);
+        if ( args.empty() and pipes.empty() ) return;
 
-            if ( status == -1 ) {
-                Runner::display("É necessário especificar o caminho correto do arquivo.", 'e');
-                return;
-            } else if ( status == -2 ) {
-                Runner::display("Diretório de destino inválido.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas um parâmetro.");
-                return;
-            }
+        // "time" antes de um comando ou de um pipeline mede toda a sua execução
+        if ( !args.empty() and args[0] == "time" and args.size() > 1 and ( pipes.empty() or pipes[0] > 1 ) ) {
+            args.erase(args.begin());
+            for ( auto & pipe: pipes ) pipe--;
 
-            status = Runner::createDirectory(arg);
-            
-            if ( status == EXIT_FAILURE ) Runner::display("Ocorreu um problema ao criar o diretório!", 'e');
-            else Runner::display("Diretório criado com sucesso!");
+            lastStatus = timeCommand(args, pipes, text);
+            return;
         }
 
-        // Comando para remover um diretório
-        else if ( std::regex_match(text, std::regex("(\\s*)(rmdir)(\\s*)(.*)")) ) {
-            std::string arg = getArgs("rmdir", text);
-            int status = getPath(arg);
-
-            if ( status == -1 ) {
-                Runner::display("É necessário especificar o caminho correto do arquivo.", 'e');
-                return;
-            } else if ( status == -2 ) {
-                Runner::display("Diretório de destino inválido.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas um parâmetro.");
-                return;
-            }
-
-            bool isEmpty = Runner::getItensOfDirectory(arg, true).size() <= 2;
-
-            if ( isEmpty ) {
-                if ( Runner::removeDirectory(arg) == EXIT_FAILURE ) {
-                    Runner::display("Ocorreu um problema ao remover o diretório!", 'e');
-                    return;
-                }
-            } else {
-                Runner::display("Este diretório contém arquivos e/ou diretórios. Ao continuar, todos serão removidos.\n");
-                Runner::display("Deseja continuar [s/n]? ");
-                std::string res;
+        lastStatus = execute(args, pipes, text);
+    }
 
-                std::cin >> res;
+};
 
-                // Limpa o buffer de entrada do objeto std::cin
-                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+const std::unordered_map<std::string, Shell::Handler> Shell::commands = {
+    { "exit", &Shell::exitCommand },
+    { "quit", &Shell::exitCommand },
+    { "help", &Shell::helpCommand },
+    { "echo", &Shell::echoCommand },
+    { "clear", &Shell::clearCommand },
+    { "cd", &Shell::cdCommand },
+    { "pwd", &Shell::pwdCommand },
+    { "ls", &Shell::lsCommand },
+    { "cat", &Shell::catCommand },
+    { "touch", &Shell::touchCommand },
+    { "cp", &Shell::cpCommand },
+    { "mkdir", &Shell::mkdirCommand },
+    { "rmdir", &Shell::rmdirCommand },
+    { "rmfile", &Shell::rmfileCommand },
+    { "mv", &Shell::mvCommand },
+    { "cache", &Shell::cacheCommand },
+    { "hash", &Shell::hashCommand },
+    { "output", &Shell::outputCommand },
+    { "prompt", &Shell::promptCommand },
+    { "stats", &Shell::statsCommand },
+    { "trace", &Shell::traceCommand },
+    { "history", &Shell::historyCommand },
+    { "find", &Shell::findCommand },
+    { "grep", &Shell::grepCommand },
+    { "wc", &Shell::wcCommand },
+    { "head", &Shell::headCommand },
+    { "tail", &Shell::tailCommand }
+};
 
-                if ( trim(res) == "s" ) {
-                    if ( Runner::removeDirectory(arg) == EXIT_FAILURE ) {
-                        Runner::display("Ocorreu um problema ao remover o diretório!", 'e');
-                        return;
-                    }
-                } else {
-                    Runner::display("Diretório não removido!");
-                }
+// Os benchmarks (bench/shell_bench.cpp) incluem este arquivo sem a função main
+#ifndef SHELL_PROJECT_NO_MAIN
 
-            }
+/**
+ * Uso:
+ *   ShellProject                  Modo interativo (ou lê os comandos da entrada padrão, se não for um terminal)
+ *   ShellProject -c "comandos"    Executa os comandos e termina
+ *   ShellProject script           Executa os comandos de um arquivo e termina
+ * 
+ * @return O status do último comando executado.
+*/
+int main (int argc, char *argv[]) {
 
-            Runner::display("Diretório removido com sucesso!");
+    if ( argc > 1 and std::string(argv[1]) == "-c" ) {
+        if ( argc < 3 ) {
+            std::cerr << "USO: " << argv[0] << " [-c comandos | script]" << std::endl;
+            return 2;
         }
 
-        // Comando para criar um arquivo em branco
-        else if ( std::regex_match(text, std::regex("(\\s*)(rmfile)(\\s*)(.*)")) ) {
-            std::string arg = getArgs("rmfile", text);
-            int status = getPath(arg);
+        Shell shell{std::string(argv[2])};
+        return shell.run();
+    }
 
-            if ( status == -1 ) {
-                Runner::display("É necessário especificar o caminho correto do arquivo.", 'e');
-                return;
-            } else if ( status == -2 ) {
-                Runner::display("Diretório de destino inválido.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas um parâmetro.");
-                return;
-            }
+    if ( argc > 1 ) {
+        int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
 
-            status = Runner::removeFile(arg);
-            
-            if ( status  == EXIT_FAILURE ) Runner::display("O arquivo não pode ser removido!", 'e');
-            else Runner::display("Arquivo removido com sucesso!");
+        if ( fd < 0 ) {
+            std::cerr << argv[0] << ": " << argv[1] << ": " << strerror(errno) << std::endl;
+            return 127;
         }
 
-        // Move arquivos
-        else if ( std::regex_match(text, std::regex("(\\s*)(mv)(\\s*)(.*)")) ) {
-            std::string args = getArgs("mv", text);
-            std::vector<std::string> paths;
-
-            if ( std::regex_match(args, std::regex("(\"(.*)\")(\\s)+((\"(.*)\"))")) )
-                paths = getSubstrings(args, '"');
-            else if ( std::regex_match(args, std::regex("([^\\s]+)(\\s)+([^\\s]+)")) )
-                paths = split(args, ' ');
-            else {
-                Runner::display("Parâmetros inválidos.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas dois parâmetro.");
-                return;
-            }
-
-            if ( paths.empty() ) {
-                Runner::display("É necessário especificar os nomes dos arquivos.", 'e');
-                return;
-            }
-
-            int s1 = getPath(paths[0]), s2 = getPath(paths[1]);
-
-            if ( s1 == -1 or s2 == -1 ) {
-                Runner::display("É necessário especificar o caminho correto do arquivo.", 'e');
-                return;
-            } else if ( s1 == -2 or s2 == -2 ) {
-                Runner::display("Diretório de destino inválido.\n", 'e');
-                Runner::display("OBS 1: Caminhos com espaços em branco precisam utilizar aspas duplas no início e no fim.\n");
-                Runner::display("OBS 2: Este comando aceita apenas dois parâmetro.");
-                return;
-            }
+        Shell shell(fd, false);
+        int status = shell.run();
 
-            int status = Runner::moveFiles(paths[0], paths[1]);
-            
-            if ( status  == OPEN_FAILURE ) Runner::display("O arquivo de origem não pode ser encontrado!", 'e');
-            else if ( status  == READ_FAILURE ) Runner::display("O arquivo de origem não pode ser lido!", 'e');
-            else if ( status == MALLOC_FAILURE ) Runner::display("Erro ao alocar recursos.", 'e');
-            else if ( status  == WRITE_FAILURE) Runner::display("O arquivo não pode ser movido!", 'e');
-            else if ( status  == EXIT_FAILURE) Runner::display("O arquivo não pode ser movido!", 'e');
-            else Runner::display("Arquivo movido com sucesso!");
-        }
-        
-        // Quando não é possível obter o comando do texto
-        else Runner::display("Comando inválido: " + text, 'e');        
+        close(fd);
+        return status;
     }
 
-};
-
-int main (void) {
+    Shell shell(STDIN_FILENO, isatty(STDIN_FILENO));
 
-    std::string text;
-    Shell shell;
-
-    while ( shell.isRunning ) {
-        shell.showCommandLine();
-        text = shell.getTextFromCommandLine();
-        shell.runCommandFromText(text);
-    }
+    return shell.run();
+}
 
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+#endif
@@ -0,0 +1,852 @@
+/**
+ * Shell Project - Benchmarks
+ *
+ * Descrição:       Mede as operações do Runner, o despacho de comandos e o
+ *                  modo script sobre cargas sintéticas (árvores largas e
+ *                  profundas, arquivos pequenos, grandes e esparsos).
+ *
+ * Uso:
+ *   shell_bench [--dir <diretório>] [--scale <fator>] [--filter <texto>]
+ *               [--out <resultados.json>] [--baseline <base.json>] [--threshold <%>]
+ *
+ *   --dir        Diretório onde as cargas são geradas (padrão: /tmp). Utilize
+ *                um diretório no sistema de arquivos que deve ser medido.
+ *   --scale      Multiplica o tamanho das cargas (e.g. 0.1 para uma execução rápida)
+ *   --filter     Executa apenas os benchmarks cujo nome contém o texto
+ *   --out        Grava os resultados em JSON (padrão: saída padrão)
+ *   --baseline   Compara as medianas com um resultado salvo anteriormente
+ *   --threshold  Diferença, em %, a partir da qual a comparação é uma regressão (padrão: 10)
+ *
+ * O resumo é exibido em stderr. Com --baseline, o status de saída é 1
+ * caso alguma mediana esteja acima do limite. Os arquivos são lidos com
+ * o cache de páginas já preenchido pela geração da carga.
+ *
+ * Além dos tempos, o JSON traz as medidas de memória ("quantities"): o
+ * pico de RSS do cat em arquivos de 1 MB, 1 GB e 10 GB (cat-rss) e os
+ * bytes por item do DirListing com 10 mil, 1 milhão e 10 milhões de
+ * itens. O despacho atual é comparado com a cadeia de regex anterior
+ * (dispatch/mv-before-regex-chain e dispatch/mv-after-hashed).
+*/
+
+#include "ShellProject.cpp"
+
+#include <fstream>
+#include <regex>
+
+namespace Bench {
+
+    /// @brief Resultado de um benchmark, com os tempos de uma operação em nanossegundos.
+    struct Result {
+        std::string name;
+        size_t iterations;
+        uint64_t median;
+        uint64_t min;
+        uint64_t mean;
+        uint64_t bytes;             // Bytes processados por operação (0 quando não se aplica)
+    };
+
+    /// @brief Uma medida que não é um tempo, como a memória ocupada por uma operação.
+    struct Quantity {
+        std::string name;
+        double value;
+        std::string unit;
+    };
+
+    struct Options {
+        std::string dir = "/tmp";
+        double scale = 1.0;
+        std::string filter;
+        std::string out;
+        std::string baseline;
+        double threshold = 10.0;
+    };
+
+    static Options options;
+    static std::vector<Result> results;
+    static std::vector<Quantity> quantities;
+
+    /**
+     * Ajusta uma quantidade pelo fator de escala, com um mínimo de 1.
+    */
+    size_t scaled(const size_t & value) {
+        return std::max<size_t>(1, value * options.scale);
+    }
+
+    /**
+     * Mede uma operação.
+     *
+     * A preparação é executada antes de cada iteração e não é medida. Cada
+     * iteração executa a operação `batch` vezes, e o tempo é dividido por
+     * `batch`, o que permite medir operações de poucos nanossegundos.
+     *
+     * @param[in] name Nome do benchmark
+     * @param[in] iterations Quantidade de iterações
+     * @param[in] batch Operações por iteração
+     * @param[in] bytes Bytes processados por operação
+     * @param[in] setup Preparação de cada iteração
+     * @param[in] run A operação medida
+    */
+    void measure(const std::string & name, const size_t & iterations, const size_t & batch, const uint64_t & bytes,
+                 const std::function<void(size_t)> & setup, const std::function<void(size_t)> & run) {
+        std::vector<uint64_t> samples;
+
+        for ( size_t i = 0; i < iterations; i++ ) {
+            if ( setup ) setup(i);
+
+            auto start = std::chrono::steady_clock::now();
+            for ( size_t j = 0; j < batch; j++ ) run(i * batch + j);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+
+            samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / batch);
+        }
+
+        std::sort(samples.begin(), samples.end());
+
+        uint64_t total = 0;
+        for ( auto & sample: samples ) total += sample;
+
+        results.push_back({ name, iterations, samples[samples.size() / 2], samples.front(), total / samples.size(), bytes });
+
+        std::cerr << padRight(name, 36) << std::right << std::setw(14) << samples[samples.size() / 2] << " ns";
+
+        if ( bytes > 0 )
+            std::cerr << std::setw(12) << std::fixed << std::setprecision(1)
+                      << bytes / ( samples[samples.size() / 2] / 1e9 ) / 1048576.0 << " MB/s";
+
+        std::cerr << std::endl;
+    }
+
+    /**
+     * Registra uma medida que não é um tempo. As medidas são gravadas no
+     * JSON, mas não participam da comparação com a base.
+    */
+    void report(const std::string & name, const double & value, const std::string & unit) {
+        quantities.push_back({ name, value, unit });
+
+        std::cerr << padRight(name, 36) << std::right << std::setw(14) << std::fixed << std::setprecision(1)
+                  << value << " " << unit << std::endl;
+    }
+
+    /**
+     * Lê um campo de /proc/self/status, em KB.
+    */
+    size_t readStatus(const char *field) {
+        std::ifstream in("/proc/self/status");
+        std::string line;
+
+        while ( std::getline(in, line) )
+            if ( line.compare(0, strlen(field), field) == 0 ) return std::stoull(line.substr(strlen(field) + 1));
+
+        return 0;
+    }
+
+    /**
+     * Mede quanto a memória residente cresce durante uma operação.
+     *
+     * A operação é executada em um processo filho, cujo pico (VmHWM) é
+     * reiniciado com /proc/self/clear_refs: o pico do benchmark, que
+     * acumula as cargas anteriores, não interfere na medida.
+     *
+     * @return O crescimento do pico, em KB.
+    */
+    size_t measureRss(const std::function<void()> & run) {
+        int fds[2];
+        size_t growth = 0;
+
+        if ( pipe2(fds, O_CLOEXEC) < 0 ) return 0;
+
+        pid_t pid = fork();
+
+        if ( pid == 0 ) {
+            size_t before = readStatus("VmRSS:");
+            int fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+
+            if ( fd >= 0 ) Runner::writeAll(fd, "5", 1), close(fd);
+
+            run();
+
+            size_t peak = readStatus("VmHWM:");
+            growth = peak > before ? peak - before : 0;
+            Runner::writeAll(fds[1], (const char *) &growth, sizeof growth);
+            _exit(0);
+        }
+
+        close(fds[1]);
+        if ( pid < 0 or read(fds[0], &growth, sizeof growth) != sizeof growth ) growth = 0;
+        close(fds[0]);
+
+        if ( pid > 0 ) waitpid(pid, nullptr, 0);
+
+        return growth;
+    }
+
+    /**
+     * Indica se um grupo de benchmarks deve ser executado (--filter).
+    */
+    bool selected(const std::string & group) {
+        return options.filter.empty() or group.find(options.filter) != std::string::npos
+            or options.filter.find(group) != std::string::npos;
+    }
+
+    /**
+     * Gera um arquivo com um conteúdo que não é comprimido nem deduplicado.
+    */
+    void writeFile(const std::string & path, const size_t & size) {
+        static const std::string block = [] {
+            std::string data(STREAM_BUFFER_SIZE, '\0');
+            uint64_t x = 88172645463325252ull;
+
+            for ( auto & c: data ) x ^= x << 13, x ^= x >> 7, x ^= x << 17, c = 'a' + x % 26;
+            return data;
+        }();
+
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        for ( size_t done = 0; fd >= 0 and done < size; done += block.size() )
+            Runner::writeAll(fd, block.data(), std::min(block.size(), size - done));
+
+        if ( fd >= 0 ) close(fd);
+    }
+
+    /**
+     * Gera um arquivo de texto: linhas de palavras aleatórias, com "needle" a cada 1000 linhas.
+    */
+    void writeTextFile(const std::string & path, const size_t & size) {
+        std::string data;
+        uint64_t x = 88172645463325252ull;
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        for ( size_t done = 0, line = 0; fd >= 0 and done < size; line++ ) {
+            for ( size_t word = 0; word < 10; word++ ) {
+                if ( word == 5 and line % 1000 == 0 ) data += "needle ";
+
+                for ( size_t k = 3 + line % 5; k > 0; k-- ) x ^= x << 13, x ^= x >> 7, x ^= x << 17, data += 'a' + x % 26;
+                data += word < 9 ? ' ' : '\n';
+            }
+
+            if ( data.size() >= STREAM_BUFFER_SIZE ) {
+                Runner::writeAll(fd, data.data(), data.size());
+                done += data.size();
+                data.clear();
+            }
+        }
+
+        if ( fd >= 0 ) close(fd);
+    }
+
+    /**
+     * Gera um arquivo esparso: blocos de dados separados por buracos.
+    */
+    void writeSparseFile(const std::string & path, const size_t & size, const size_t & every) {
+        std::string data(1 << 20, 'x');
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        if ( fd < 0 ) return;
+
+        for ( size_t offset = 0; offset + data.size() <= size; offset += every )
+            if ( pwrite(fd, data.data(), data.size(), offset) < 0 ) break;
+
+        if ( ftruncate(fd, size) < 0 ) perror("ftruncate");
+        close(fd);
+    }
+
+    /**
+     * Gera um diretório com muitos arquivos vazios.
+    */
+    void makeWideTree(const std::string & path, const size_t & files) {
+        mkdir(path.c_str(), 0755);
+
+        for ( size_t i = 0; i < files; i++ ) {
+            int fd = open(( path + "/arquivo_" + std::to_string(i) ).c_str(), O_WRONLY | O_CREAT, 0644);
+            if ( fd >= 0 ) close(fd);
+        }
+    }
+
+    /**
+     * Gera uma árvore com `fanout` subdiretórios por nível e arquivos pequenos em cada diretório.
+    */
+    void makeTree(const std::string & path, const size_t & depth, const size_t & fanout, const size_t & files) {
+        mkdir(path.c_str(), 0755);
+
+        for ( size_t i = 0; i < files; i++ ) writeFile(path + "/f" + std::to_string(i), 4096);
+
+        if ( depth == 0 ) return;
+
+        for ( size_t i = 0; i < fanout; i++ ) makeTree(path + "/d" + std::to_string(i), depth - 1, fanout, files);
+    }
+
+    /**
+     * Quantidade de arquivos de uma árvore gerada por makeTree.
+    */
+    size_t treeFiles(const size_t & depth, const size_t & fanout, const size_t & files) {
+        size_t total = files;
+        for ( size_t i = 0; depth > 0 and i < fanout; i++ ) total += treeFiles(depth - 1, fanout, files);
+        return total;
+    }
+
+    void benchDispatch() {
+        if ( selected("dispatch") ) {
+            Shell shell{std::string()};
+
+            measure("dispatch/builtin", 20, 5000, 0, nullptr, [&shell](size_t) { shell.runCommandFromText("pwd"); });
+            measure("dispatch/tokenize-quoted", 20, 5000, 0, nullptr,
+                    [&shell](size_t) { shell.runCommandFromText("echo \"a b\" 'c d' e\\ f $?"); });
+            measure("dispatch/unknown", 20, 1000, 0, nullptr,
+                    [&shell](size_t) { shell.runCommandFromText("comando_que_nao_existe"); });
+
+            // Antes do tokenizador, cada linha compilava e testava uma regex por comando interno,
+            // na ordem abaixo; o mv, o último, pagava por todas. As duas medidas despacham "mv"
+            // sem argumentos, que apenas exibe a mensagem de erro.
+            static const char *chain[] = {
+                "(\\s*)(exit|quit)(\\s*)", "(\\s*)(help)(\\s*)", "(\\s*)(help)(\\s*)(.*)", "(\\s*)(echo)(\\s*)(.*)",
+                "(\\s*)(clear)(\\s*)(.*)", "(\\s*)(cd)(\\s*)(.*)", "(\\s*)(pwd)(\\s*)", "(\\s*)(ls)(\\s*)(.*)",
+                "(\\s*)(cat)(\\s*)(.*)", "(\\s*)(touch)(\\s*)(.*)", "(\\s*)(cp)(\\s*)(.*)", "(\\s*)(mkdir)(\\s*)(.*)",
+                "(\\s*)(rmdir)(\\s*)(.*)", "(\\s*)(rmfile)(\\s*)(.*)", "(\\s*)(mv)(\\s*)(.*)"
+            };
+            std::string line = "mv";
+
+            measure("dispatch/mv-before-regex-chain", 20, 200, 0, nullptr, [&line](size_t) {
+                for ( auto & expression: chain )
+                    if ( std::regex_match(line, std::regex(expression)) ) break;
+
+                Runner::display("É necessário especificar os nomes dos arquivos.", 'e');
+            });
+            measure("dispatch/mv-after-hashed", 20, 5000, 0, nullptr, [&shell, &line](size_t) { shell.runCommandFromText(line); });
+            Runner::flush();
+        }
+
+        if ( selected("script") ) {
+            std::string script;
+            size_t commands = scaled(100000);
+
+            for ( size_t i = 0; i < commands; i++ ) script += "echo a\n";
+
+            measure("script/" + std::to_string(commands) + "-commands", 5, 1, 0, nullptr, [&script](size_t) {
+                Shell shell(script);
+                shell.run();
+                Runner::flush();
+            });
+        }
+
+        if ( selected("spawn") ) {
+            int status;
+            std::vector<std::string> trueArgs = { "true" }, shArgs = { "sh", "-c", "true" };
+
+            measure("spawn/posix_spawn", 10, scaled(50), 0, nullptr,
+                    [&](size_t) { Runner::runProgram("/bin/true", trueArgs, status); });
+            measure("spawn/sh-c", 10, scaled(50), 0, nullptr,
+                    [&](size_t) { Runner::runProgram("/bin/sh", shArgs, status); });
+        }
+    }
+
+    void benchHistory(const std::string & root) {
+        if ( !selected("history") ) return;
+
+        std::string path = root + "/history";
+        size_t entries = scaled(1000000);
+
+        {
+            std::ofstream out(path);
+            uint64_t x = 88172645463325252ull;
+
+            for ( size_t i = 0; i < entries; i++ ) {
+                x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+                out << "cmd" << i << " --arg " << std::hex << x << std::dec << '\n';
+            }
+        }
+
+        History history(path);
+        volatile size_t found;          // Impede que o compilador descarte as buscas, que não têm efeitos colaterais
+
+        measure("history/open-size", 5, 1, 0, nullptr, [&](size_t) { History(path).size(); });
+        // A primeira busca constrói os filtros de trigramas; as medições seguintes usam os filtros prontos
+        history.search("--arg", entries + 1);
+        measure("history/search-recent", 10, 1000, 0, nullptr, [&](size_t) { found = history.search("--arg", entries + 1); });
+        measure("history/search-oldest", 10, 10, 0, nullptr, [&](size_t) { found = history.search("cmd1 --arg", entries + 1); });
+        measure("history/search-missing", 10, 10, 0, nullptr, [&](size_t) { found = history.search("zzzz", entries + 1); });
+        measure("history/add", 5, 1000, 0, nullptr, [&](size_t) { history.add("echo novo comando"); });
+    }
+
+    void benchFiles(const std::string & root, int devNull) {
+        std::string small = root + "/small";
+        std::string huge = root + "/huge";
+        std::string sparse = root + "/sparse";
+        size_t smallFiles = scaled(1000);
+        size_t hugeSize = scaled(256) << 20;
+        size_t sparseSize = scaled(1024) << 20;
+
+        mkdir(small.c_str(), 0755);
+        for ( size_t i = 0; i < smallFiles; i++ ) writeFile(small + "/" + std::to_string(i), 4096);
+        writeFile(huge, hugeSize);
+        writeSparseFile(sparse, sparseSize, 64 << 20);
+
+        if ( selected("getFileContent") ) {
+            std::string content;
+
+            measure("getFileContent/4KiB", 5, smallFiles, 4096, nullptr,
+                    [&](size_t i) { Runner::getFileContent(small + "/" + std::to_string(i % smallFiles), content); });
+            measure("getFileContent/huge", 5, 1, hugeSize, nullptr, [&](size_t) { Runner::getFileContent(huge, content); });
+        }
+
+        if ( selected("streamFileContent") ) {
+            measure("streamFileContent/huge-devnull", 5, 1, hugeSize, nullptr,
+                    [&](size_t) { Runner::streamFileContent(huge, devNull); });
+
+            // Para um pipe, como o cat no início de um pipeline, com uma thread lendo a outra ponta
+            measure("streamFileContent/huge-pipe", 5, 1, hugeSize, nullptr, [&](size_t) {
+                int fds[2];
+
+                if ( pipe2(fds, O_CLOEXEC) < 0 ) return;
+
+                std::thread reader([&fds] {
+                    char buffer[STREAM_BUFFER_SIZE];
+                    while ( read(fds[0], buffer, sizeof buffer) > 0 );
+                });
+
+                Runner::streamFileContent(huge, fds[1]);
+                close(fds[1]);
+                reader.join();
+                close(fds[0]);
+            });
+        }
+
+        // Pico de memória e vazão do cat em arquivos de 1 MB, 1 GB e 10 GB (esparsos, para não
+        // ocupar o disco). A leitura inteira para a memória, o cat anterior, só é medida até 1 GB.
+        if ( selected("cat-rss") ) {
+            std::string file = root + "/cat_rss";
+
+            for ( size_t megabytes: { (size_t) 1, (size_t) 1024, (size_t) 10240 } ) {
+                size_t size = scaled(megabytes) << 20;
+                std::string name = "cat-rss/" + std::to_string(size >> 20) + "MB";
+
+                writeSparseFile(file, size, 64 << 20);
+
+                measure(name + "-stream", 3, 1, size, nullptr, [&](size_t) { Runner::streamFileContent(file, devNull); });
+                report(name + "-stream-peak", measureRss([&] { Runner::streamFileContent(file, devNull); }), "KB");
+
+                if ( megabytes <= 1024 ) {
+                    report(name + "-read-whole-peak", measureRss([&] {
+                        std::string content;
+                        Runner::getFileContent(file, content);
+                    }), "KB");
+                }
+            }
+
+            unlink(file.c_str());
+        }
+
+        if ( selected("copyContentFile") ) {
+            std::string target = root + "/copy";
+
+            measure("copyContentFile/4KiB", 5, smallFiles, 4096, nullptr,
+                    [&](size_t i) { Runner::copyContentFile(small + "/" + std::to_string(i % smallFiles), target); });
+            measure("copyContentFile/huge", 5, 1, hugeSize, nullptr, [&](size_t) { Runner::copyContentFile(huge, target); });
+            measure("copyContentFile/sparse", 5, 1, sparseSize, nullptr, [&](size_t) { Runner::copyContentFile(sparse, target); });
+            unlink(target.c_str());
+        }
+
+        if ( selected("pipeline") ) {
+            Shell shell{std::string()};
+            std::string command = "cat " + huge + " | cat";
+
+            measure("pipeline/cat-cat", 5, 1, hugeSize, nullptr, [&](size_t) { shell.runCommandFromText(command); });
+        }
+
+        if ( selected("grep") ) {
+            Shell shell{std::string()};
+            std::string text = root + "/text.txt";
+            size_t textSize = scaled(128) << 20;
+
+            writeTextFile(text, textSize);
+
+            auto grep = [&](const std::string & name, const std::string & args, const uint64_t & bytes) {
+                std::string command = "grep " + args;
+                measure("grep/" + name, 5, 1, bytes, nullptr, [&](size_t) { shell.runCommandFromText(command); });
+            };
+
+            grep("literal", "needle " + text, textSize);
+            grep("literal-count", "-c needle " + text, textSize);
+            grep("literal-ignore-case", "-ci NEEDLE " + text, textSize);
+            grep("literal-lines", "-n e " + text, textSize);
+            grep("regex-required", "-c 'ne+dle [a-z]+' " + text, textSize);
+            grep("regex-dfa", "-c '(abc|xyz)[a-z]q' " + text, textSize);
+            grep("invert-count", "-vc needle " + text, textSize);
+            grep("many-files", "-l zzzz " + small + "/*", smallFiles * 4096);
+
+            unlink(text.c_str());
+        }
+
+        // 1 GiB na escala padrão; --scale 10 compara com 10 GiB. O wc do sistema, quando
+        // instalado, é medido com os mesmos arquivos ("wc/gnu-*").
+        if ( selected("wc") ) {
+            Shell shell{std::string()};
+            std::string text = root + "/wc.txt";
+            size_t textSize = scaled(1024) << 20;
+            bool gnu = access("/usr/bin/wc", X_OK) == 0;
+
+            writeTextFile(text, textSize);
+
+            for ( auto & test: { std::make_pair("all", ""), std::make_pair("lines", "-l "), std::make_pair("bytes", "-c ") } ) {
+                std::string command = std::string("wc ") + test.second + text;
+                std::string external = "/usr/bin/" + command;
+
+                measure(std::string("wc/") + test.first, 5, 1, textSize, nullptr,
+                        [&](size_t) { shell.runCommandFromText(command); });
+
+                if ( gnu )
+                    measure(std::string("wc/gnu-") + test.first, 3, 1, textSize, nullptr,
+                            [&](size_t) { shell.runCommandFromText(external); });
+            }
+
+            unlink(text.c_str());
+        }
+
+        // O custo do head e do tail deve depender das linhas pedidas, e não do tamanho do arquivo
+        if ( selected("head") or selected("tail") ) {
+            Shell shell{std::string()};
+            std::string text = root + "/log.txt";
+
+            writeTextFile(text, scaled(256) << 20);
+
+            for ( auto & test: { std::make_pair("head/20", "head -n 20 "), std::make_pair("tail/20", "tail -n 20 "),
+                                 std::make_pair("tail/100000", "tail -n 100000 ") } ) {
+                std::string command = test.second + text;
+
+                if ( selected(test.first) )
+                    measure(test.first, 10, 10, 0, nullptr, [&](size_t) { shell.runCommandFromText(command); });
+            }
+
+            unlink(text.c_str());
+        }
+
+        Runner::removeDirectory(small);
+        unlink(huge.c_str());
+        unlink(sparse.c_str());
+    }
+
+    void benchDirectories(const std::string & root) {
+        volatile bool found;            // Impede que o compilador descarte as comparações
+        std::string wide = root + "/wide";
+        size_t wideFiles = scaled(100000);
+
+        makeWideTree(wide, wideFiles);
+
+        if ( selected("getItensOfDirectory") ) {
+            DirListing listing;
+
+            measure("getItensOfDirectory/wide", 10, 1, 0, nullptr, [&](size_t) {
+                listing.clear();
+                Runner::getItensOfDirectory(wide, listing, true);
+            });
+        }
+
+        if ( selected("DirListing") ) {
+            DirListing listing;
+            int fd = open(wide.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+            measure("DirListing/sort", 10, 1, 0, [&](size_t) {
+                listing.clear();
+                lseek(fd, 0, SEEK_SET);
+                Runner::readDirectory(fd, true, listing);
+            }, [&](size_t) { listing.sort(); });
+
+            close(fd);
+        }
+
+        // Memória por item e tempo de ordenação com 10 mil, 1 milhão e 10 milhões de nomes aleatórios
+        if ( selected("DirListing") ) {
+            DirListing listing;
+
+            for ( size_t count: { (size_t) 10000, (size_t) 1000000, (size_t) 10000000 } ) {
+                size_t n = scaled(count);
+                std::string name = "DirListing/" + std::to_string(n);
+
+                auto fill = [&](size_t) {
+                    uint64_t x = 88172645463325252ull;
+                    char text[32];
+
+                    listing.clear();
+
+                    for ( size_t i = 0; i < n; i++ ) {
+                        x ^= x << 13, x ^= x >> 7, x ^= x << 17;
+                        int length = snprintf(text, sizeof text, "arquivo_%016llx", (unsigned long long) x);
+                        listing.add(text, length, DT_REG, i);
+                    }
+                };
+
+                fill(0);
+                report(name + "-bytes-per-entry", (double) listing.usedMemory() / n, "B");
+                measure(name + "-sort", n >= 10000000 ? 3 : 5, 1, 0, fill, [&](size_t) { listing.sort(); });
+            }
+        }
+
+        if ( selected("completion") ) {
+            Completer completer;
+            Completer::Completion completion;
+            std::string all = "cat " + wide + "/", some = all + "arquivo_9", command = "ec";
+
+            // A primeira chamada inicia a leitura do diretório em segundo plano
+            while ( !completer.complete(all, all.size(), completion, 100) ) usleep(1000);
+
+            measure("completion/wide-all", 10, 100, 0, nullptr,
+                    [&](size_t) { completer.complete(all, all.size(), completion, 100); });
+            measure("completion/wide-prefix", 10, 100, 0, nullptr,
+                    [&](size_t) { completer.complete(some, some.size(), completion, 100); });
+            measure("completion/command", 10, 100, 0, nullptr,
+                    [&](size_t) { completer.complete(command, command.size(), completion, 100); });
+        }
+
+        if ( selected("glob") ) {
+            std::vector<std::string> paths;
+            Glob prefix(wide + "/arquivo_1*"), recursive(root + "/**/arquivo_*[13579]");
+            GlobPattern pattern("arquivo_*[0-9]?");
+            std::string name = "arquivo_123456";
+
+            measure("glob/wide-prefix", 10, 1, 0, nullptr, [&](size_t) { prefix.expand(paths); });
+            measure("glob/recursive", 5, 1, 0, nullptr, [&](size_t) { recursive.expand(paths); });
+            measure("glob/match", 10, 100000, 0, nullptr, [&](size_t) { found = pattern.match(name); });
+        }
+
+        if ( selected("find") ) {
+            FileFinder::Filter all, named, sized;
+            int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+            named.names.emplace_back("arquivo_9*", false);
+            sized.size.mode = '-';
+            sized.size.value = 1;
+
+            auto run = [&](const FileFinder::Filter & filter) {
+                FileFinder finder(filter, devNull);
+                ThreadPool pool;
+
+                finder.start(pool, root);
+                pool.wait();
+                finder.finish();
+            };
+
+            measure("find/all", 5, 1, 0, nullptr, [&](size_t) { run(all); });
+            measure("find/name", 5, 1, 0, nullptr, [&](size_t) { run(named); });
+            measure("find/size", 5, 1, 0, nullptr, [&](size_t) { run(sized); });
+
+            close(devNull);
+        }
+
+        if ( selected("getLongListing") ) {
+            DirListing listing;
+            std::vector<Runner::EntryInfo> entries;
+
+            measure("getLongListing/wide", 5, 1, 0, nullptr, [&](size_t) {
+                listing.clear();
+                entries.clear();
+                Runner::getLongListing(wide, true, true, listing, entries);
+            });
+        }
+
+        Runner::removeDirectory(wide);
+
+        if ( selected("createDirectory") ) {
+            std::string base = root + "/mkdir";
+            mkdir(base.c_str(), 0755);
+
+            measure("createDirectory/depth-8", 5, scaled(200), 0, nullptr, [&](size_t i) {
+                std::string path = base + "/" + std::to_string(i) + "/a/b/c/d/e/f/g";
+                Runner::createDirectory(path);
+            });
+
+            Runner::removeDirectory(base);
+        }
+
+        if ( selected("removeDirectory") ) {
+            std::string target = root + "/remove";
+            size_t files = scaled(20000);
+
+            measure("removeDirectory/wide", 3, 1, 0, [&](size_t) { makeWideTree(target, files); },
+                    [&](size_t) { Runner::removeDirectory(target); });
+            measure("removeDirectory/tree", 3, 1, 0, [&](size_t) { makeTree(target, 3, 8, scaled(20)); },
+                    [&](size_t) { Runner::removeDirectory(target); });
+        }
+
+        if ( selected("copyTree") ) {
+            std::string source = root + "/tree", target = root + "/tree_copy";
+            size_t files = treeFiles(3, 8, scaled(20));
+
+            makeTree(source, 3, 8, scaled(20));
+
+            measure("copyTree/tree", 3, 1, files * 4096, [&](size_t) { Runner::removeDirectory(target); }, [&](size_t) {
+                ThreadPool pool;
+                Runner::CopyStats stats;
+
+                Runner::copyTree(pool, source, target, stats);
+                pool.wait();
+                Runner::restoreDirectoryModes(stats);
+            });
+
+            Runner::removeDirectory(source);
+            Runner::removeDirectory(target);
+        }
+    }
+
+    void benchMove(const std::string & root) {
+        if ( !selected("moveFiles") ) return;
+
+        std::string a = root + "/mv_a", b = root + "/mv_b";
+        Runner::CopyStats stats;
+
+        makeTree(a, 1, 4, 10);
+
+        measure("moveFiles/rename", 5, 1000, 0, nullptr, [&](size_t i) {
+            if ( i % 2 == 0 ) Runner::moveFiles(a, b, stats);
+            else Runner::moveFiles(b, a, stats);
+        });
+
+        Runner::removeDirectory(a);
+        Runner::removeDirectory(b);
+
+        // Entre sistemas de arquivos, quando /dev/shm está em outro dispositivo
+        struct stat rootSt, shmSt;
+        std::string other = "/dev/shm/shell_bench_" + std::to_string(getpid());
+
+        if ( stat(root.c_str(), &rootSt) < 0 or stat("/dev/shm", &shmSt) < 0 or rootSt.st_dev == shmSt.st_dev ) {
+            std::cerr << padRight("moveFiles/cross-device", 36) << "    ignorado (/dev/shm no mesmo dispositivo)" << std::endl;
+            return;
+        }
+
+        size_t files = treeFiles(2, 4, scaled(20));
+
+        measure("moveFiles/cross-device", 3, 1, files * 4096, [&](size_t) { makeTree(a, 2, 4, scaled(20)); }, [&](size_t) {
+            Runner::CopyStats stats;
+            Runner::moveFiles(a, other, stats);
+        });
+
+        Runner::removeDirectory(other);
+    }
+
+    /**
+     * Lê as medianas de um arquivo de resultados gravado por este programa.
+    */
+    std::map<std::string, uint64_t> readBaseline(const std::string & file) {
+        std::map<std::string, uint64_t> baseline;
+        std::ifstream in(file);
+        std::string line;
+
+        while ( std::getline(in, line) ) {
+            size_t name = line.find("\"name\":\""), median = line.find("\"median_ns\":");
+
+            if ( name == std::string::npos or median == std::string::npos ) continue;
+
+            name += 8;
+            baseline[line.substr(name, line.find('"', name) - name)] = std::stoull(line.substr(median + 12));
+        }
+
+        return baseline;
+    }
+
+    /**
+     * Grava os resultados em JSON, com um resultado por linha.
+    */
+    void writeResults(std::ostream & out) {
+        out << "{\n\"results\": [\n";
+
+        for ( size_t i = 0; i < results.size(); i++ ) {
+            Result & r = results[i];
+
+            out << "{\"name\":\"" << r.name << "\",\"iterations\":" << r.iterations << ",\"median_ns\":" << r.median
+                << ",\"min_ns\":" << r.min << ",\"mean_ns\":" << r.mean << ",\"bytes\":" << r.bytes << "}"
+                << ( i + 1 < results.size() ? ",\n" : "\n" );
+        }
+
+        out << "],\n\"quantities\": [\n";
+
+        for ( size_t i = 0; i < quantities.size(); i++ )
+            out << "{\"name\":\"" << quantities[i].name << "\",\"value\":" << std::fixed << std::setprecision(1) << quantities[i].value
+                << ",\"unit\":\"" << quantities[i].unit << "\"}" << ( i + 1 < quantities.size() ? ",\n" : "\n" );
+
+        out << "],\n\"scale\": " << options.scale << ",\n\"threads\": " << std::thread::hardware_concurrency() << "\n}\n";
+    }
+
+    /**
+     * Compara os resultados com a base e exibe as diferenças.
+     *
+     * @return A quantidade de regressões.
+    */
+    int compare(const std::map<std::string, uint64_t> & baseline) {
+        int regressions = 0;
+
+        std::cerr << "\nComparação com " << options.baseline << " (limite de " << options.threshold << "%):\n";
+
+        for ( auto & r: results ) {
+            auto it = baseline.find(r.name);
+
+            if ( it == baseline.end() or it->second == 0 ) continue;
+
+            double change = 100.0 * ( (double) r.median - it->second ) / it->second;
+            bool regression = change > options.threshold;
+
+            regressions += regression;
+
+            std::cerr << padRight(r.name, 36) << std::right << std::setw(10) << std::fixed << std::setprecision(1)
+                      << change << "%" << ( regression ? "  REGRESSÃO" : "" ) << std::endl;
+        }
+
+        return regressions;
+    }
+
+    int usage(const char *program) {
+        std::cerr << "USO: " << program << " [--dir <diretório>] [--scale <fator>] [--filter <texto>]"
+                  << " [--out <arquivo.json>] [--baseline <arquivo.json>] [--threshold <%>]" << std::endl;
+        return 2;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    using namespace Bench;
+
+    for ( int i = 1; i < argc; i++ ) {
+        std::string arg = argv[i];
+
+        if ( arg == "--help" or i + 1 == argc ) return usage(argv[0]);
+
+        std::string value = argv[++i];
+
+        if ( arg == "--dir" ) options.dir = value;
+        else if ( arg == "--scale" ) options.scale = std::stod(value);
+        else if ( arg == "--filter" ) options.filter = value;
+        else if ( arg == "--out" ) options.out = value;
+        else if ( arg == "--baseline" ) options.baseline = value;
+        else if ( arg == "--threshold" ) options.threshold = std::stod(value);
+        else return usage(argv[0]);
+    }
+
+    std::string root = options.dir + "/shell_bench.XXXXXX";
+
+    if ( mkdtemp(&root[0]) == nullptr ) {
+        perror(options.dir.c_str());
+        return 1;
+    }
+
+    // A saída dos comandos executados vai para /dev/null; os resultados, para a saída original
+    int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    int stdoutFd = dup(STDOUT_FILENO);
+    dup2(devNull, STDOUT_FILENO);
+
+    std::cerr << "Cargas em " << root << " (escala " << options.scale << ")\n" << std::endl;
+
+    benchDispatch();
+    benchHistory(root);
+    benchFiles(root, devNull);
+    benchDirectories(root);
+    benchMove(root);
+
+    Runner::flush();
+    Runner::removeDirectory(root);
+
+    std::stringstream json;
+    writeResults(json);
+
+    if ( options.out.empty() ) Runner::writeAll(stdoutFd, json.str().data(), json.str().size());
+    else std::ofstream(options.out) << json.str();
+
+    int regressions = options.baseline.empty() ? 0 : compare(readBaseline(options.baseline));
+
+    return regressions > 0 ? 1 : 0;
+}